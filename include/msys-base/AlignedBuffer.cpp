@@ -0,0 +1,67 @@
+#include "AlignedBuffer.h"
+#include "base/string/define.h"
+#include <malloc.h>
+#include <new>
+#include <stdexcept>
+
+base::AlignedBuffer::AlignedBuffer(int64_t size, int64_t alignment)
+{
+	if (alignment <= 0 || (alignment & (alignment - 1)) != 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "对齐的字节数必须是 2 的整数次幂。"};
+	}
+
+	if (size < 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "缓冲区大小不能小于 0."};
+	}
+
+	_size = (size + alignment - 1) / alignment * alignment;
+	_alignment = alignment;
+
+	if (_size == 0)
+	{
+		return;
+	}
+
+	_buffer = static_cast<uint8_t *>(_aligned_malloc(static_cast<size_t>(_size), static_cast<size_t>(alignment)));
+	if (_buffer == nullptr)
+	{
+		throw std::bad_alloc{};
+	}
+}
+
+base::AlignedBuffer::AlignedBuffer(AlignedBuffer &&other) noexcept
+{
+	*this = std::move(other);
+}
+
+base::AlignedBuffer &base::AlignedBuffer::operator=(AlignedBuffer &&other) noexcept
+{
+	if (this == &other)
+	{
+		return *this;
+	}
+
+	Free();
+	_buffer = other._buffer;
+	_size = other._size;
+	_alignment = other._alignment;
+	other._buffer = nullptr;
+	other._size = 0;
+	other._alignment = 0;
+	return *this;
+}
+
+void base::AlignedBuffer::Free()
+{
+	if (_buffer == nullptr)
+	{
+		return;
+	}
+
+	_aligned_free(_buffer);
+	_buffer = nullptr;
+	_size = 0;
+	_alignment = 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include <cstdint>
+
+namespace base
+{
+	///
+	/// @brief 起始地址和大小都按指定字节数对齐的缓冲区。
+	///
+	/// @note 以无缓冲模式打开的 FileStream 要求读写的内存地址、大小和文件偏移量都是扇区大小
+	/// 的整数倍，可以用本类分配内存。扇区大小可以通过 base::FileStream::SectorSize 获取。
+	///
+	class AlignedBuffer
+	{
+	private:
+		uint8_t *_buffer = nullptr;
+		int64_t _size = 0;
+		int64_t _alignment = 0;
+
+		void Free();
+
+	public:
+		///
+		/// @brief 空的缓冲区。
+		///
+		AlignedBuffer() = default;
+
+		///
+		/// @brief 分配缓冲区。
+		///
+		/// @param size 缓冲区大小。会向上对齐到 alignment 的整数倍。
+		/// @param alignment 对齐的字节数。必须是 2 的整数次幂。
+		///
+		AlignedBuffer(int64_t size, int64_t alignment);
+
+		AlignedBuffer(AlignedBuffer const &) = delete;
+		AlignedBuffer &operator=(AlignedBuffer const &) = delete;
+
+		AlignedBuffer(AlignedBuffer &&other) noexcept;
+		AlignedBuffer &operator=(AlignedBuffer &&other) noexcept;
+
+		~AlignedBuffer()
+		{
+			Free();
+		}
+
+		///
+		/// @brief 缓冲区的起始地址。
+		///
+		/// @return
+		///
+		uint8_t *Buffer() const
+		{
+			return _buffer;
+		}
+
+		///
+		/// @brief 缓冲区的大小。
+		///
+		/// @return
+		///
+		int64_t Size() const
+		{
+			return _size;
+		}
+
+		///
+		/// @brief 对齐的字节数。
+		///
+		/// @return
+		///
+		int64_t Alignment() const
+		{
+			return _alignment;
+		}
+
+		///
+		/// @brief 整个缓冲区的 span.
+		///
+		/// @return
+		///
+		base::Span Span() const
+		{
+			return base::Span(_buffer, _size);
+		}
+	};
+
+} // namespace base
@@ -0,0 +1 @@
+#include "BoundedConcurrentQueue.h" // IWYU pragma: keep
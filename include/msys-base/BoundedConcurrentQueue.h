@@ -0,0 +1,164 @@
+#pragma once
+#include "base/string/define.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace msys
+{
+	///
+	/// @brief 有界的无锁多生产者多消费者队列。
+	///
+	/// @note 环形缓冲区的每个槽位带有一个序号，生产者和消费者各自用 CAS 推进自己的位置，
+	/// 再根据槽位序号判断槽位是否可写、可读。队列满或空时立即返回 false, 不会等待。
+	///
+	/// @note 容量向上取整到 2 的整数次幂。
+	///
+	template <typename T>
+	class BoundedConcurrentQueue
+	{
+	private:
+		///
+		/// @brief 一个槽位。
+		///
+		class Cell
+		{
+		public:
+			///
+			/// @brief 等于入队位置时可写，等于入队位置加 1 时可读。
+			///
+			std::atomic_uint64_t sequence = 0;
+
+			T value{};
+		};
+
+		std::unique_ptr<Cell[]> _cells;
+		uint64_t _mask = 0;
+
+		// 入队位置和出队位置放在不同的缓存行，生产者和消费者互不干扰。
+		alignas(64) std::atomic_uint64_t _enqueue_position = 0;
+		alignas(64) std::atomic_uint64_t _dequeue_position = 0;
+
+	public:
+		///
+		/// @brief 构造队列。
+		///
+		/// @param capacity 容量。会向上取整到 2 的整数次幂。
+		///
+		BoundedConcurrentQueue(int64_t capacity)
+		{
+			if (capacity <= 0)
+			{
+				throw std::invalid_argument{CODE_POS_STR + "队列容量必须大于 0."};
+			}
+
+			uint64_t size = std::bit_ceil(static_cast<uint64_t>(std::max<int64_t>(capacity, 2)));
+			_cells.reset(new Cell[size]);
+			_mask = size - 1;
+
+			for (uint64_t i = 0; i < size; i++)
+			{
+				_cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		BoundedConcurrentQueue(BoundedConcurrentQueue const &) = delete;
+		BoundedConcurrentQueue &operator=(BoundedConcurrentQueue const &) = delete;
+
+		///
+		/// @brief 容量。
+		///
+		/// @return
+		///
+		int64_t Capacity() const
+		{
+			return static_cast<int64_t>(_mask + 1);
+		}
+
+		///
+		/// @brief 尝试入队。
+		///
+		/// @param value 入队成功时被移走，失败时保持不变，可以用来重试。
+		///
+		/// @return 队列满时返回 false.
+		///
+		bool TryPush(T &value)
+		{
+			uint64_t position = _enqueue_position.load(std::memory_order_relaxed);
+
+			while (true)
+			{
+				Cell &cell = _cells[position & _mask];
+				uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+				int64_t diff = static_cast<int64_t>(sequence - position);
+
+				if (diff == 0)
+				{
+					if (_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						cell.value = std::move(value);
+						cell.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+
+					// CAS 失败时 position 已经更新为最新的入队位置。
+				}
+				else if (diff < 0)
+				{
+					// 槽位中还是上一轮的元素，队列满了。
+					return false;
+				}
+				else
+				{
+					// 别的生产者已经占用了这个位置。
+					position = _enqueue_position.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		///
+		/// @brief 尝试出队。
+		///
+		/// @param value 用来返回出队的元素。
+		///
+		/// @return 队列空时返回 false.
+		///
+		bool TryPop(T &value)
+		{
+			uint64_t position = _dequeue_position.load(std::memory_order_relaxed);
+
+			while (true)
+			{
+				Cell &cell = _cells[position & _mask];
+				uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+				int64_t diff = static_cast<int64_t>(sequence - (position + 1));
+
+				if (diff == 0)
+				{
+					if (_dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						value = std::move(cell.value);
+
+						// 槽位留给下一轮的生产者。
+						cell.sequence.store(position + _mask + 1, std::memory_order_release);
+						return true;
+					}
+				}
+				else if (diff < 0)
+				{
+					// 槽位还没写入，队列空了。
+					return false;
+				}
+				else
+				{
+					position = _dequeue_position.load(std::memory_order_relaxed);
+				}
+			}
+		}
+	};
+
+} // namespace msys
@@ -0,0 +1,130 @@
+#include "BulkOperationContext.h"
+#include "base/filesystem/filesystem.h"
+#include "base/string/define.h"
+#include "msys-base/DirectorySnapshot.h"
+#include "msys-base/MetadataCache.h"
+#include "msys-base/win32_error.h"
+#include "msys-base/windows_api.h"
+#include <mutex>
+#include <stdexcept>
+
+namespace
+{
+	thread_local msys::BulkOperationContext *_current_context = nullptr;
+
+} // namespace
+
+msys::BulkOperationContext::Scope::Scope(msys::BulkOperationContext &context)
+{
+	_previous = _current_context;
+	_current_context = &context;
+}
+
+msys::BulkOperationContext::Scope::~Scope()
+{
+	_current_context = _previous;
+}
+
+msys::BulkOperationContext *msys::BulkOperationContext::Current()
+{
+	return _current_context;
+}
+
+bool msys::BulkOperationContext::IsKnown(std::wstring const &key)
+{
+	std::shared_lock l{_lock};
+	return _known_directories.contains(key);
+}
+
+void msys::BulkOperationContext::AddKnown(std::wstring key)
+{
+	std::unique_lock l{_lock};
+	_known_directories.insert(std::move(key));
+}
+
+void msys::BulkOperationContext::EnsureDirectory(base::Path const &path)
+{
+	std::wstring key = msys::ToPathKey(path.ToString());
+
+	if (IsKnown(key))
+	{
+		return;
+	}
+
+	if (path.IsRootPath())
+	{
+		// 根目录总是存在。
+		AddKnown(std::move(key));
+		return;
+	}
+
+	std::string path_string = base::filesystem::ToWindowsLongPathString(path);
+
+	// 父目录由递归调用各自负责，这里只负责 path 本身。
+	msys::MetadataCache::InvalidationGuard invalidation_guard{path};
+
+	if (!CreateDirectoryA(path_string.c_str(), nullptr))
+	{
+		DWORD error = GetLastError();
+
+		if (error == ERROR_PATH_NOT_FOUND)
+		{
+			// 父目录不存在。先创建父目录，再重试。
+			EnsureDirectory(path.ParentPath());
+
+			if (!CreateDirectoryA(path_string.c_str(), nullptr))
+			{
+				error = GetLastError();
+			}
+			else
+			{
+				error = ERROR_SUCCESS;
+			}
+		}
+
+		if (error != ERROR_SUCCESS)
+		{
+			// 目录已存在时，除了 ERROR_ALREADY_EXISTS, 也可能因为没有父目录的写权限等原因得到
+			// ERROR_ACCESS_DENIED 之类的错误。只要它已经是目录就算成功。
+			DWORD attributes = GetFileAttributesA(path_string.c_str());
+
+			if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+			{
+				if (error == ERROR_ALREADY_EXISTS)
+				{
+					std::string message = CODE_POS_STR;
+					message += std::format("{} 已存在，但不是目录。", path.ToString());
+					throw std::runtime_error{message};
+				}
+
+				throw std::runtime_error{CODE_POS_STR + std::format("创建目录 {} 失败。", path.ToString()) + msys::FormatError(error)};
+			}
+		}
+	}
+
+	AddKnown(std::move(key));
+}
+
+void msys::BulkOperationContext::MarkExisting(base::Path const &path)
+{
+	AddKnown(msys::ToPathKey(path.ToString()));
+}
+
+void msys::BulkOperationContext::Clear()
+{
+	std::unique_lock l{_lock};
+	_known_directories.clear();
+}
+
+void msys::EnsureDirectory(base::Path const &path)
+{
+	msys::BulkOperationContext *context = msys::BulkOperationContext::Current();
+
+	if (context == nullptr)
+	{
+		base::filesystem::EnsureDirectory(path);
+		return;
+	}
+
+	context->EnsureDirectory(path);
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include <shared_mutex>
+#include <string>
+#include <unordered_set>
+
+namespace msys
+{
+	///
+	/// @brief 批量文件操作的上下文。缓存已知存在的目录。
+	///
+	/// @note 拷贝、移动大量条目时，每个条目都要确保父目录存在，同一个父目录会被反复检查。
+	/// 上下文生效期间，msys::EnsureDirectory 对每个目录只检查或创建一次。
+	///
+	/// @note 可以同时在多个线程上生效。每个线程用 Scope 让它在本线程生效。
+	///
+	/// @note 缓存不会随文件系统更新。上下文只应该存在于一次批量操作期间，期间不要删除缓存过的目录。
+	///
+	class BulkOperationContext
+	{
+	private:
+		std::shared_mutex _lock;
+
+		///
+		/// @brief 已知存在的目录。
+		///
+		std::unordered_set<std::wstring> _known_directories;
+
+		bool IsKnown(std::wstring const &key);
+		void AddKnown(std::wstring key);
+
+	public:
+		///
+		/// @brief 让上下文在当前线程生效。析构时恢复之前生效的上下文。
+		///
+		class Scope
+		{
+		private:
+			msys::BulkOperationContext *_previous = nullptr;
+
+		public:
+			Scope(msys::BulkOperationContext &context);
+			~Scope();
+
+			Scope(Scope const &) = delete;
+			Scope &operator=(Scope const &) = delete;
+		};
+
+		BulkOperationContext() = default;
+
+		BulkOperationContext(BulkOperationContext const &) = delete;
+		BulkOperationContext &operator=(BulkOperationContext const &) = delete;
+
+		///
+		/// @brief 当前线程上生效的上下文。没有则返回 nullptr.
+		///
+		/// @return
+		///
+		static msys::BulkOperationContext *Current();
+
+		///
+		/// @brief 确保目录存在。不存在则从上往下逐级创建。
+		///
+		/// @note 先直接尝试创建，只有父目录不存在时才去处理父目录，父目录已存在的常见情况下
+		/// 只需要一次系统调用。
+		///
+		/// @param path
+		///
+		void EnsureDirectory(base::Path const &path);
+
+		///
+		/// @brief 记录一个已知存在的目录。例如从目录快照中得知的目录。
+		///
+		/// @param path
+		///
+		void MarkExisting(base::Path const &path);
+
+		///
+		/// @brief 清空缓存。
+		///
+		void Clear();
+	};
+
+	///
+	/// @brief 确保目录存在。
+	///
+	/// @note 当前线程上有生效的 msys::BulkOperationContext 时使用它的缓存，
+	/// 否则调用 base::filesystem::EnsureDirectory.
+	///
+	/// @param path
+	///
+	void EnsureDirectory(base::Path const &path);
+
+} // namespace msys
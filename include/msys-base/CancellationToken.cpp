@@ -0,0 +1,10 @@
+#include "CancellationToken.h"
+#include "base/string/define.h"
+
+void msys::CancellationToken::ThrowIfCancellationRequested() const
+{
+	if (_cancellation_requested)
+	{
+		throw msys::OperationCanceledException{CODE_POS_STR + "操作已取消。"};
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <stdexcept>
+
+namespace msys
+{
+	///
+	/// @brief 操作被取消时抛出的异常。
+	///
+	class OperationCanceledException :
+		public std::runtime_error
+	{
+	public:
+		using std::runtime_error::runtime_error;
+	};
+
+	///
+	/// @brief 取消令牌。
+	///
+	/// @note 一个线程调用 Cancel, 执行操作的线程在适当的时候检查并停下来。可以跨线程使用。
+	///
+	class CancellationToken
+	{
+	private:
+		std::atomic_bool _cancellation_requested = false;
+
+	public:
+		///
+		/// @brief 请求取消。
+		///
+		void Cancel()
+		{
+			_cancellation_requested = true;
+		}
+
+		///
+		/// @brief 是否已经请求取消。
+		///
+		/// @return
+		///
+		bool IsCancellationRequested() const
+		{
+			return _cancellation_requested;
+		}
+
+		///
+		/// @brief 已经请求取消时抛出 msys::OperationCanceledException.
+		///
+		void ThrowIfCancellationRequested() const;
+	};
+
+} // namespace msys
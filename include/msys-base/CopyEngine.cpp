@@ -0,0 +1,723 @@
+#include "CopyEngine.h"
+#include "base/string/define.h"
+#include "msys-base/MetadataCache.h"
+#include "msys-base/win32_error.h"
+#include "msys-base/windows_api.h"
+#include <filesystem>
+#include <stdexcept>
+
+msys::CopyEngine::CopyEngine(msys::CopyOptions const &options)
+	: _options(options)
+{
+	if (_options.max_pending_count <= 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "max_pending_count 必须大于 0."};
+	}
+}
+
+bool msys::CopyEngine::IsCancellationRequested() const
+{
+	return _options.cancellation_token != nullptr &&
+		   _options.cancellation_token->IsCancellationRequested();
+}
+
+/* #region 进度 */
+
+void msys::CopyEngine::ReportProgress(bool force)
+{
+	if (_options.progress_sink == nullptr)
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::duration elapsed = now - _last_report_time;
+
+	if (!force && elapsed < _options.progress_interval)
+	{
+		return;
+	}
+
+	double seconds = std::chrono::duration<double>(elapsed).count();
+
+	if (seconds > 0)
+	{
+		_progress.bytes_per_second = (_progress.done_bytes - _last_report_bytes) / seconds;
+	}
+
+	_last_report_time = now;
+	_last_report_bytes = _progress.done_bytes;
+	_options.progress_sink(_progress);
+}
+
+void msys::CopyEngine::OnDiscovered(int64_t size)
+{
+	std::lock_guard l{_progress_lock};
+	_progress.total_files++;
+	_progress.total_bytes += size;
+}
+
+bool msys::CopyEngine::OnProgress(base::Path const &path, int64_t bytes)
+{
+	std::lock_guard l{_progress_lock};
+	_progress.done_bytes += bytes;
+	_progress.current_path = path;
+	ReportProgress(false);
+	return !IsCancellationRequested();
+}
+
+void msys::CopyEngine::OnFileDone(base::Path const &path,
+								  std::optional<msys::CopyStrategy> strategy,
+								  int64_t size,
+								  bool skipped)
+{
+	std::lock_guard l{_progress_lock};
+	_progress.done_files++;
+	_summary.files++;
+
+	if (skipped)
+	{
+		// 跳过的文件也算作完成，这样 done_bytes 最终能达到 total_bytes.
+		_progress.done_bytes += size;
+		_summary.skipped_count++;
+	}
+
+	if (strategy.has_value())
+	{
+		_summary.bytes += size;
+		_summary.copied_files.push_back(msys::CopiedFile{path, strategy.value(), size});
+	}
+
+	ReportProgress(false);
+}
+
+/* #endregion */
+
+std::optional<msys::CopyStrategy> msys::CopyEngine::CopyBySnapshot(CopyTask const &task,
+																   msys::CopyProgressCallback const &progress)
+{
+	if (!task.destination.has_value())
+	{
+		// 目标不存在。父目录已经由遍历线程创建好了。
+		return msys::CopyFileContent(task.source_path, task.destination_path, progress);
+	}
+
+	switch (_options.overwrite_method)
+	{
+	case base::filesystem::OverwriteOption::Skip:
+		{
+			return std::nullopt;
+		}
+	case base::filesystem::OverwriteOption::Overwrite:
+		{
+			base::filesystem::Remove(task.destination_path);
+			return msys::CopyFileContent(task.source_path, task.destination_path, progress);
+		}
+	case base::filesystem::OverwriteOption::Update:
+	default:
+		{
+			if (task.source_last_write_time <= task.destination->last_write_time)
+			{
+				return std::nullopt;
+			}
+
+			return msys::UpdateFileContent(task.source_path, task.destination_path, progress);
+		}
+	}
+}
+
+bool msys::CopyEngine::MoveJunction(CopyTask const &task)
+{
+	msys::FileStatus destination_status = msys::Status(task.destination_path, false);
+
+	if (destination_status.Exists())
+	{
+		switch (_options.overwrite_method)
+		{
+		case base::filesystem::OverwriteOption::Skip:
+			{
+				return false;
+			}
+		case base::filesystem::OverwriteOption::Overwrite:
+			{
+				break;
+			}
+		case base::filesystem::OverwriteOption::Update:
+		default:
+			{
+				if (task.source_last_write_time <= destination_status.last_write_time)
+				{
+					return false;
+				}
+
+				break;
+			}
+		}
+
+		base::filesystem::Remove(task.destination_path);
+	}
+
+	{
+		msys::MetadataCache::InvalidationGuard invalidation_guard{task.destination_path};
+		msys::CopyJunction(task.source_path, task.destination_path);
+	}
+
+	base::filesystem::Remove(task.source_path);
+	return true;
+}
+
+void msys::CopyEngine::CopyEntry(CopyTask const &task)
+{
+	if (IsCancellationRequested())
+	{
+		return;
+	}
+
+	if (task.is_junction && _remove_source)
+	{
+		bool moved = MoveJunction(task);
+		OnFileDone(task.destination_path, std::nullopt, 0, !moved);
+		return;
+	}
+
+	if (!task.is_regular_file)
+	{
+		base::filesystem::CopySingleLayer(task.source_path, task.destination_path, _options.overwrite_method);
+
+		if (_remove_source)
+		{
+			base::filesystem::Remove(task.source_path);
+		}
+
+		OnFileDone(task.destination_path, std::nullopt, 0, false);
+		return;
+	}
+
+	msys::CopyProgressCallback progress = [this, &task](int64_t bytes)
+	{
+		return OnProgress(task.source_path, bytes);
+	};
+
+	std::optional<msys::CopyStrategy> strategy;
+
+	if (task.destination_known)
+	{
+		strategy = CopyBySnapshot(task, progress);
+	}
+	else
+	{
+		strategy = msys::CopyRegularFile(task.source_path,
+										 task.destination_path,
+										 _options.overwrite_method,
+										 progress);
+	}
+
+	if (_remove_source && strategy.has_value())
+	{
+		// 跨卷移动。拷贝完立即删除源文件，不等整个目录树拷贝完。
+		base::filesystem::Remove(task.source_path);
+	}
+
+	OnFileDone(task.destination_path, strategy, task.size, !strategy.has_value());
+}
+
+void msys::CopyEngine::Submit(CopyTask task)
+{
+	{
+		std::unique_lock l{_lock};
+
+		_condition.wait(l, [this]()
+						{
+							return _pending_count < _options.max_pending_count;
+						});
+
+		_pending_count++;
+	}
+
+	if (_pool == nullptr)
+	{
+		_pool = std::unique_ptr<msys::ThreadPool>{new msys::ThreadPool{_options.thread_count}};
+	}
+
+	_pool->Post([this, task = std::move(task)]()
+			   {
+				   std::exception_ptr error;
+
+				   try
+				   {
+					   msys::BulkOperationContext::Scope scope{_context};
+					   CopyEntry(task);
+				   }
+				   catch (...)
+				   {
+					   error = std::current_exception();
+				   }
+
+				   {
+					   std::lock_guard l{_lock};
+
+					   if (error != nullptr && _error == nullptr)
+					   {
+						   _error = error;
+					   }
+
+					   _pending_count--;
+				   }
+
+				   _condition.notify_all();
+			   });
+}
+
+void msys::CopyEngine::WaitAll()
+{
+	std::unique_lock l{_lock};
+
+	_condition.wait(l, [this]()
+					{
+						return _pending_count == 0;
+					});
+}
+
+void msys::CopyEngine::EnumerateDirectory(base::Path const &source_path, base::Path const &destination_path)
+{
+	_context.EnsureDirectory(destination_path);
+
+	// 一次批量枚举得到目标目录树的元数据，之后每个条目都在内存中判断。
+	msys::DirectorySnapshot destination_snapshot{destination_path};
+
+	msys::EnumerateDirectoryTree(source_path,
+								 [&](std::string const &relative_path, msys::DirectoryEntryInfo const &info)
+								 {
+									 if (IsCancellationRequested())
+									 {
+										 return false;
+									 }
+
+									 {
+										 std::lock_guard l{_lock};
+
+										 if (_error != nullptr)
+										 {
+											 // 已经有条目拷贝失败，不再提交新的条目。
+											 return false;
+										 }
+									 }
+
+									 CopyTask task{};
+									 task.source_path = source_path + base::Path{relative_path};
+									 task.destination_path = destination_path + base::Path{relative_path};
+
+									 msys::DirectoryEntryInfo const *destination = destination_snapshot.Find(relative_path);
+
+									 if (info.type == msys::DirectoryEntryType::Directory)
+									 {
+										 if (destination != nullptr && destination->type == msys::DirectoryEntryType::Directory)
+										 {
+											 _context.MarkExisting(task.destination_path);
+										 }
+										 else
+										 {
+											 // 目录在遍历线程上按从上到下的顺序创建，保证它里面的条目提交时目录已经存在。
+											 _context.EnsureDirectory(task.destination_path);
+
+											 if (destination == nullptr && destination_snapshot.ContainsDirectoryOf(relative_path))
+											 {
+												 // 快照确定它原来不存在，现在是刚创建的空目录。记录下来，
+												 // 它下面的条目就不需要逐个去文件系统中检查了。
+												 destination_snapshot.AddEmptyDirectory(relative_path);
+											 }
+										 }
+
+										 return true;
+									 }
+
+									 task.is_regular_file = info.type == msys::DirectoryEntryType::RegularFile;
+									 task.is_junction = info.type == msys::DirectoryEntryType::Other;
+									 task.size = task.is_regular_file ? info.size : 0;
+									 task.source_last_write_time = info.last_write_time;
+
+									 if (destination != nullptr)
+									 {
+										 task.destination_known = true;
+										 task.destination = *destination;
+									 }
+									 else
+									 {
+										 task.destination_known = destination_snapshot.ContainsDirectoryOf(relative_path);
+									 }
+
+									 if (task.destination.has_value() &&
+										 task.destination->type != msys::DirectoryEntryType::RegularFile)
+									 {
+										 // 目标不是常规文件，交给逐个检查的路径处理。
+										 task.destination_known = false;
+										 task.destination.reset();
+									 }
+
+									 OnDiscovered(task.size);
+									 Submit(std::move(task));
+									 return true;
+								 });
+}
+
+void msys::CopyEngine::Begin(bool remove_source)
+{
+	_context.Clear();
+	_remove_source = remove_source;
+
+	std::lock_guard l{_progress_lock};
+	_progress = msys::CopyProgress{};
+	_summary = msys::CopySummary{};
+	_start_time = std::chrono::steady_clock::now();
+	_last_report_time = _start_time;
+	_last_report_bytes = 0;
+}
+
+msys::CopySummary msys::CopyEngine::End(std::exception_ptr error)
+{
+	// 无论遍历是否成功，都要等已提交的任务结束，它们引用了 this.
+	WaitAll();
+
+	msys::CopySummary summary{};
+
+	{
+		std::lock_guard l{_progress_lock};
+		_progress.enumeration_completed = true;
+		_summary.elapsed = std::chrono::steady_clock::now() - _start_time;
+		summary = _summary;
+
+		if (error == nullptr)
+		{
+			ReportProgress(true);
+		}
+	}
+
+	if (IsCancellationRequested())
+	{
+		_error = nullptr;
+		throw msys::OperationCanceledException{CODE_POS_STR + "拷贝已取消。"};
+	}
+
+	if (error != nullptr)
+	{
+		_error = nullptr;
+		std::rethrow_exception(error);
+	}
+
+	if (_error != nullptr)
+	{
+		std::exception_ptr copy_error = _error;
+		_error = nullptr;
+		std::rethrow_exception(copy_error);
+	}
+
+	return summary;
+}
+
+void msys::CopyEngine::CopySingleEntry(base::Path const &source_path,
+									   base::Path const &destination_path,
+									   msys::FileStatus const &source_status)
+{
+	CopyTask task{};
+	task.source_path = source_path;
+	task.destination_path = destination_path;
+	task.is_regular_file = source_status.type == msys::FileType::RegularFile;
+	task.is_junction = source_status.type == msys::FileType::Junction;
+	task.size = task.is_regular_file ? source_status.size : 0;
+	task.source_last_write_time = source_status.last_write_time;
+
+	OnDiscovered(task.size);
+	CopyEntry(task);
+}
+
+void msys::CopyEngine::ThrowIfFailed()
+{
+	std::exception_ptr error;
+
+	{
+		std::lock_guard l{_lock};
+		error = _error;
+	}
+
+	if (error != nullptr)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+/* #region 移动 */
+
+bool msys::CopyEngine::TryRename(base::Path const &source_path, base::Path const &destination_path)
+{
+	// 不带 MOVEFILE_COPY_ALLOWED, 跨卷时失败，由调用者用并行拷贝代替。
+	if (MoveFileExA(base::filesystem::ToWindowsLongPathString(source_path).c_str(),
+					base::filesystem::ToWindowsLongPathString(destination_path).c_str(),
+					0))
+	{
+		return true;
+	}
+
+	DWORD error = GetLastError();
+
+	if (error == ERROR_NOT_SAME_DEVICE)
+	{
+		return false;
+	}
+
+	throw std::runtime_error{CODE_POS_STR +
+							 std::format("将 {} 移动到 {} 失败。", source_path.ToString(), destination_path.ToString()) +
+							 msys::FormatError(error)};
+}
+
+void msys::CopyEngine::RemoveEmptyDirectories(base::Path const &path)
+{
+	std::vector<std::string> directories{base::filesystem::ToWindowsLongPathString(path)};
+
+	msys::EnumerateDirectoryTree(path,
+								 [&](std::string const &relative_path, msys::DirectoryEntryInfo const &info)
+								 {
+									 if (info.type == msys::DirectoryEntryType::Directory)
+									 {
+										 directories.push_back(base::filesystem::ToWindowsLongPathString(path + base::Path{relative_path}));
+									 }
+
+									 return true;
+								 });
+
+	// 父目录总在子目录之前枚举出来，逆序删除。
+	for (auto it = directories.rbegin(); it != directories.rend(); ++it)
+	{
+		if (RemoveDirectoryA(it->c_str()))
+		{
+			continue;
+		}
+
+		DWORD error = GetLastError();
+
+		if (error == ERROR_DIR_NOT_EMPTY || error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND)
+		{
+			continue;
+		}
+
+		throw std::runtime_error{CODE_POS_STR + std::format("删除目录 {} 失败。", *it) + msys::FormatError(error)};
+	}
+}
+
+void msys::CopyEngine::CopyThenRemove(base::Path const &source_path,
+									  base::Path const &destination_path,
+									  msys::FileStatus const &source_status)
+{
+	// 目录交接点按链接处理，不能拷贝后删除它指向的目录中的内容。
+	if (source_status.type == msys::FileType::Directory)
+	{
+		EnumerateDirectory(source_path, destination_path);
+		WaitAll();
+		ThrowIfFailed();
+
+		if (IsCancellationRequested())
+		{
+			return;
+		}
+
+		RemoveEmptyDirectories(source_path);
+		return;
+	}
+
+	CopySingleEntry(source_path, destination_path, source_status);
+}
+
+void msys::CopyEngine::MoveEntry(base::Path const &source_path, base::Path const &destination_path)
+{
+	if (IsCancellationRequested())
+	{
+		return;
+	}
+
+	msys::FileStatus source_status = msys::Status(source_path, false);
+	msys::FileStatus destination_status = msys::Status(destination_path, false);
+
+	if (!destination_status.Exists())
+	{
+		// 目标路径不存在，直接移动。
+		_context.EnsureDirectory(destination_path.ParentPath());
+
+		if (TryRename(source_path, destination_path))
+		{
+			OnDiscovered(0);
+			OnFileDone(destination_path, std::nullopt, 0, false);
+			return;
+		}
+
+		CopyThenRemove(source_path, destination_path, source_status);
+		return;
+	}
+
+	// 目标路径存在
+	if (_options.overwrite_method == base::filesystem::OverwriteOption::Skip)
+	{
+		OnDiscovered(0);
+		OnFileDone(destination_path, std::nullopt, 0, true);
+		return;
+	}
+
+	if (_options.overwrite_method == base::filesystem::OverwriteOption::Update)
+	{
+		if (source_status.type == msys::FileType::Directory &&
+			destination_status.type == msys::FileType::Directory)
+		{
+			// 合并目录。先取出所有名称，移动过程中源目录会变化。
+			std::vector<std::string> names;
+
+			for (std::filesystem::directory_entry const &entry :
+				 std::filesystem::directory_iterator{base::filesystem::ToWindowsLongPathString(source_path)})
+			{
+				names.push_back(entry.path().filename().string());
+			}
+
+			for (std::string const &name : names)
+			{
+				MoveEntry(source_path + base::Path{name}, destination_path + base::Path{name});
+				ThrowIfFailed();
+			}
+
+			if (IsCancellationRequested())
+			{
+				return;
+			}
+
+			// 没有移动的条目留在源目录中，源目录空了才删除。
+			RemoveEmptyDirectories(source_path);
+			return;
+		}
+
+		if (source_status.last_write_time <= destination_status.last_write_time)
+		{
+			OnDiscovered(0);
+			OnFileDone(destination_path, std::nullopt, 0, true);
+			return;
+		}
+	}
+
+	// 需要覆盖。
+	base::filesystem::Remove(destination_path);
+
+	if (TryRename(source_path, destination_path))
+	{
+		OnDiscovered(0);
+		OnFileDone(destination_path, std::nullopt, 0, false);
+		return;
+	}
+
+	CopyThenRemove(source_path, destination_path, source_status);
+}
+
+msys::CopySummary msys::CopyEngine::Move(base::Path const &source_path, base::Path const &destination_path)
+{
+	msys::MetadataCache::InvalidationGuard source_invalidation_guard{source_path};
+	msys::MetadataCache::InvalidationGuard destination_invalidation_guard{destination_path};
+	Begin(true);
+	msys::BulkOperationContext::Scope scope{_context};
+	std::exception_ptr error;
+
+	try
+	{
+		if (!msys::Status(source_path, false).Exists())
+		{
+			std::string message = CODE_POS_STR;
+			message += std::format("源路径 {} 不存在。", source_path.ToString());
+			throw std::runtime_error{message};
+		}
+
+		if (destination_path.IsRootPath())
+		{
+			throw std::runtime_error{CODE_POS_STR + "无法将源路径移动为根路径。"};
+		}
+
+		MoveEntry(source_path, destination_path);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	return End(error);
+}
+
+/* #endregion */
+
+msys::CopySummary msys::CopyEngine::CopyDirectory(base::Path const &source_path, base::Path const &destination_path)
+{
+	msys::MetadataCache::InvalidationGuard invalidation_guard{destination_path};
+	Begin(false);
+	msys::BulkOperationContext::Scope scope{_context};
+	std::exception_ptr error;
+
+	try
+	{
+		EnumerateDirectory(source_path, destination_path);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	return End(error);
+}
+
+msys::CopySummary msys::CopyEngine::Copy(base::Path const &source_path, base::Path const &destination_path)
+{
+	msys::MetadataCache::InvalidationGuard invalidation_guard{destination_path};
+	Begin(false);
+	msys::BulkOperationContext::Scope scope{_context};
+	std::exception_ptr error;
+
+	try
+	{
+		msys::FileStatus source_status = msys::Status(source_path, false);
+
+		if (!source_status.Exists())
+		{
+			std::string message = CODE_POS_STR;
+			message += std::format("源路径 {} 不存在。", source_path.ToString());
+			throw std::runtime_error{message};
+		}
+
+		if (destination_path.IsRootPath())
+		{
+			throw std::runtime_error{CODE_POS_STR + "无法将源路径移动为根路径。"};
+		}
+
+		if (source_status.type == msys::FileType::Directory ||
+			source_status.type == msys::FileType::Junction)
+		{
+			EnumerateDirectory(source_path, destination_path);
+		}
+		else
+		{
+			// 单个条目直接在调用线程上拷贝。
+			CopySingleEntry(source_path, destination_path, source_status);
+		}
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	return End(error);
+}
+
+msys::CopySummary msys::Copy(base::Path const &source_path,
+							 base::Path const &destination_path,
+							 msys::CopyOptions const &options)
+{
+	msys::CopyEngine engine{options};
+	return engine.Copy(source_path, destination_path);
+}
+
+msys::CopySummary msys::Move(base::Path const &source_path,
+							 base::Path const &destination_path,
+							 msys::CopyOptions const &options)
+{
+	msys::CopyEngine engine{options};
+	return engine.Move(source_path, destination_path);
+}
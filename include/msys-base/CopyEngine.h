@@ -0,0 +1,458 @@
+#pragma once
+#include "base/filesystem/filesystem.h"
+#include "base/filesystem/Path.h"
+#include "msys-base/BulkOperationContext.h"
+#include "msys-base/CancellationToken.h"
+#include "msys-base/DirectorySnapshot.h"
+#include "msys-base/file_copy.h"
+#include "msys-base/FileStatus.h"
+#include "msys-base/ThreadPool.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace msys
+{
+	///
+	/// @brief 拷贝进度。
+	///
+	class CopyProgress
+	{
+	public:
+		///
+		/// @brief 已经枚举到的文件数。
+		///
+		int64_t total_files = 0;
+
+		///
+		/// @brief 已经枚举到的文件的总字节数。
+		///
+		int64_t total_bytes = 0;
+
+		///
+		/// @brief 源目录是否已经枚举完。枚举完之前 total_files 和 total_bytes 还会增长。
+		///
+		bool enumeration_completed = false;
+
+		///
+		/// @brief 已经处理完的文件数，包括跳过的文件。
+		///
+		int64_t done_files = 0;
+
+		///
+		/// @brief 已经完成的字节数。
+		///
+		int64_t done_bytes = 0;
+
+		///
+		/// @brief 最近正在拷贝的文件。
+		///
+		base::Path current_path;
+
+		///
+		/// @brief 从上一次报告到这一次报告之间的吞吐量。
+		///
+		double bytes_per_second = 0;
+	};
+
+	///
+	/// @brief 一个已拷贝的文件。
+	///
+	class CopiedFile
+	{
+	public:
+		///
+		/// @brief 目标路径。
+		///
+		base::Path path;
+
+		msys::CopyStrategy strategy = msys::CopyStrategy::Kernel;
+
+		///
+		/// @brief 文件大小。
+		///
+		int64_t size = 0;
+	};
+
+	///
+	/// @brief 一次拷贝的汇总。
+	///
+	class CopySummary
+	{
+	public:
+		///
+		/// @brief 处理的文件数，包括跳过的文件。
+		///
+		int64_t files = 0;
+
+		///
+		/// @brief 实际拷贝的字节数。
+		///
+		int64_t bytes = 0;
+
+		///
+		/// @brief 目标已存在并且不需要覆盖，被跳过的文件数。
+		///
+		int64_t skipped_count = 0;
+
+		std::chrono::nanoseconds elapsed{};
+
+		///
+		/// @brief 每个被拷贝的常规文件及其拷贝方式。
+		///
+		std::vector<msys::CopiedFile> copied_files;
+	};
+
+	///
+	/// @brief 拷贝目录树的选项。
+	///
+	class CopyOptions
+	{
+	public:
+		///
+		/// @brief 目标路径已存在时怎么处理。
+		///
+		base::filesystem::OverwriteOption overwrite_method = base::filesystem::OverwriteOption::Skip;
+
+		///
+		/// @brief 拷贝线程数。小于等于 0 时使用硬件线程数。
+		///
+		int64_t thread_count = 0;
+
+		///
+		/// @brief 最多允许多少个条目已经枚举出来但还没拷贝完。
+		///
+		/// @note 达到这个数量后遍历线程会等待，避免巨大的目录树把待拷贝条目全部堆在内存中。
+		///
+		int64_t max_pending_count = 1024 * 16;
+
+		///
+		/// @brief 进度回调。可以为空。
+		///
+		/// @note 在拷贝线程上调用，同一时刻只有一个线程在调用。两次调用至少间隔 progress_interval,
+		/// 拷贝结束时会再调用一次。
+		///
+		std::function<void(msys::CopyProgress const &)> progress_sink;
+
+		///
+		/// @brief 两次进度回调之间的最短间隔。
+		///
+		std::chrono::milliseconds progress_interval{200};
+
+		///
+		/// @brief 取消令牌。可以为空。
+		///
+		/// @note 请求取消后，正在拷贝的文件会停下来并被删除，不再开始新的条目。
+		/// 拷贝函数在所有线程停下来后抛出 msys::OperationCanceledException.
+		///
+		std::shared_ptr<msys::CancellationToken> cancellation_token;
+	};
+
+	///
+	/// @brief 并行拷贝目录树。
+	///
+	/// @note 调用 Copy 的线程负责遍历源目录，并按从上到下的顺序创建目标目录。
+	/// 文件和符号链接交给工作窃取线程池并行拷贝。目录总是在它里面的条目被枚举出来之前创建好，
+	/// 所以拷贝线程不需要再检查父目录。
+	///
+	/// @note 每个条目的处理方式与 base::filesystem::CopySingleLayer 相同，覆盖选项的语义不变。
+	///
+	/// @note 开始前对目标目录树做一次快照，是否跳过、是否需要更新都根据快照判断。
+	/// 增量拷贝时只有需要拷贝的文件才会访问目标文件。
+	///
+	/// @note 拷贝期间 msys::BulkOperationContext 在遍历线程和拷贝线程上生效，
+	/// 每个目标目录只检查或创建一次。
+	///
+	class CopyEngine
+	{
+	private:
+		///
+		/// @brief 一个待拷贝的条目。
+		///
+		class CopyTask
+		{
+		public:
+			base::Path source_path;
+			base::Path destination_path;
+
+			///
+			/// @brief 是常规文件而不是符号链接等其他条目。
+			///
+			bool is_regular_file = false;
+
+			///
+			/// @brief 是目录交接点。
+			///
+			bool is_junction = false;
+
+			///
+			/// @brief 常规文件的大小。
+			///
+			int64_t size = 0;
+
+			///
+			/// @brief 源文件的最后修改时间。FILETIME 的值。
+			///
+			int64_t source_last_write_time = 0;
+
+			///
+			/// @brief 目标快照能否确定目标路径的状态。不能确定时要去文件系统中检查。
+			///
+			bool destination_known = false;
+
+			///
+			/// @brief 目标快照中的目标条目。destination_known 为 true 并且这里为空，说明目标不存在。
+			///
+			std::optional<msys::DirectoryEntryInfo> destination;
+		};
+
+		msys::CopyOptions _options;
+
+		///
+		/// @brief 条目拷贝成功后删除源条目。跨卷移动时使用。
+		///
+		bool _remove_source = false;
+
+		///
+		/// @brief 一次拷贝期间已知存在的目标目录。遍历线程和拷贝线程共用。
+		///
+		msys::BulkOperationContext _context;
+
+		std::mutex _lock;
+		std::condition_variable _condition;
+
+		///
+		/// @brief 已经提交但还没拷贝完的条目数。
+		///
+		int64_t _pending_count = 0;
+
+		///
+		/// @brief 第一个拷贝失败的条目抛出的异常。
+		///
+		std::exception_ptr _error;
+
+		///
+		/// @brief 保护进度和汇总。
+		///
+		std::mutex _progress_lock;
+
+		msys::CopyProgress _progress;
+		msys::CopySummary _summary;
+		std::chrono::steady_clock::time_point _start_time;
+		std::chrono::steady_clock::time_point _last_report_time;
+		int64_t _last_report_bytes = 0;
+
+		///
+		/// @brief 第一次提交条目时才创建。只拷贝单个条目或只需要重命名时不创建线程。
+		///
+		/// @note 放在其他成员之后，析构时最先销毁，等工作线程退出后才销毁它们用到的锁和条件变量。
+		///
+		std::unique_ptr<msys::ThreadPool> _pool;
+
+		bool IsCancellationRequested() const;
+
+		///
+		/// @brief 在持有 _progress_lock 时调用进度回调。
+		///
+		/// @param force 为 true 时不检查间隔。
+		///
+		void ReportProgress(bool force);
+
+		///
+		/// @brief 枚举到一个文件。
+		///
+		void OnDiscovered(int64_t size);
+
+		///
+		/// @brief 某个文件新完成了 bytes 个字节。
+		///
+		/// @return 请求取消后返回 false.
+		///
+		bool OnProgress(base::Path const &path, int64_t bytes);
+
+		///
+		/// @brief 一个条目处理完。
+		///
+		/// @param path 目标路径。
+		/// @param strategy 常规文件的拷贝方式。跳过了或者不是常规文件则为空。
+		/// @param size 常规文件的大小。
+		/// @param skipped 目标已存在并且不需要覆盖。
+		///
+		void OnFileDone(base::Path const &path,
+						std::optional<msys::CopyStrategy> strategy,
+						int64_t size,
+						bool skipped);
+
+		///
+		/// @brief 根据目标快照拷贝一个常规文件，不再检查目标是否存在、比较修改时间。
+		///
+		/// @return 拷贝方式。跳过了则为空。
+		///
+		std::optional<msys::CopyStrategy> CopyBySnapshot(CopyTask const &task,
+														 msys::CopyProgressCallback const &progress);
+
+		///
+		/// @brief 跨卷移动一个目录交接点：在目标上重新创建它，然后删除源交接点。
+		///
+		/// @note 按拷贝单层的方式处理会在目标上得到一个普通的空目录，删除源之后链接就丢了。
+		///
+		/// @return 目标已存在并且不需要覆盖时返回 false, 源交接点保留。
+		///
+		bool MoveJunction(CopyTask const &task);
+
+		///
+		/// @brief 拷贝一个条目。在拷贝线程上执行。
+		///
+		void CopyEntry(CopyTask const &task);
+
+		///
+		/// @brief 把一个条目交给线程池拷贝。
+		///
+		/// @note 待拷贝条目太多时会阻塞。
+		///
+		void Submit(CopyTask task);
+
+		///
+		/// @brief 等待所有已提交的条目拷贝完。
+		///
+		void WaitAll();
+
+		///
+		/// @brief 遍历源目录并提交所有条目。
+		///
+		void EnumerateDirectory(base::Path const &source_path, base::Path const &destination_path);
+
+		///
+		/// @brief 在调用线程上拷贝单个条目。
+		///
+		void CopySingleEntry(base::Path const &source_path,
+							 base::Path const &destination_path,
+							 msys::FileStatus const &source_status);
+
+		///
+		/// @brief 已经有条目拷贝失败时抛出它的异常。
+		///
+		void ThrowIfFailed();
+
+		///
+		/// @brief 用 MoveFileExA 重命名，不允许跨卷。
+		///
+		/// @return 源和目标不在同一个卷上时返回 false. 其他错误抛出异常。
+		///
+		static bool TryRename(base::Path const &source_path, base::Path const &destination_path);
+
+		///
+		/// @brief 删除目录树中已经空了的目录，从下往上删除。还有条目的目录保留。
+		///
+		static void RemoveEmptyDirectories(base::Path const &path);
+
+		///
+		/// @brief 跨卷移动。拷贝一个条目就删除一个源条目，最后删除空了的源目录。
+		///
+		/// @note 目标路径不存在。
+		///
+		void CopyThenRemove(base::Path const &source_path,
+							base::Path const &destination_path,
+							msys::FileStatus const &source_status);
+
+		///
+		/// @brief 移动一个条目。能重命名就重命名，跨卷时退回到拷贝再删除。
+		///
+		/// @note Update 模式下源和目标都是目录时逐个条目合并。
+		///
+		void MoveEntry(base::Path const &source_path, base::Path const &destination_path);
+
+		///
+		/// @brief 开始一次拷贝前重置进度和汇总。
+		///
+		/// @param remove_source 条目拷贝成功后是否删除源条目。
+		///
+		void Begin(bool remove_source);
+
+		///
+		/// @brief 等待所有条目拷贝完，报告最终进度，抛出第一个错误或返回汇总。
+		///
+		/// @param error 遍历线程上发生的错误。
+		///
+		msys::CopySummary End(std::exception_ptr error);
+
+	public:
+		CopyEngine(msys::CopyOptions const &options);
+
+		CopyEngine(CopyEngine const &) = delete;
+		CopyEngine &operator=(CopyEngine const &) = delete;
+
+		///
+		/// @brief 将源目录中的内容递归拷贝到目标目录中。
+		///
+		/// @note 某个条目拷贝失败后不再提交新的条目，等已提交的条目结束后抛出第一个错误。
+		///
+		/// @param source_path 源目录。
+		/// @param destination_path 目标目录。不存在会被创建。
+		///
+		/// @return
+		///
+		msys::CopySummary CopyDirectory(base::Path const &source_path, base::Path const &destination_path);
+
+		///
+		/// @brief 拷贝任意目录条目。语义与 base::filesystem::Copy 相同。
+		///
+		/// @param source_path
+		/// @param destination_path
+		///
+		/// @return
+		///
+		msys::CopySummary Copy(base::Path const &source_path, base::Path const &destination_path);
+
+		///
+		/// @brief 移动任意目录条目。覆盖选项的语义与 base::filesystem::Move 相同。
+		///
+		/// @note 同一个卷内只是重命名。跨卷时（MoveFileExA 返回 ERROR_NOT_SAME_DEVICE）
+		/// 退回到并行拷贝，每个文件拷贝完立即删除源文件，最后删除空了的源目录。
+		///
+		/// @note Update 模式下源和目标都是目录时逐个条目合并：目标中不存在的条目整个重命名过去，
+		/// 同名目录递归合并，同名文件在源更新时替换。没有移动的源条目保留，源目录空了才删除。
+		///
+		/// @param source_path
+		/// @param destination_path
+		///
+		/// @return
+		///
+		msys::CopySummary Move(base::Path const &source_path, base::Path const &destination_path);
+	};
+
+	///
+	/// @brief 带进度回调和取消令牌的 base::filesystem::Copy.
+	///
+	/// @param source_path
+	/// @param destination_path
+	/// @param options
+	///
+	/// @return
+	///
+	msys::CopySummary Copy(base::Path const &source_path,
+						   base::Path const &destination_path,
+						   msys::CopyOptions const &options);
+
+	///
+	/// @brief 带进度回调和取消令牌的 base::filesystem::Move.
+	///
+	/// @note 见 msys::CopyEngine::Move.
+	///
+	/// @param source_path
+	/// @param destination_path
+	/// @param options
+	///
+	/// @return
+	///
+	msys::CopySummary Move(base::Path const &source_path,
+						   base::Path const &destination_path,
+						   msys::CopyOptions const &options);
+
+} // namespace msys
@@ -0,0 +1 @@
+#include "DUPLICATE_EXTENTS_DATA.h" // IWYU pragma: keep
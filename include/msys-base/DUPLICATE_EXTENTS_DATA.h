@@ -0,0 +1,64 @@
+#pragma once
+#include <windows.h>
+
+// 块克隆相关的控制代码。MinGW 的头文件不一定有，没有就自己定义。
+#ifndef FSCTL_DUPLICATE_EXTENTS_TO_FILE
+	#define FSCTL_DUPLICATE_EXTENTS_TO_FILE (0x00098344)
+#endif
+
+#ifndef FSCTL_GET_INTEGRITY_INFORMATION
+	#define FSCTL_GET_INTEGRITY_INFORMATION (0x0009027C)
+#endif
+
+#ifndef FSCTL_SET_INTEGRITY_INFORMATION
+	#define FSCTL_SET_INTEGRITY_INFORMATION (0x0009C280)
+#endif
+
+// 卷支持块克隆时，GetVolumeInformationByHandleW 返回的标志中有这一位。
+#ifndef FILE_SUPPORTS_BLOCK_REFCOUNTING
+	#define FILE_SUPPORTS_BLOCK_REFCOUNTING (0x08000000)
+#endif
+
+namespace msys
+{
+	// 手动定义 FSCTL_DUPLICATE_EXTENTS_TO_FILE 用到的结构体。
+	// 放在 msys 命名空间中，避免与新版本头文件中的定义冲突。
+
+	///
+	/// @brief FSCTL_DUPLICATE_EXTENTS_TO_FILE 的输入。对目标文件句柄调用。
+	///
+	typedef struct DUPLICATE_EXTENTS_DATA
+	{
+		///
+		/// @brief 源文件句柄。
+		///
+		HANDLE FileHandle;
+
+		LARGE_INTEGER SourceFileOffset;
+		LARGE_INTEGER TargetFileOffset;
+		LARGE_INTEGER ByteCount;
+	} DUPLICATE_EXTENTS_DATA, *PDUPLICATE_EXTENTS_DATA;
+
+	///
+	/// @brief FSCTL_GET_INTEGRITY_INFORMATION 的输出。
+	///
+	typedef struct FSCTL_GET_INTEGRITY_INFORMATION_BUFFER
+	{
+		WORD ChecksumAlgorithm;
+		WORD Reserved;
+		DWORD Flags;
+		DWORD ChecksumChunkSizeInBytes;
+		DWORD ClusterSizeInBytes;
+	} FSCTL_GET_INTEGRITY_INFORMATION_BUFFER, *PFSCTL_GET_INTEGRITY_INFORMATION_BUFFER;
+
+	///
+	/// @brief FSCTL_SET_INTEGRITY_INFORMATION 的输入。
+	///
+	typedef struct FSCTL_SET_INTEGRITY_INFORMATION_BUFFER
+	{
+		WORD ChecksumAlgorithm;
+		WORD Reserved;
+		DWORD Flags;
+	} FSCTL_SET_INTEGRITY_INFORMATION_BUFFER, *PFSCTL_SET_INTEGRITY_INFORMATION_BUFFER;
+
+} // namespace msys
@@ -0,0 +1,159 @@
+#include "DirectoryBatchEnumerator.h"
+#include "base/filesystem/filesystem.h"
+#include "base/string/define.h"
+#include "msys-base/REPARSE_DATA_BUFFER.h"
+#include "msys-base/win32_error.h"
+#include <stdexcept>
+
+namespace
+{
+	///
+	/// @brief 一批的缓冲区大小。
+	///
+	int64_t constexpr BatchBufferSize = 1024 * 64;
+
+	msys::DirectoryEntryType GetEntryType(uint32_t attributes, uint32_t reparse_tag)
+	{
+		if (attributes & FILE_ATTRIBUTE_REPARSE_POINT)
+		{
+			if (reparse_tag == static_cast<DWORD>(IO_REPARSE_TAG_SYMLINK))
+			{
+				return msys::DirectoryEntryType::SymbolicLink;
+			}
+
+			if (reparse_tag == static_cast<DWORD>(IO_REPARSE_TAG_MOUNT_POINT))
+			{
+				return msys::DirectoryEntryType::Other;
+			}
+		}
+
+		if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			return msys::DirectoryEntryType::Directory;
+		}
+
+		return msys::DirectoryEntryType::RegularFile;
+	}
+
+} // namespace
+
+msys::DirectoryBatchEnumerator::DirectoryBatchEnumerator(base::Path const &path)
+	: _buffer(BatchBufferSize, 8)
+{
+	std::string path_string = path.ToString();
+
+	if (path_string == "")
+	{
+		path_string = "./";
+	}
+
+	_handle = CreateFileA(base::filesystem::ToWindowsLongPathString(path_string).c_str(),
+						  FILE_LIST_DIRECTORY,
+						  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+						  nullptr,
+						  OPEN_EXISTING,
+						  FILE_FLAG_BACKUP_SEMANTICS,
+						  nullptr);
+
+	if (_handle == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error{CODE_POS_STR + std::format("打开目录 {} 失败。", path_string) + msys::FormatError(GetLastError())};
+	}
+}
+
+msys::DirectoryBatchEnumerator::~DirectoryBatchEnumerator()
+{
+	if (_handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_handle);
+		_handle = INVALID_HANDLE_VALUE;
+	}
+}
+
+bool msys::DirectoryBatchEnumerator::ReadBatch()
+{
+	if (GetFileInformationByHandleEx(_handle,
+									 FileFullDirectoryInfo,
+									 _buffer.Buffer(),
+									 static_cast<DWORD>(_buffer.Size())))
+	{
+		_next_offset = 0;
+		return true;
+	}
+
+	DWORD error = GetLastError();
+
+	if (error == ERROR_NO_MORE_FILES)
+	{
+		return false;
+	}
+
+	throw std::runtime_error{CODE_POS_STR + "枚举目录失败。" + msys::FormatError(error)};
+}
+
+bool msys::DirectoryBatchEnumerator::MoveNext()
+{
+	while (!_is_end)
+	{
+		if (_next_offset < 0 && !ReadBatch())
+		{
+			_is_end = true;
+			_current = msys::DirectoryBatchEntry{};
+			return false;
+		}
+
+		FILE_FULL_DIR_INFO const *info = reinterpret_cast<FILE_FULL_DIR_INFO const *>(_buffer.Buffer() + _next_offset);
+
+		if (info->NextEntryOffset == 0)
+		{
+			// 这一批的最后一个条目。
+			_next_offset = -1;
+		}
+		else
+		{
+			_next_offset += info->NextEntryOffset;
+		}
+
+		std::wstring_view name{info->FileName, info->FileNameLength / sizeof(WCHAR)};
+
+		if (name == L"." || name == L"..")
+		{
+			continue;
+		}
+
+		_current.name = name;
+		_current.attributes = info->FileAttributes;
+
+		// 重分析点的标记放在 EaSize 中。
+		_current.reparse_tag = (info->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) ? info->EaSize : 0;
+		_current.type = GetEntryType(_current.attributes, _current.reparse_tag);
+		_current.size = _current.type == msys::DirectoryEntryType::Directory ? 0 : info->EndOfFile.QuadPart;
+		_current.last_write_time = info->LastWriteTime.QuadPart;
+		_narrow_name_valid = false;
+		return true;
+	}
+
+	return false;
+}
+
+std::string const &msys::DirectoryBatchEnumerator::CurrentNarrowName()
+{
+	if (_narrow_name_valid)
+	{
+		return _narrow_name;
+	}
+
+	int length = static_cast<int>(_current.name.size());
+	int size = WideCharToMultiByte(CP_ACP, 0, _current.name.data(), length, nullptr, 0, nullptr, nullptr);
+
+	if (size <= 0 && length > 0)
+	{
+		throw std::runtime_error{CODE_POS_STR + "路径编码转换失败。" + msys::FormatError(GetLastError())};
+	}
+
+	// resize 不会缩小容量，名称长度稳定后不再分配内存。
+	_narrow_name.resize(size);
+	WideCharToMultiByte(CP_ACP, 0, _current.name.data(), length, _narrow_name.data(), size, nullptr, nullptr);
+	_narrow_name_valid = true;
+	return _narrow_name;
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include "msys-base/AlignedBuffer.h"
+#include "msys-base/DirectorySnapshot.h"
+#include "msys-base/windows_api.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace msys
+{
+	///
+	/// @brief 批量枚举得到的一个目录条目。
+	///
+	/// @note name 指向枚举器的批次缓冲区，只在枚举器前进之前有效。
+	///
+	class DirectoryBatchEntry
+	{
+	public:
+		///
+		/// @brief 条目名称，不含目录部分。
+		///
+		std::wstring_view name;
+
+		msys::DirectoryEntryType type = msys::DirectoryEntryType::Other;
+
+		///
+		/// @brief 文件大小。目录为 0.
+		///
+		int64_t size = 0;
+
+		///
+		/// @brief 最后修改时间。FILETIME 的值，单位是 100 纳秒。
+		///
+		int64_t last_write_time = 0;
+
+		///
+		/// @brief FILE_ATTRIBUTE_* 属性。
+		///
+		uint32_t attributes = 0;
+
+		///
+		/// @brief 重分析点标记。不是重分析点则为 0.
+		///
+		uint32_t reparse_tag = 0;
+	};
+
+	///
+	/// @brief 不分配内存的目录枚举器。
+	///
+	/// @note 用 GetFileInformationByHandleEx(FileFullDirectoryInfo) 一次读取一整批条目到 64 KiB 的缓冲区，
+	/// 条目直接在缓冲区上解析。条目的类型、大小、修改时间都来自枚举结果，不需要再访问文件系统。
+	///
+	/// @note 当前条目只有一个，每次前进时原地覆盖。名称是指向缓冲区的视图，需要多字节字符串时调用
+	/// CurrentNarrowName, 转换结果放在一个复用的缓冲区中。
+	///
+	class DirectoryBatchEnumerator
+	{
+	private:
+		HANDLE _handle = INVALID_HANDLE_VALUE;
+		base::AlignedBuffer _buffer;
+
+		///
+		/// @brief 当前批次中下一个条目的偏移量。为 -1 时需要读取下一批。
+		///
+		int64_t _next_offset = -1;
+
+		bool _is_end = false;
+		msys::DirectoryBatchEntry _current;
+
+		std::string _narrow_name;
+		bool _narrow_name_valid = false;
+
+		///
+		/// @brief 读取下一批。
+		///
+		/// @return 没有更多条目时返回 false.
+		///
+		bool ReadBatch();
+
+	public:
+		///
+		/// @brief 打开目录。构造后需要调用 MoveNext 移到第一个条目。
+		///
+		/// @param path
+		///
+		DirectoryBatchEnumerator(base::Path const &path);
+
+		~DirectoryBatchEnumerator();
+
+		DirectoryBatchEnumerator(DirectoryBatchEnumerator const &) = delete;
+		DirectoryBatchEnumerator &operator=(DirectoryBatchEnumerator const &) = delete;
+
+		///
+		/// @brief 移到下一个条目。跳过 . 和 ..
+		///
+		/// @return 没有更多条目时返回 false.
+		///
+		bool MoveNext();
+
+		///
+		/// @brief 是否已经枚举完。
+		///
+		/// @return
+		///
+		bool IsEnd() const
+		{
+			return _is_end;
+		}
+
+		///
+		/// @brief 当前条目。
+		///
+		/// @return
+		///
+		msys::DirectoryBatchEntry const &Current() const
+		{
+			return _current;
+		}
+
+		///
+		/// @brief 当前条目名称的多字节字符串。同一个条目只转换一次。
+		///
+		/// @return 引用在枚举器前进之前有效。
+		///
+		std::string const &CurrentNarrowName();
+	};
+
+} // namespace msys
@@ -0,0 +1,349 @@
+#include "DirectoryChangeMonitor.h"
+#include "base/filesystem/filesystem.h"
+#include "base/string/define.h"
+#include "msys-base/IoCompletionPort.h"
+#include "msys-base/win32_error.h"
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	///
+	/// @brief 缓冲区字节数。监视网络共享时不能超过 64 KiB.
+	///
+	size_t constexpr NotifyBufferSize = 1024 * 64;
+
+	DWORD constexpr NotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME |
+								   FILE_NOTIFY_CHANGE_DIR_NAME |
+								   FILE_NOTIFY_CHANGE_ATTRIBUTES |
+								   FILE_NOTIFY_CHANGE_SIZE |
+								   FILE_NOTIFY_CHANGE_LAST_WRITE |
+								   FILE_NOTIFY_CHANGE_CREATION;
+
+	///
+	/// @brief 把通知中的相对路径转换为 / 分隔的多字节字符串。
+	///
+	std::string ToRelativePath(WCHAR const *name, int length)
+	{
+		int size = WideCharToMultiByte(CP_ACP, 0, name, length, nullptr, 0, nullptr, nullptr);
+
+		if (size <= 0)
+		{
+			throw std::runtime_error{CODE_POS_STR + "路径编码转换失败。" + msys::FormatError(GetLastError())};
+		}
+
+		std::string ret(size, '\0');
+		WideCharToMultiByte(CP_ACP, 0, name, length, ret.data(), size, nullptr, nullptr);
+
+		for (char &c : ret)
+		{
+			if (c == '\\')
+			{
+				c = '/';
+			}
+		}
+
+		return ret;
+	}
+
+	msys::DirectoryChangeType ToChangeType(DWORD action)
+	{
+		switch (action)
+		{
+		case FILE_ACTION_ADDED:
+			{
+				return msys::DirectoryChangeType::Added;
+			}
+		case FILE_ACTION_REMOVED:
+			{
+				return msys::DirectoryChangeType::Removed;
+			}
+		case FILE_ACTION_RENAMED_OLD_NAME:
+			{
+				return msys::DirectoryChangeType::RenamedOldName;
+			}
+		case FILE_ACTION_RENAMED_NEW_NAME:
+			{
+				return msys::DirectoryChangeType::RenamedNewName;
+			}
+		case FILE_ACTION_MODIFIED:
+		default:
+			{
+				return msys::DirectoryChangeType::Modified;
+			}
+		}
+	}
+
+} // namespace
+
+msys::DirectoryChangeMonitor::DirectoryChangeMonitor(msys::DirectoryChangeCallback callback)
+	: _callback(std::move(callback))
+{
+	if (_callback == nullptr)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "callback 不能为空。"};
+	}
+}
+
+msys::DirectoryChangeMonitor::~DirectoryChangeMonitor()
+{
+	std::map<int64_t, std::shared_ptr<Watch>> watches;
+
+	{
+		std::lock_guard l{_lock};
+		watches.swap(_watches);
+	}
+
+	for (auto &pair : watches)
+	{
+		Stop(pair.second);
+	}
+}
+
+DWORD msys::DirectoryChangeMonitor::Read(std::shared_ptr<Watch> const &watch)
+{
+	msys::IoCompletionPort::Operation *operation = new msys::IoCompletionPort::Operation{
+		0,
+		[this, watch](DWORD bytes, DWORD error)
+		{
+			OnCompleted(watch, bytes, error);
+		},
+	};
+
+	BOOL call_result = ReadDirectoryChangesW(watch->handle,
+											 watch->buffer.data(),
+											 static_cast<DWORD>(watch->buffer.size() * sizeof(DWORD)),
+											 TRUE,
+											 NotifyFilter,
+											 nullptr,
+											 operation,
+											 nullptr);
+
+	if (!call_result)
+	{
+		DWORD error = GetLastError();
+
+		if (error != ERROR_IO_PENDING)
+		{
+			// 没有发起成功，不会有完成包。
+			delete operation;
+			return error;
+		}
+	}
+
+	watch->reading = true;
+	return ERROR_SUCCESS;
+}
+
+void msys::DirectoryChangeMonitor::OnCompleted(std::shared_ptr<Watch> const &watch, DWORD bytes, DWORD error)
+{
+	std::vector<msys::DirectoryChange> changes;
+
+	if (error == ERROR_SUCCESS && bytes > 0)
+	{
+		// 先解析，下一次读取会覆盖缓冲区。
+		uint8_t const *position = reinterpret_cast<uint8_t const *>(watch->buffer.data());
+
+		try
+		{
+			while (true)
+			{
+				FILE_NOTIFY_INFORMATION const *info = reinterpret_cast<FILE_NOTIFY_INFORMATION const *>(position);
+
+				msys::DirectoryChange change{};
+				change.type = ToChangeType(info->Action);
+
+				change.path = watch->root + base::Path{ToRelativePath(info->FileName,
+																	   static_cast<int>(info->FileNameLength / sizeof(WCHAR)))};
+
+				changes.push_back(std::move(change));
+
+				if (info->NextEntryOffset == 0)
+				{
+					break;
+				}
+
+				position += info->NextEntryOffset;
+			}
+		}
+		catch (...)
+		{
+			// 名称转换失败。异常不能离开这里，否则 reading 不会被清除，Stop 会一直等待。
+			// 不知道丢了哪些变化，按溢出处理。
+			changes.clear();
+			changes.push_back(msys::DirectoryChange{msys::DirectoryChangeType::Overflow, watch->root});
+		}
+	}
+	else if (error != ERROR_OPERATION_ABORTED)
+	{
+		// 字节数为 0 或 ERROR_NOTIFY_ENUM_DIR 表示缓冲区溢出，变化丢失了。
+		changes.push_back(msys::DirectoryChange{msys::DirectoryChangeType::Overflow, watch->root});
+	}
+
+	{
+		std::lock_guard l{_lock};
+		watch->reading = false;
+
+		if (watch->stopping || error == ERROR_OPERATION_ABORTED)
+		{
+			_condition.notify_all();
+			return;
+		}
+
+		bool should_continue = error == ERROR_SUCCESS || error == ERROR_NOTIFY_ENUM_DIR;
+
+		if (!should_continue || Read(watch) != ERROR_SUCCESS)
+		{
+			// 目录被删除等原因导致无法继续监视。
+			watch->stopping = true;
+
+			if (changes.empty() || changes.back().type != msys::DirectoryChangeType::Overflow)
+			{
+				changes.push_back(msys::DirectoryChange{msys::DirectoryChangeType::Overflow, watch->root});
+			}
+
+			_condition.notify_all();
+		}
+
+		// 读取已经重新发起，下一批可能在另一个线程上先到。入队的顺序就是读取的顺序，
+		// 队列原来为空时由本线程负责交付，否则交给正在交付的线程。
+		watch->pending.push_back(std::move(changes));
+		watch->dispatching++;
+
+		if (watch->dispatching > 1)
+		{
+			return;
+		}
+	}
+
+	Dispatch(watch);
+}
+
+void msys::DirectoryChangeMonitor::Dispatch(std::shared_ptr<Watch> const &watch)
+{
+	while (true)
+	{
+		std::vector<msys::DirectoryChange> changes;
+
+		{
+			// 停止时也交付完已经入队的批次，其中可能有表示监视中断的 Overflow. Stop 会等待交付结束。
+			std::lock_guard l{_lock};
+			changes = std::move(watch->pending.front());
+			watch->pending.pop_front();
+		}
+
+		try
+		{
+			_callback(changes);
+		}
+		catch (...)
+		{
+		}
+
+		{
+			std::lock_guard l{_lock};
+			watch->dispatching--;
+
+			if (watch->dispatching == 0)
+			{
+				break;
+			}
+		}
+	}
+
+	_condition.notify_all();
+}
+
+void msys::DirectoryChangeMonitor::Stop(std::shared_ptr<Watch> const &watch)
+{
+	{
+		std::unique_lock l{_lock};
+		watch->stopping = true;
+
+		if (watch->reading)
+		{
+			CancelIoEx(watch->handle, nullptr);
+		}
+
+		_condition.wait(l, [&watch]()
+						{
+							return !watch->reading && watch->dispatching == 0;
+						});
+	}
+
+	CloseHandle(watch->handle);
+	watch->handle = INVALID_HANDLE_VALUE;
+}
+
+int64_t msys::DirectoryChangeMonitor::AddWatch(base::Path const &root)
+{
+	HANDLE handle = CreateFileA(base::filesystem::ToWindowsLongPathString(root).c_str(),
+								FILE_LIST_DIRECTORY,
+								FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+								nullptr,
+								OPEN_EXISTING,
+								FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+								nullptr);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error{CODE_POS_STR + std::format("打开目录 {} 失败。", root.ToString()) + msys::FormatError(GetLastError())};
+	}
+
+	std::shared_ptr<msys::IoCompletionPort> port;
+
+	{
+		std::lock_guard l{_lock};
+
+		if (_port == nullptr)
+		{
+			_port = msys::IoCompletionPort::SharedInstance();
+		}
+
+		port = _port;
+	}
+
+	if (!port->Associate(handle))
+	{
+		CloseHandle(handle);
+		throw std::runtime_error{CODE_POS_STR + "无法将目录句柄关联到完成端口。"};
+	}
+
+	std::shared_ptr<Watch> watch{new Watch{}};
+	watch->root = root;
+	watch->handle = handle;
+	watch->buffer.resize(NotifyBufferSize / sizeof(DWORD));
+
+	std::lock_guard l{_lock};
+	DWORD error = Read(watch);
+
+	if (error != ERROR_SUCCESS)
+	{
+		CloseHandle(handle);
+		throw std::runtime_error{CODE_POS_STR + std::format("监视目录 {} 失败。", root.ToString()) + msys::FormatError(error)};
+	}
+
+	int64_t id = _next_id++;
+	_watches[id] = watch;
+	return id;
+}
+
+void msys::DirectoryChangeMonitor::RemoveWatch(int64_t id)
+{
+	std::shared_ptr<Watch> watch;
+
+	{
+		std::lock_guard l{_lock};
+		auto it = _watches.find(id);
+
+		if (it == _watches.end())
+		{
+			return;
+		}
+
+		watch = it->second;
+		_watches.erase(it);
+	}
+
+	Stop(watch);
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include "msys-base/IoCompletionPort.h"
+#include "msys-base/windows_api.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace msys
+{
+	///
+	/// @brief 目录变化的类型。
+	///
+	enum class DirectoryChangeType
+	{
+		Added,
+		Removed,
+		Modified,
+		RenamedOldName,
+		RenamedNewName,
+
+		///
+		/// @brief 变化太多，缓冲区溢出，或者监视出错停止了。path 是监视的根目录，
+		/// 根目录下任何条目都可能变了。
+		///
+		Overflow,
+	};
+
+	///
+	/// @brief 一个目录变化。
+	///
+	class DirectoryChange
+	{
+	public:
+		msys::DirectoryChangeType type = msys::DirectoryChangeType::Modified;
+
+		///
+		/// @brief 发生变化的条目的完整路径。
+		///
+		base::Path path;
+	};
+
+	///
+	/// @brief 变化回调。参数是一次 ReadDirectoryChangesW 读到的所有变化，按发生顺序排列。
+	///
+	using DirectoryChangeCallback = std::function<void(std::vector<msys::DirectoryChange> const &)>;
+
+	///
+	/// @brief 用 ReadDirectoryChangesW 递归监视目录树。
+	///
+	/// @note 每个被监视的目录用 FILE_FLAG_OVERLAPPED 打开并关联到 msys::IoCompletionPort,
+	/// 读取在完成端口的线程上完成，不需要专门的线程。读到变化后先发起下一次读取，再调用回调。
+	///
+	/// @note 完成端口有多个线程，下一次读取可能在回调返回前就在另一个线程上完成。同一个目录的批次
+	/// 进入队列，由一个线程按读取的顺序逐个交给回调，回调不会对同一个目录并发调用。
+	///
+	/// @note 回调在完成端口的线程上调用，不能在回调中调用 RemoveWatch 或析构本对象。
+	///
+	class DirectoryChangeMonitor
+	{
+	private:
+		///
+		/// @brief 一个被监视的目录。
+		///
+		class Watch
+		{
+		public:
+			base::Path root;
+			HANDLE handle = INVALID_HANDLE_VALUE;
+
+			///
+			/// @brief 接收 FILE_NOTIFY_INFORMATION 的缓冲区。要求 DWORD 对齐。
+			///
+			std::vector<DWORD> buffer;
+
+			///
+			/// @brief 有一次读取还没完成。
+			///
+			bool reading = false;
+
+			///
+			/// @brief 还没交付完的批次数，包括正在交给回调的那一个。不为 0 时有一个线程在交付。
+			///
+			int64_t dispatching = 0;
+
+			///
+			/// @brief 等待交付的批次。按读取的顺序排列。
+			///
+			std::deque<std::vector<msys::DirectoryChange>> pending;
+
+			bool stopping = false;
+		};
+
+		///
+		/// @brief 第一次添加监视时获取。最先声明，最后析构，停止监视时完成端口还在。
+		///
+		std::shared_ptr<msys::IoCompletionPort> _port;
+
+		msys::DirectoryChangeCallback _callback;
+
+		std::mutex _lock;
+		std::condition_variable _condition;
+		std::map<int64_t, std::shared_ptr<Watch>> _watches;
+		int64_t _next_id = 1;
+
+		///
+		/// @brief 发起一次读取。要在持有 _lock 时调用，这样停止时的 CancelIoEx 不会落在发起之前。
+		///
+		/// @return 发起失败返回错误代码，成功返回 ERROR_SUCCESS.
+		///
+		DWORD Read(std::shared_ptr<Watch> const &watch);
+
+		void OnCompleted(std::shared_ptr<Watch> const &watch, DWORD bytes, DWORD error);
+
+		///
+		/// @brief 按顺序把队列中的批次交给回调，直到队列为空。由让 dispatching 从 0 变为 1 的线程调用。
+		///
+		void Dispatch(std::shared_ptr<Watch> const &watch);
+
+		///
+		/// @brief 取消读取，等待取消完成、回调返回后关闭句柄。
+		///
+		void Stop(std::shared_ptr<Watch> const &watch);
+
+	public:
+		DirectoryChangeMonitor(msys::DirectoryChangeCallback callback);
+
+		///
+		/// @brief 停止所有监视。
+		///
+		~DirectoryChangeMonitor();
+
+		DirectoryChangeMonitor(DirectoryChangeMonitor const &) = delete;
+		DirectoryChangeMonitor &operator=(DirectoryChangeMonitor const &) = delete;
+
+		///
+		/// @brief 开始递归监视 root.
+		///
+		/// @param root
+		///
+		/// @return 监视的 ID, 用来停止监视。
+		///
+		int64_t AddWatch(base::Path const &root);
+
+		///
+		/// @brief 停止监视。返回后不会再为这个目录调用回调。
+		///
+		/// @param id
+		///
+		void RemoveWatch(int64_t id);
+	};
+
+} // namespace msys
@@ -2,7 +2,7 @@
 #include "base/container/iterator/IEnumerator.h"
 #include "base/filesystem/filesystem.h"
 #include "base/filesystem/Path.h"
-#include <filesystem>
+#include "msys-base/DirectoryBatchEnumerator.h"
 #include <string>
 #include <unistd.h>
 #include <windows.h>
@@ -12,17 +12,30 @@ namespace msys
 	///
 	/// @brief 目录条目迭代器。
 	///
+	/// @note 底层是 msys::DirectoryBatchEnumerator, 条目成批读取。base::filesystem::DirectoryEntry
+	/// 只在第一次调用 CurrentValue 时构造，同一个位置不会重复构造。只需要类型、大小、修改时间时
+	/// 用 CurrentBatchEntry, 不构造路径也不访问文件系统。
+	///
 	class DirectoryEntryEnumerator :
 		public base::IEnumerator<base::filesystem::DirectoryEntry const>
 	{
 	private:
+		msys::DirectoryBatchEnumerator _enumerator;
+
+		///
+		/// @brief 目录的 Windows 长路径加上分隔符。拼接当前条目的路径时复用。
+		///
+		std::string _path_buffer;
+
+		size_t _directory_length = 0;
+
 		base::filesystem::DirectoryEntry _current;
-		std::filesystem::directory_iterator _current_it;
-		std::filesystem::directory_iterator _end_it;
+		bool _current_valid = false;
 		base::IEnumerator<base::filesystem::DirectoryEntry const>::Context_t _context{};
 
 	public:
 		DirectoryEntryEnumerator(base::Path const &path)
+			: _enumerator(path)
 		{
 			std::string path_str = path.ToString();
 			if (path_str == "")
@@ -30,7 +43,15 @@ namespace msys
 				path_str = "./";
 			}
 
-			_current_it = std::filesystem::directory_iterator{base::filesystem::ToWindowsLongPathString(path_str)};
+			_path_buffer = base::filesystem::ToWindowsLongPathString(path_str);
+
+			if (_path_buffer.empty() || _path_buffer.back() != '\\')
+			{
+				_path_buffer += '\\';
+			}
+
+			_directory_length = _path_buffer.size();
+			_enumerator.MoveNext();
 		}
 
 		///
@@ -40,7 +61,7 @@ namespace msys
 		///
 		virtual bool IsEnd() const override
 		{
-			return _current_it == _end_it;
+			return _enumerator.IsEnd();
 		}
 
 		///
@@ -50,17 +71,35 @@ namespace msys
 		///
 		virtual base::filesystem::DirectoryEntry const &CurrentValue() override
 		{
-			_current = base::filesystem::DirectoryEntry{base::filesystem::WindowsLongPathStringToPath(_current_it->path().string())};
+			if (!_current_valid)
+			{
+				_path_buffer.resize(_directory_length);
+				_path_buffer += _enumerator.CurrentNarrowName();
+				_current = base::filesystem::DirectoryEntry{base::filesystem::WindowsLongPathStringToPath(_path_buffer)};
+				_current_valid = true;
+			}
+
 			return _current;
 		}
 
+		///
+		/// @brief 当前条目的名称、类型、大小和修改时间。
+		///
+		/// @return 引用在迭代器前进之前有效。
+		///
+		msys::DirectoryBatchEntry const &CurrentBatchEntry() const
+		{
+			return _enumerator.Current();
+		}
+
 		///
 		/// @brief 递增迭代器的位置。
 		///
 		///
 		virtual void Add() override
 		{
-			++_current_it;
+			_enumerator.MoveNext();
+			_current_valid = false;
 		}
 
 		///
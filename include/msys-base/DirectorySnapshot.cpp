@@ -0,0 +1,210 @@
+#include "DirectorySnapshot.h"
+#include "base/filesystem/filesystem.h"
+#include "base/string/define.h"
+#include "msys-base/HandleGuard.h"
+#include "msys-base/REPARSE_DATA_BUFFER.h"
+#include "msys-base/win32_error.h"
+#include "msys-base/windows_api.h"
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+	msys::DirectoryEntryInfo CreateEntryInfo(WIN32_FIND_DATAA const &data)
+	{
+		msys::DirectoryEntryInfo info{};
+		info.attributes = data.dwFileAttributes;
+		info.size = (static_cast<int64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+
+		info.last_write_time = (static_cast<int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+							   data.ftLastWriteTime.dwLowDateTime;
+
+		bool is_directory = data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
+
+		if (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+		{
+			// 重分析点的标记在 dwReserved0 中。
+			if (data.dwReserved0 == static_cast<DWORD>(IO_REPARSE_TAG_SYMLINK))
+			{
+				info.type = msys::DirectoryEntryType::SymbolicLink;
+				return info;
+			}
+
+			if (data.dwReserved0 == static_cast<DWORD>(IO_REPARSE_TAG_MOUNT_POINT))
+			{
+				info.type = msys::DirectoryEntryType::Other;
+				return info;
+			}
+
+			// 云文件、重复数据删除等重分析点，对使用者来说仍然是普通的文件或目录。
+		}
+
+		info.type = is_directory ? msys::DirectoryEntryType::Directory : msys::DirectoryEntryType::RegularFile;
+		return info;
+	}
+
+} // namespace
+
+bool msys::ForEachDirectoryEntry(std::string const &path, msys::DirectoryEntryCallback const &callback)
+{
+	WIN32_FIND_DATAA data{};
+
+	HANDLE h = FindFirstFileExA((path + "\\*").c_str(),
+								FindExInfoBasic,
+								&data,
+								FindExSearchNameMatch,
+								nullptr,
+								FIND_FIRST_EX_LARGE_FETCH);
+
+	if (h == INVALID_HANDLE_VALUE)
+	{
+		DWORD error = GetLastError();
+
+		if (error == ERROR_FILE_NOT_FOUND)
+		{
+			// 连 . 和 .. 都没有，例如某些卷的根目录。
+			return true;
+		}
+
+		throw std::runtime_error{CODE_POS_STR + std::format("枚举 {} 失败。", path) + msys::FormatError(error)};
+	}
+
+	msys::FindHandleGuard g{h};
+
+	do
+	{
+		std::string_view name = data.cFileName;
+
+		if (name == "." || name == "..")
+		{
+			continue;
+		}
+
+		if (!callback(data))
+		{
+			return false;
+		}
+	} while (FindNextFileA(h, &data));
+
+	DWORD error = GetLastError();
+
+	if (error != ERROR_NO_MORE_FILES)
+	{
+		throw std::runtime_error{CODE_POS_STR + std::format("枚举 {} 失败。", path) + msys::FormatError(error)};
+	}
+
+	return true;
+}
+
+void msys::EnumerateDirectoryTree(base::Path const &root, msys::DirectoryTreeCallback const &callback)
+{
+	// 用显式的栈代替递归，目录很深时也不会栈溢出。
+	std::vector<std::string> pending_directories{""};
+
+	while (!pending_directories.empty())
+	{
+		std::string relative_directory = std::move(pending_directories.back());
+		pending_directories.pop_back();
+
+		base::Path directory = root;
+
+		if (relative_directory != "")
+		{
+			directory = root + base::Path{relative_directory};
+		}
+
+		bool completed = msys::ForEachDirectoryEntry(base::filesystem::ToWindowsLongPathString(directory),
+													 [&](WIN32_FIND_DATAA const &data)
+													 {
+														 std::string name = data.cFileName;
+														 std::string relative_path = relative_directory == "" ? name : relative_directory + "/" + name;
+														 msys::DirectoryEntryInfo info = CreateEntryInfo(data);
+
+														 if (!callback(relative_path, info))
+														 {
+															 return false;
+														 }
+
+														 if (info.type == msys::DirectoryEntryType::Directory)
+														 {
+															 pending_directories.push_back(std::move(relative_path));
+														 }
+
+														 return true;
+													 });
+
+		if (!completed)
+		{
+			return;
+		}
+	}
+}
+
+std::wstring msys::ToPathKey(std::string const &path)
+{
+	if (path.empty())
+	{
+		return std::wstring{};
+	}
+
+	int size = MultiByteToWideChar(CP_ACP, 0, path.data(), static_cast<int>(path.size()), nullptr, 0);
+	std::wstring key(size, L'\0');
+	MultiByteToWideChar(CP_ACP, 0, path.data(), static_cast<int>(path.size()), key.data(), size);
+	CharUpperBuffW(key.data(), static_cast<DWORD>(key.size()));
+	return key;
+}
+
+/* #region DirectorySnapshot */
+
+msys::DirectorySnapshot::DirectorySnapshot(base::Path const &root)
+{
+	_enumerated_directories.insert(std::wstring{});
+
+	msys::EnumerateDirectoryTree(root,
+								 [this](std::string const &relative_path, msys::DirectoryEntryInfo const &info)
+								 {
+									 std::wstring key = msys::ToPathKey(relative_path);
+
+									 if (info.type == msys::DirectoryEntryType::Directory)
+									 {
+										 // EnumerateDirectoryTree 会进入每个目录。
+										 _enumerated_directories.insert(key);
+									 }
+
+									 _entries[std::move(key)] = info;
+									 return true;
+								 });
+}
+
+msys::DirectoryEntryInfo const *msys::DirectorySnapshot::Find(std::string const &relative_path) const
+{
+	auto it = _entries.find(msys::ToPathKey(relative_path));
+
+	if (it == _entries.end())
+	{
+		return nullptr;
+	}
+
+	return &it->second;
+}
+
+bool msys::DirectorySnapshot::ContainsDirectoryOf(std::string const &relative_path) const
+{
+	size_t index = relative_path.rfind('/');
+	std::string parent = index == std::string::npos ? std::string{} : relative_path.substr(0, index);
+	return _enumerated_directories.contains(msys::ToPathKey(parent));
+}
+
+void msys::DirectorySnapshot::AddEmptyDirectory(std::string const &relative_path)
+{
+	msys::DirectoryEntryInfo info{};
+	info.type = msys::DirectoryEntryType::Directory;
+	info.attributes = FILE_ATTRIBUTE_DIRECTORY;
+
+	std::wstring key = msys::ToPathKey(relative_path);
+	_enumerated_directories.insert(key);
+	_entries[std::move(key)] = info;
+}
+
+/* #endregion */
@@ -0,0 +1,168 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include "msys-base/windows_api.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace msys
+{
+	///
+	/// @brief 枚举目录时得到的条目类型。
+	///
+	enum class DirectoryEntryType
+	{
+		RegularFile,
+		Directory,
+		SymbolicLink,
+
+		///
+		/// @brief 目录交接点等其他重分析点。
+		///
+		Other,
+	};
+
+	///
+	/// @brief 枚举目录时顺便得到的条目信息。
+	///
+	class DirectoryEntryInfo
+	{
+	public:
+		msys::DirectoryEntryType type = msys::DirectoryEntryType::Other;
+
+		///
+		/// @brief 文件大小。目录为 0.
+		///
+		int64_t size = 0;
+
+		///
+		/// @brief 最后修改时间。FILETIME 的值，单位是 100 纳秒。
+		///
+		int64_t last_write_time = 0;
+
+		///
+		/// @brief FILE_ATTRIBUTE_* 属性。
+		///
+		uint32_t attributes = 0;
+	};
+
+	///
+	/// @brief 枚举直接子条目的回调。参数是 FindFirstFileExA 得到的条目数据。返回 false 停止枚举。
+	///
+	using DirectoryEntryCallback = std::function<bool(WIN32_FIND_DATAA const &)>;
+
+	///
+	/// @brief 用 FindFirstFileExA 枚举目录中的直接子条目，跳过 . 和 ..
+	///
+	/// @note 带上 FIND_FIRST_EX_LARGE_FETCH, 每次系统调用取回尽量多的条目。
+	///
+	/// @param path Windows 长路径。
+	/// @param callback
+	///
+	/// @return 被回调停止时返回 false.
+	///
+	bool ForEachDirectoryEntry(std::string const &path, msys::DirectoryEntryCallback const &callback);
+
+	///
+	/// @brief 枚举回调。
+	///
+	/// @note 参数是相对于根目录的路径和条目信息。路径用 / 分隔。
+	/// @note 返回 false 停止枚举。
+	///
+	using DirectoryTreeCallback = std::function<bool(std::string const &, msys::DirectoryEntryInfo const &)>;
+
+	///
+	/// @brief 用 FindFirstFileExA 递归枚举目录树。类型、大小、修改时间都来自枚举结果，
+	/// 不会对每个条目再访问文件系统。
+	///
+	/// @note 目录总是在它里面的条目之前回调。
+	/// @note 不会进入符号链接和目录交接点。
+	///
+	/// @param root 根目录。
+	/// @param callback
+	///
+	void EnumerateDirectoryTree(base::Path const &root, msys::DirectoryTreeCallback const &callback);
+
+	///
+	/// @brief 把路径转为用作哈希表键的字符串。Windows 的路径不区分大小写，键统一转为大写。
+	///
+	/// @param path
+	///
+	/// @return
+	///
+	std::wstring ToPathKey(std::string const &path);
+
+	///
+	/// @brief 目录树元数据的快照。一次批量枚举得到，之后的查询都在内存中完成。
+	///
+	/// @note 快照不会随文件系统更新。
+	///
+	class DirectorySnapshot
+	{
+	private:
+		///
+		/// @brief 键是规范化之后的相对路径。
+		///
+		std::unordered_map<std::wstring, msys::DirectoryEntryInfo> _entries;
+
+		///
+		/// @brief 已经完整枚举过的目录。根目录是空字符串。
+		///
+		std::unordered_set<std::wstring> _enumerated_directories;
+
+	public:
+		///
+		/// @brief 空快照。
+		///
+		DirectorySnapshot() = default;
+
+		///
+		/// @brief 枚举 root 下的整个目录树，生成快照。
+		///
+		/// @param root
+		///
+		DirectorySnapshot(base::Path const &root);
+
+		///
+		/// @brief 查找条目。
+		///
+		/// @param relative_path 相对于根目录的路径，用 / 分隔。
+		///
+		/// @return 快照中没有则返回 nullptr.
+		///
+		msys::DirectoryEntryInfo const *Find(std::string const &relative_path) const;
+
+		///
+		/// @brief 快照是否完整记录了 relative_path 所在的目录。
+		///
+		/// @note 记录了的话，Find 返回 nullptr 就说明条目确实不存在。没有记录的话，
+		/// 例如位于符号链接指向的目录中，条目是否存在只能去文件系统中确认。
+		///
+		/// @param relative_path
+		///
+		/// @return
+		///
+		bool ContainsDirectoryOf(std::string const &relative_path) const;
+
+		///
+		/// @brief 记录一个刚创建的空目录。之后它里面的条目用 Find 查不到就说明不存在，
+		/// 不需要去文件系统中确认。
+		///
+		/// @param relative_path 相对于根目录的路径，用 / 分隔。
+		///
+		void AddEmptyDirectory(std::string const &relative_path);
+
+		///
+		/// @brief 条目数。
+		///
+		/// @return
+		///
+		int64_t Count() const
+		{
+			return static_cast<int64_t>(_entries.size());
+		}
+	};
+
+} // namespace msys
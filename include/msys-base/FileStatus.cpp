@@ -0,0 +1,215 @@
+#include "FileStatus.h"
+#include "base/filesystem/filesystem.h"
+#include "base/string/define.h"
+#include "msys-base/HandleGuard.h"
+#include "msys-base/REPARSE_DATA_BUFFER.h"
+#include "msys-base/win32_error.h"
+#include "msys-base/windows_api.h"
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	int64_t ToInt64(FILETIME const &time)
+	{
+		return (static_cast<int64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+	}
+
+	///
+	/// @brief 错误代码表示路径不存在。
+	///
+	bool IsNotFoundError(DWORD error)
+	{
+		return error == ERROR_FILE_NOT_FOUND ||
+			   error == ERROR_PATH_NOT_FOUND ||
+			   error == ERROR_INVALID_NAME ||
+			   error == ERROR_DIRECTORY;
+	}
+
+	msys::FileType GetFileType(uint32_t attributes, uint32_t reparse_tag)
+	{
+		if (attributes & FILE_ATTRIBUTE_REPARSE_POINT)
+		{
+			if (reparse_tag == static_cast<DWORD>(IO_REPARSE_TAG_SYMLINK))
+			{
+				return msys::FileType::SymbolicLink;
+			}
+
+			if (reparse_tag == static_cast<DWORD>(IO_REPARSE_TAG_MOUNT_POINT))
+			{
+				return msys::FileType::Junction;
+			}
+
+			// 云文件、去重文件等其他重分析点按普通条目处理。
+		}
+
+		if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			return msys::FileType::Directory;
+		}
+
+		if (attributes & FILE_ATTRIBUTE_DEVICE)
+		{
+			return msys::FileType::Other;
+		}
+
+		return msys::FileType::RegularFile;
+	}
+
+	///
+	/// @brief 用 FindFirstFileExA 读取重分析点标记。
+	///
+	/// @param path Windows 长路径。
+	///
+	/// @return
+	///
+	uint32_t QueryReparseTag(std::string const &path)
+	{
+		WIN32_FIND_DATAA data{};
+
+		HANDLE h = FindFirstFileExA(path.c_str(),
+									FindExInfoBasic,
+									&data,
+									FindExSearchNameMatch,
+									nullptr,
+									0);
+
+		if (h == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("读取 {} 的重分析点标记失败。", path) + msys::FormatError(GetLastError())};
+		}
+
+		msys::FindHandleGuard g{h};
+
+		// 重分析点的标记在 dwReserved0 中。
+		return data.dwReserved0;
+	}
+
+	///
+	/// @brief 打开句柄查询状态。
+	///
+	/// @param path Windows 长路径。
+	/// @param follow_links
+	///
+	/// @return
+	///
+	msys::FileStatus QueryByHandle(std::string const &path, bool follow_links)
+	{
+		DWORD flags = FILE_FLAG_BACKUP_SEMANTICS;
+
+		if (!follow_links)
+		{
+			flags |= FILE_FLAG_OPEN_REPARSE_POINT;
+		}
+
+		HANDLE h = CreateFileA(path.c_str(),
+							   FILE_READ_ATTRIBUTES,
+							   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+							   nullptr,
+							   OPEN_EXISTING,
+							   flags,
+							   nullptr);
+
+		if (h == INVALID_HANDLE_VALUE)
+		{
+			DWORD error = GetLastError();
+
+			if (IsNotFoundError(error))
+			{
+				// 路径不存在，或者跟随链接时链接指向的目标不存在。
+				return msys::FileStatus{};
+			}
+
+			throw std::runtime_error{CODE_POS_STR + std::format("打开 {} 失败。", path) + msys::FormatError(error)};
+		}
+
+		msys::HandleGuard g{h};
+		BY_HANDLE_FILE_INFORMATION info{};
+
+		if (!GetFileInformationByHandle(h, &info))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("获取 {} 的信息失败。", path) + msys::FormatError(GetLastError())};
+		}
+
+		msys::FileStatus status{};
+		status.attributes = info.dwFileAttributes;
+		status.size = (static_cast<int64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+		status.creation_time = ToInt64(info.ftCreationTime);
+		status.last_write_time = ToInt64(info.ftLastWriteTime);
+		status.volume_serial_number = info.dwVolumeSerialNumber;
+		status.file_id = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+		status.link_count = info.nNumberOfLinks;
+
+		if (status.attributes & FILE_ATTRIBUTE_REPARSE_POINT)
+		{
+			FILE_ATTRIBUTE_TAG_INFO tag_info{};
+
+			if (!GetFileInformationByHandleEx(h, FileAttributeTagInfo, &tag_info, sizeof(tag_info)))
+			{
+				throw std::runtime_error{CODE_POS_STR + std::format("读取 {} 的重分析点标记失败。", path) + msys::FormatError(GetLastError())};
+			}
+
+			status.reparse_tag = tag_info.ReparseTag;
+		}
+
+		status.type = GetFileType(status.attributes, status.reparse_tag);
+
+		if (status.type == msys::FileType::Directory)
+		{
+			status.size = 0;
+		}
+
+		return status;
+	}
+
+} // namespace
+
+msys::FileStatus msys::Status(base::Path const &path, bool follow_links, bool query_file_id)
+{
+	std::string path_string = base::filesystem::ToWindowsLongPathString(path);
+
+	if (query_file_id)
+	{
+		return QueryByHandle(path_string, follow_links);
+	}
+
+	WIN32_FILE_ATTRIBUTE_DATA data{};
+
+	if (!GetFileAttributesExA(path_string.c_str(), GetFileExInfoStandard, &data))
+	{
+		DWORD error = GetLastError();
+
+		if (IsNotFoundError(error))
+		{
+			return msys::FileStatus{};
+		}
+
+		throw std::runtime_error{CODE_POS_STR + std::format("获取 {} 的属性失败。", path.ToString()) + msys::FormatError(error)};
+	}
+
+	if ((data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) && follow_links)
+	{
+		// GetFileAttributesExA 不跟随链接。
+		return QueryByHandle(path_string, true);
+	}
+
+	msys::FileStatus status{};
+	status.attributes = data.dwFileAttributes;
+	status.size = (static_cast<int64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+	status.creation_time = ToInt64(data.ftCreationTime);
+	status.last_write_time = ToInt64(data.ftLastWriteTime);
+
+	if (status.attributes & FILE_ATTRIBUTE_REPARSE_POINT)
+	{
+		status.reparse_tag = QueryReparseTag(path_string);
+	}
+
+	status.type = GetFileType(status.attributes, status.reparse_tag);
+
+	if (status.type == msys::FileType::Directory)
+	{
+		status.size = 0;
+	}
+
+	return status;
+}
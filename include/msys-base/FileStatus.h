@@ -0,0 +1,103 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include <cstdint>
+
+namespace msys
+{
+	///
+	/// @brief 目录条目的类型。
+	///
+	enum class FileType
+	{
+		///
+		/// @brief 路径不存在。跟随链接时也表示链接指向的目标不存在。
+		///
+		NotFound,
+
+		RegularFile,
+		Directory,
+		SymbolicLink,
+
+		///
+		/// @brief 目录交接点或卷挂载点。不算作符号链接。
+		///
+		Junction,
+
+		///
+		/// @brief 设备等其他条目。
+		///
+		Other,
+	};
+
+	///
+	/// @brief 一次系统调用得到的条目状态。
+	///
+	class FileStatus
+	{
+	public:
+		msys::FileType type = msys::FileType::NotFound;
+
+		///
+		/// @brief 文件大小。目录为 0.
+		///
+		int64_t size = 0;
+
+		///
+		/// @brief 创建时间。FILETIME 的值，单位是 100 纳秒。
+		///
+		int64_t creation_time = 0;
+
+		///
+		/// @brief 最后修改时间。FILETIME 的值，单位是 100 纳秒。
+		///
+		int64_t last_write_time = 0;
+
+		///
+		/// @brief FILE_ATTRIBUTE_* 属性。
+		///
+		uint32_t attributes = 0;
+
+		///
+		/// @brief 重分析点标记。不是重分析点则为 0.
+		///
+		uint32_t reparse_tag = 0;
+
+		///
+		/// @brief 所在卷的序列号。只有要求查询文件 ID 时才有效。
+		///
+		uint32_t volume_serial_number = 0;
+
+		///
+		/// @brief 卷内唯一的文件 ID. 只有要求查询文件 ID 时才有效。
+		///
+		uint64_t file_id = 0;
+
+		///
+		/// @brief 硬链接数。只有要求查询文件 ID 时才有效。
+		///
+		uint32_t link_count = 0;
+
+		bool Exists() const
+		{
+			return type != msys::FileType::NotFound;
+		}
+	};
+
+	///
+	/// @brief 获取条目状态。
+	///
+	/// @note 默认只调用一次 GetFileAttributesExA. 只有条目是重分析点时，
+	/// 才再用 FindFirstFileExA 读取重分析点标记，或者打开句柄跟随链接。
+	///
+	/// @note 路径不存在时返回 type 为 NotFound 的状态，不抛出异常。
+	///
+	/// @param path
+	/// @param follow_links 为 true 时返回链接指向的目标的状态。
+	/// @param query_file_id 为 true 时打开句柄，用 GetFileInformationByHandle 同时得到
+	/// 卷序列号、文件 ID 和硬链接数。
+	///
+	/// @return
+	///
+	msys::FileStatus Status(base::Path const &path, bool follow_links, bool query_file_id = false);
+
+} // namespace msys
@@ -1,26 +1,413 @@
 #include "FileStream.h"
 #include "base/filesystem/filesystem.h"
+#include "msys-base/HandleGuard.h"
+#include "msys-base/IoCompletionPort.h"
+#include "msys-base/ThreadPool.h"
+#include "msys-base/win32_error.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	///
+	/// @brief 单次调用 ReadFile 或 WriteFile 的最大字节数。
+	///
+	/// @note 这两个函数的长度参数是 DWORD, 所以大块读写要拆开。
+	///
+	int64_t constexpr MaxNativeIoSize = 1024 * 1024 * 1024;
+
+	///
+	/// @brief 用文件偏移量初始化 OVERLAPPED 结构体。
+	///
+	/// @param offset
+	///
+	/// @return
+	///
+	OVERLAPPED CreateOverlapped(int64_t offset)
+	{
+		OVERLAPPED overlapped{};
+		overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		return overlapped;
+	}
+
+	///
+	/// @brief 将 value 向下对齐到 alignment 的整数倍。
+	///
+	/// @param value
+	/// @param alignment
+	///
+	/// @return
+	///
+	int64_t AlignDown(int64_t value, int64_t alignment)
+	{
+		return value / alignment * alignment;
+	}
+
+	///
+	/// @brief 将 value 向上对齐到 alignment 的整数倍。
+	///
+	/// @param value
+	/// @param alignment
+	///
+	/// @return
+	///
+	int64_t AlignUp(int64_t value, int64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	///
+	/// @brief 本线程用于等待重叠操作完成的事件。
+	///
+	/// @return
+	///
+	HANDLE ThreadEvent()
+	{
+		class EventHolder
+		{
+		public:
+			HANDLE _event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+			~EventHolder()
+			{
+				if (_event != nullptr)
+				{
+					CloseHandle(_event);
+				}
+			}
+		};
+
+		thread_local EventHolder holder{};
+
+		if (holder._event == nullptr)
+		{
+			throw std::runtime_error{CODE_POS_STR + "创建事件失败。" + msys::FormatError(GetLastError())};
+		}
+
+		return holder._event;
+	}
+
+	///
+	/// @brief WriteV 在用户态拼接成一块再写入的最大总字节数。
+	///
+	/// @note 超过这个大小时，拷贝的开销会超过省下的系统调用。
+	///
+	int64_t constexpr MaxCoalescedWriteSize = 1024 * 1024;
+
+	///
+	/// @brief 系统的内存页大小。
+	///
+	/// @return
+	///
+	int64_t PageSize()
+	{
+		static int64_t const page_size = []()
+		{
+			SYSTEM_INFO info{};
+			GetSystemInfo(&info);
+			return static_cast<int64_t>(info.dwPageSize);
+		}();
+
+		return page_size;
+	}
+
+	///
+	/// @brief 将 spans 拆成 ReadFileScatter 和 WriteFileGather 要求的每页一个元素的数组。
+	///
+	/// @param spans
+	/// @param segments 用来返回元素数组，以空元素结尾。
+	///
+	/// @return 某个 span 的内存或大小没有按页对齐时返回 false.
+	///
+	template <typename SpanType>
+	bool CreatePageSegments(std::vector<SpanType> const &spans, std::vector<FILE_SEGMENT_ELEMENT> &segments)
+	{
+		int64_t page_size = PageSize();
+
+		for (SpanType const &span : spans)
+		{
+			uintptr_t address = reinterpret_cast<uintptr_t>(span.Buffer());
+
+			if (address % page_size != 0 || span.Size() % page_size != 0)
+			{
+				return false;
+			}
+
+			for (int64_t offset = 0; offset < span.Size(); offset += page_size)
+			{
+				FILE_SEGMENT_ELEMENT segment{};
+				segment.Alignment = address + offset;
+				segments.push_back(segment);
+			}
+		}
+
+		segments.push_back(FILE_SEGMENT_ELEMENT{});
+		return true;
+	}
+
+} // namespace
 
 /* #region 工厂函数 */
 
+std::shared_ptr<base::FileStream> base::FileStream::TryOpen(base::Path const &path,
+															base::OpenOptions const &options,
+															DWORD &error)
+{
+	DWORD desired_access = 0;
+	bool can_read = false;
+	bool can_write = false;
+
+	switch (options.access)
+	{
+	case base::FileAccess::Read:
+		{
+			desired_access = GENERIC_READ;
+			can_read = true;
+			break;
+		}
+	case base::FileAccess::Write:
+		{
+			desired_access = GENERIC_WRITE;
+			can_write = true;
+			break;
+		}
+	case base::FileAccess::ReadWrite:
+		{
+			desired_access = GENERIC_READ | GENERIC_WRITE;
+			can_read = true;
+			can_write = true;
+			break;
+		}
+	}
+
+	DWORD creation_disposition = OPEN_EXISTING;
+
+	switch (options.disposition)
+	{
+	case base::FileCreateDisposition::OpenExisting:
+		{
+			creation_disposition = OPEN_EXISTING;
+			break;
+		}
+	case base::FileCreateDisposition::CreateNew:
+		{
+			creation_disposition = CREATE_NEW;
+			break;
+		}
+	case base::FileCreateDisposition::CreateAlways:
+		{
+			creation_disposition = CREATE_ALWAYS;
+			break;
+		}
+	case base::FileCreateDisposition::OpenAlways:
+		{
+			creation_disposition = OPEN_ALWAYS;
+			break;
+		}
+	case base::FileCreateDisposition::TruncateExisting:
+		{
+			creation_disposition = TRUNCATE_EXISTING;
+			break;
+		}
+	}
+
+	DWORD share_mode = 0;
+
+	if (options.share_read)
+	{
+		share_mode |= FILE_SHARE_READ;
+	}
+
+	if (options.share_write)
+	{
+		share_mode |= FILE_SHARE_WRITE;
+	}
+
+	if (options.share_delete)
+	{
+		share_mode |= FILE_SHARE_DELETE;
+	}
+
+	// 这些标志在 ReOpenFile 时还要再用一次。
+	DWORD flags = 0;
+
+	if (options.hint == base::FileAccessHint::Sequential)
+	{
+		flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+	}
+	else if (options.hint == base::FileAccessHint::Random)
+	{
+		flags |= FILE_FLAG_RANDOM_ACCESS;
+	}
+
+	if (options.no_follow)
+	{
+		flags |= FILE_FLAG_OPEN_REPARSE_POINT;
+	}
+
+	if (options.no_buffering)
+	{
+		flags |= FILE_FLAG_NO_BUFFERING;
+	}
+
+	DWORD flags_and_attributes = flags;
+
+	if (options.temporary)
+	{
+		flags_and_attributes |= FILE_ATTRIBUTE_TEMPORARY;
+	}
+	else
+	{
+		flags_and_attributes |= FILE_ATTRIBUTE_NORMAL;
+	}
+
+	if (options.delete_on_close)
+	{
+		flags_and_attributes |= FILE_FLAG_DELETE_ON_CLOSE;
+	}
+
+	HANDLE handle = CreateFileA(base::filesystem::ToWindowsLongPathString(path).c_str(),
+								desired_access,
+								share_mode,
+								nullptr,
+								creation_disposition,
+								flags_and_attributes,
+								nullptr);
+
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		error = GetLastError();
+		return nullptr;
+	}
+
+	std::shared_ptr<FileStream> fs{new FileStream{path}};
+	fs->_handle = handle;
+	fs->_share_mode = share_mode;
+	fs->_flags = flags;
+	fs->_can_read = can_read;
+	fs->_can_write = can_write;
+	fs->_can_seek = true;
+
+	if (options.no_buffering)
+	{
+		fs->_alignment = fs->SectorSize();
+
+		if (fs->_buffer.Alignment() % fs->_alignment != 0 || fs->_buffer_size % fs->_alignment != 0)
+		{
+			// 扇区比默认的对齐还大，按扇区重新分配。
+			fs->_buffer_size = AlignUp(fs->_buffer_size, fs->_alignment);
+			fs->_buffer = base::AlignedBuffer{fs->_buffer_size, fs->_alignment};
+		}
+	}
+
+	error = ERROR_SUCCESS;
+	return fs;
+}
+
+std::string base::FileStream::CreateOpenErrorMessage(base::Path const &path,
+													 base::OpenOptions const &options,
+													 DWORD error)
+{
+	std::string message;
+
+	switch (error)
+	{
+	case ERROR_FILE_NOT_FOUND:
+	case ERROR_PATH_NOT_FOUND:
+		{
+			message = std::format("文件 {} 不存在。", path.ToString());
+			break;
+		}
+	case ERROR_FILE_EXISTS:
+	case ERROR_ALREADY_EXISTS:
+		{
+			message = std::format("文件 {} 已存在。", path.ToString());
+			break;
+		}
+	case ERROR_SHARING_VIOLATION:
+		{
+			message = std::format("文件 {} 正在被其他句柄以不兼容的共享模式使用。", path.ToString());
+			break;
+		}
+	case ERROR_ACCESS_DENIED:
+		{
+			// 对目录调用 CreateFileA 也是这个错误。只有失败了才会多这一次系统调用。
+			DWORD attributes = GetFileAttributesA(base::filesystem::ToWindowsLongPathString(path).c_str());
+
+			if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY))
+			{
+				message = std::format("{} 不是一个文件，而是一个目录", path.ToString());
+			}
+			else if (attributes != INVALID_FILE_ATTRIBUTES &&
+					 (attributes & FILE_ATTRIBUTE_READONLY) &&
+					 options.access != base::FileAccess::Read)
+			{
+				message = std::format("文件 {} 是只读的，不可写。", path.ToString());
+			}
+			else
+			{
+				message = std::format("没有权限访问文件 {} .", path.ToString());
+			}
+
+			break;
+		}
+	default:
+		{
+			message = std::format("打开 {} 失败。", path.ToString());
+			break;
+		}
+	}
+
+	return message + msys::FormatError(error);
+}
+
+std::shared_ptr<base::FileStream> base::FileStream::Open(base::Path const &path, base::OpenOptions const &options)
+{
+	DWORD error = ERROR_SUCCESS;
+	std::shared_ptr<base::FileStream> fs = TryOpen(path, options, error);
+
+	if (fs == nullptr)
+	{
+		throw std::runtime_error{CODE_POS_STR + CreateOpenErrorMessage(path, options, error)};
+	}
+
+	return fs;
+}
+
 std::shared_ptr<base::FileStream> base::FileStream::OpenOrCreate(base::Path const &path)
 {
 	try
 	{
-		if (!base::filesystem::Exists(path))
+		base::OpenOptions options{};
+		options.access = base::FileAccess::ReadWrite;
+		options.disposition = base::FileCreateDisposition::OpenAlways;
+
+		DWORD error = ERROR_SUCCESS;
+		std::shared_ptr<base::FileStream> fs = TryOpen(path, options, error);
+
+		if (fs != nullptr)
+		{
+			return fs;
+		}
+
+		if (error != ERROR_ACCESS_DENIED)
 		{
-			return CreateNewAnyway(path);
+			throw std::runtime_error{CreateOpenErrorMessage(path, options, error)};
 		}
 
-		// 执行到这里说明 path 存在。
-		if (base::filesystem::IsDirectory(path))
+		// 只读文件、被 ACL 拒绝访问的文件也是这个错误，不能删除它们。
+		// 只有确实是目录（不是目录链接）时才交给 CreateNewAnyway 删除后创建新文件。
+		DWORD attributes = GetFileAttributesA(base::filesystem::ToWindowsLongPathString(path).c_str());
+
+		if (attributes == INVALID_FILE_ATTRIBUTES ||
+			!(attributes & FILE_ATTRIBUTE_DIRECTORY) ||
+			(attributes & FILE_ATTRIBUTE_REPARSE_POINT))
 		{
-			// 是一个目录，直接创建新文件。
-			return CreateNewAnyway(path);
+			throw std::runtime_error{CreateOpenErrorMessage(path, options, error)};
 		}
 
-		// 存在，且不是目录，直接打开。
-		return OpenExisting(path);
+		return CreateNewAnyway(path);
 	}
 	catch (std::exception const &e)
 	{
@@ -31,119 +418,1165 @@ std::shared_ptr<base::FileStream> base::FileStream::OpenOrCreate(base::Path cons
 
 std::shared_ptr<base::FileStream> base::FileStream::CreateNewAnyway(base::Path const &path)
 {
-	if (base::filesystem::Exists(path))
+	base::OpenOptions options{};
+	options.access = base::FileAccess::ReadWrite;
+	options.disposition = base::FileCreateDisposition::CreateNew;
+
+	// 绝大多数情况下文件不存在，一次系统调用就能完成。
+	DWORD error = ERROR_SUCCESS;
+	std::shared_ptr<base::FileStream> fs = TryOpen(path, options, error);
+
+	if (fs != nullptr)
 	{
-		// 如果存在，不管是文件还是目录，统统删除。
-		base::filesystem::Remove(path);
+		return fs;
 	}
 
-	std::shared_ptr<FileStream> fs{new FileStream{path}};
+	if (error != ERROR_FILE_EXISTS &&
+		error != ERROR_ALREADY_EXISTS &&
+		error != ERROR_ACCESS_DENIED)
+	{
+		throw std::runtime_error{CODE_POS_STR + CreateOpenErrorMessage(path, options, error)};
+	}
 
-	auto flags = std::ios_base::out |
-				 std::ios_base::in |
-				 std::ios_base::trunc |
-				 std::ios_base::binary;
+	// 已经存在，不管是文件、目录还是符号链接，统统删除。
+	base::filesystem::Remove(path);
 
-	fs->_fs = std::shared_ptr<std::fstream>{new std::fstream{
-		path.ToString(),
-		flags,
-	}};
+	options.disposition = base::FileCreateDisposition::CreateAlways;
+	fs = TryOpen(path, options, error);
 
-	if (fs->_fs->fail())
+	if (fs == nullptr)
 	{
-		std::string message = CODE_POS_STR + std::format("创建 {} 失败。", path.ToString());
+		std::string message = CODE_POS_STR + std::format("创建 {} 失败。", path.ToString()) + msys::FormatError(error);
 		throw std::runtime_error{message};
 	}
 
-	fs->_can_read = true;
-	fs->_can_write = true;
-	fs->_can_seek = true;
 	return fs;
 }
 
 std::shared_ptr<base::FileStream> base::FileStream::OpenExisting(base::Path const &path)
 {
-	if (!base::filesystem::Exists(path))
+	base::OpenOptions options{};
+	options.access = base::FileAccess::ReadWrite;
+	options.disposition = base::FileCreateDisposition::OpenExisting;
+	return Open(path, options);
+}
+
+std::shared_ptr<base::FileStream> base::FileStream::OpenReadOnly(base::Path const &path)
+{
+	base::OpenOptions options{};
+	options.access = base::FileAccess::Read;
+	options.disposition = base::FileCreateDisposition::OpenExisting;
+	return Open(path, options);
+}
+
+/* #endregion */
+
+/* #region 原生读写 */
+
+int64_t base::FileStream::NativeRead(int64_t offset, uint8_t *buffer, int64_t count)
+{
+	int64_t have_read = 0;
+
+	while (have_read < count)
 	{
-		throw std::runtime_error{CODE_POS_STR + std::format("文件 {} 不存在。", path.ToString())};
+		DWORD size = static_cast<DWORD>(std::min(count - have_read, MaxNativeIoSize));
+		OVERLAPPED overlapped = CreateOverlapped(offset + have_read);
+		DWORD once_read = 0;
+
+		if (!ReadFile(_handle, buffer + have_read, size, &once_read, &overlapped))
+		{
+			DWORD error = GetLastError();
+			if (error == ERROR_HANDLE_EOF)
+			{
+				// 偏移量位于文件末尾或超出文件末尾。
+				break;
+			}
+
+			throw std::runtime_error{CODE_POS_STR + std::format("读取 {} 失败。", _path.ToString()) + msys::FormatError(error)};
+		}
+
+		if (once_read == 0)
+		{
+			break;
+		}
+
+		have_read += once_read;
 	}
 
-	if (base::filesystem::IsDirectory(path))
+	return have_read;
+}
+
+void base::FileStream::NativeWrite(int64_t offset, uint8_t const *buffer, int64_t count)
+{
+	int64_t have_written = 0;
+
+	while (have_written < count)
 	{
-		throw std::runtime_error{CODE_POS_STR + std::format("{} 不是一个文件，而是一个目录", path.ToString())};
+		DWORD size = static_cast<DWORD>(std::min(count - have_written, MaxNativeIoSize));
+		OVERLAPPED overlapped = CreateOverlapped(offset + have_written);
+		DWORD once_written = 0;
+
+		if (!WriteFile(_handle, buffer + have_written, size, &once_written, &overlapped))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("写入 {} 失败。", _path.ToString()) + msys::FormatError(GetLastError())};
+		}
+
+		have_written += once_written;
 	}
+}
+
+int64_t base::FileStream::NativeLength() const
+{
+	LARGE_INTEGER size{};
 
-	if (!base::filesystem::IsReadable(path))
+	if (!GetFileSizeEx(_handle, &size))
 	{
-		throw std::runtime_error{CODE_POS_STR + "文件不可读。"};
+		throw std::runtime_error{CODE_POS_STR + std::format("获取 {} 的大小失败。", _path.ToString()) + msys::FormatError(GetLastError())};
 	}
 
-	if (!base::filesystem::IsWriteable(path))
+	return size.QuadPart;
+}
+
+void base::FileStream::NativeSetLength(int64_t value)
+{
+	FILE_END_OF_FILE_INFO info{};
+	info.EndOfFile.QuadPart = value;
+
+	if (!SetFileInformationByHandle(_handle, FileEndOfFileInfo, &info, sizeof(info)))
 	{
-		throw std::runtime_error{CODE_POS_STR + "文件不可写。"};
+		throw std::runtime_error{CODE_POS_STR + std::format("设置 {} 的长度失败。", _path.ToString()) + msys::FormatError(GetLastError())};
 	}
+}
 
-	std::shared_ptr<FileStream> fs{new FileStream{path}};
-
-	auto flags = std::ios_base::in |
-				 std::ios_base::out |
-				 std::ios_base::binary;
+bool base::FileStream::IsAligned(uint8_t const *buffer, int64_t offset, int64_t count) const
+{
+	if (_alignment == 0)
+	{
+		return true;
+	}
 
-	fs->_fs = std::shared_ptr<std::fstream>{new std::fstream{
-		path.ToString(),
-		flags,
-	}};
+	return reinterpret_cast<uintptr_t>(buffer) % _alignment == 0 &&
+		   offset % _alignment == 0 &&
+		   count % _alignment == 0;
+}
 
-	if (fs->_fs->fail())
+void base::FileStream::BeginWriteBuffer()
+{
+	if (_alignment == 0)
 	{
-		std::string message = CODE_POS_STR + std::format("打开 {} 失败。", path.ToString());
-		throw std::runtime_error{message};
+		_buffer_file_offset = _position;
+		return;
 	}
 
-	fs->_can_read = true;
-	fs->_can_write = true;
-	fs->_can_seek = true;
-	return fs;
+	_buffer_file_offset = AlignDown(_position, _alignment);
+	_write_length = _position - _buffer_file_offset;
+
+	if (_write_length > 0)
+	{
+		// 对齐后多出来的头部是文件中原有的数据，要读出来，否则写入时会被覆盖。
+		std::memset(_buffer.Buffer(), 0, _alignment);
+		NativeRead(_buffer_file_offset, _buffer.Buffer(), _alignment);
+	}
 }
 
-std::shared_ptr<base::FileStream> base::FileStream::OpenReadOnly(base::Path const &path)
+void base::FileStream::FlushWriteBuffer()
 {
-	if (!base::filesystem::Exists(path))
+	if (_write_behind != nullptr)
 	{
-		std::string message = CODE_POS_STR + std::format("文件 {} 不存在。", path.ToString());
-		throw std::runtime_error{message};
+		_write_behind->Flush();
+		return;
 	}
 
-	if (base::filesystem::IsDirectory(path))
+	if (_write_length == 0)
 	{
-		std::string message = CODE_POS_STR + std::format("{} 不是一个文件，而是一个目录", path.ToString());
-		throw std::runtime_error{message};
+		return;
 	}
 
-	if (!base::filesystem::IsReadable(path))
+	if (_alignment == 0)
 	{
-		throw std::runtime_error{CODE_POS_STR + "文件不可读。"};
+		NativeWrite(_buffer_file_offset, _buffer.Buffer(), _write_length);
+		_write_length = 0;
+		return;
 	}
 
-	std::shared_ptr<FileStream> fs{new FileStream{path}};
+	// 无缓冲模式，写入的大小要向上对齐到扇区。
+	int64_t end = _buffer_file_offset + _write_length;
+	int64_t write_size = AlignUp(_write_length, _alignment);
+	int64_t file_length = NativeLength();
+
+	if (write_size > _write_length)
+	{
+		int64_t tail_offset = _buffer_file_offset + write_size - _alignment;
+
+		if (end < file_length)
+		{
+			// 最后一个扇区在文件中还有原来的数据，读出来，避免被填充的数据覆盖。
+			base::AlignedBuffer sector{_alignment, _alignment};
+			std::memset(sector.Buffer(), 0, _alignment);
+			NativeRead(tail_offset, sector.Buffer(), _alignment);
+
+			std::memcpy(_buffer.Buffer() + _write_length,
+						sector.Buffer() + (end - tail_offset),
+						write_size - _write_length);
+		}
+		else
+		{
+			std::memset(_buffer.Buffer() + _write_length, 0, write_size - _write_length);
+		}
+	}
+
+	NativeWrite(_buffer_file_offset, _buffer.Buffer(), write_size);
+
+	int64_t real_length = std::max(file_length, end);
+	if (_buffer_file_offset + write_size > real_length)
+	{
+		// 填充的数据把文件撑长了，截回去。
+		NativeSetLength(real_length);
+	}
+
+	_write_length = 0;
+}
+
+/* #endregion */
+
+void base::FileStream::EnableWriteBehind(int64_t block_size,
+									   int64_t block_count,
+									   std::chrono::milliseconds idle_flush_interval)
+{
+	if (!_can_write)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法写入文件，所以无法开启后台写入模式。"};
+	}
+
+	if (_alignment > 0)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无缓冲模式不支持后台写入。"};
+	}
+
+	if (_write_behind != nullptr)
+	{
+		return;
+	}
 
-	auto flags = std::ios_base::in | std::ios_base::binary;
+	FlushWriteBuffer();
 
-	fs->_fs = std::shared_ptr<std::fstream>{new std::fstream{
-		path.ToString(),
-		flags,
+	_write_behind = std::unique_ptr<msys::WriteBehindWriter>{new msys::WriteBehindWriter{
+		block_size,
+		block_count,
+		[this](int64_t offset, uint8_t const *buffer, int64_t count)
+		{
+			NativeWrite(offset, buffer, count);
+		},
+		idle_flush_interval,
 	}};
+}
+
+int64_t base::FileStream::SectorSize() const
+{
+	FILE_STORAGE_INFO info{};
 
-	if (fs->_fs->fail())
+	if (!GetFileInformationByHandleEx(_handle, FileStorageInfo, &info, sizeof(info)))
 	{
-		std::string message = CODE_POS_STR + std::format("以只读方式打开 {} 失败。", path.ToString());
-		throw std::runtime_error{message};
+		return 4096;
 	}
 
-	fs->_can_read = true;
-	fs->_can_write = false;
-	fs->_can_seek = true;
-	return fs;
+	if (info.PhysicalBytesPerSectorForPerformance == 0)
+	{
+		return 4096;
+	}
+
+	return info.PhysicalBytesPerSectorForPerformance;
+}
+
+int64_t base::FileStream::Length() const
+{
+	int64_t length = NativeLength();
+
+	if (_write_behind != nullptr)
+	{
+		// 后台写入器中还没写入文件的数据也算在流的长度里。
+		return std::max<int64_t>(length, _write_behind->EndOffset());
+	}
+
+	if (_write_length > 0)
+	{
+		// 缓冲区中还没写入文件的数据也算在流的长度里。
+		return std::max<int64_t>(length, _buffer_file_offset + _write_length);
+	}
+
+	return length;
+}
+
+void base::FileStream::SetLength(int64_t value)
+{
+	if (!_can_write)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法写入文件，所以无法设置文件长度。"};
+	}
+
+	if (!_can_seek)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法定位文件，所以无法设置文件长度。"};
+	}
+
+	if (value < 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "文件长度不能小于 0."};
+	}
+
+	// 缓冲区中的数据要先落到文件中，并且读缓冲区中的数据在改变大小后可能就无效了。
+	FlushWriteBuffer();
+	_read_length = 0;
+
+	// 防止 Position 属性超出边界
+	_position = std::min(value, _position);
+
+	NativeSetLength(value);
+}
+
+void base::FileStream::Preallocate(int64_t length, bool keep_size)
+{
+	if (!_can_write)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法写入文件，所以无法预留空间。"};
+	}
+
+	FlushWriteBuffer();
+
+	if (length <= NativeLength())
+	{
+		// 分配大小比文件长度小会截断文件，所以不能往小了设。
+		return;
+	}
+
+	FILE_ALLOCATION_INFO info{};
+	info.AllocationSize.QuadPart = length;
+
+	if (!SetFileInformationByHandle(_handle, FileAllocationInfo, &info, sizeof(info)))
+	{
+		throw std::runtime_error{CODE_POS_STR + std::format("为 {} 预留空间失败。", _path.ToString()) + msys::FormatError(GetLastError())};
+	}
+
+	if (!keep_size)
+	{
+		_read_length = 0;
+		NativeSetLength(length);
+	}
+}
+
+int64_t base::FileStream::Read(base::Span const &span)
+{
+	if (!_can_read)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法读取文件。"};
+	}
+
+	// 缓冲区要腾出来给读取用。
+	FlushWriteBuffer();
+
+	uint8_t *buffer = span.Buffer();
+	int64_t count = span.Size();
+	int64_t have_read = 0;
+
+	while (have_read < count)
+	{
+		if (_read_length > 0 &&
+			_position >= _buffer_file_offset &&
+			_position < _buffer_file_offset + _read_length)
+		{
+			// 缓冲区命中。
+			int64_t offset_in_buffer = _position - _buffer_file_offset;
+			int64_t size = std::min(_read_length - offset_in_buffer, count - have_read);
+			std::memcpy(buffer + have_read, _buffer.Buffer() + offset_in_buffer, size);
+			have_read += size;
+			_position += size;
+			continue;
+		}
+
+		int64_t remain = count - have_read;
+
+		if (_alignment > 0 && IsAligned(buffer + have_read, _position, 0))
+		{
+			// 无缓冲模式下只有对齐的部分能直接读。
+			remain = AlignDown(remain, _alignment);
+		}
+		else if (_alignment > 0)
+		{
+			remain = 0;
+		}
+
+		if (remain >= _buffer_size)
+		{
+			// 剩余的量比缓冲区还大，直接读到调用者的内存中，省去一次拷贝。
+			int64_t once_read = NativeRead(_position, buffer + have_read, remain);
+			have_read += once_read;
+			_position += once_read;
+
+			if (once_read < remain)
+			{
+				// 到达文件末尾。
+				break;
+			}
+
+			continue;
+		}
+
+		// 重新填充缓冲区。无缓冲模式下起始位置要对齐。
+		_buffer_file_offset = _alignment > 0 ? AlignDown(_position, _alignment) : _position;
+		_read_length = NativeRead(_buffer_file_offset, _buffer.Buffer(), _buffer_size);
+
+		if (_position >= _buffer_file_offset + _read_length)
+		{
+			// 到达文件末尾。
+			break;
+		}
+	}
+
+	return have_read;
+}
+
+void base::FileStream::Write(base::ReadOnlySpan const &span)
+{
+	if (!_can_write)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法写入文件。"};
+	}
+
+	// 缓冲区要腾出来给写入用。
+	_read_length = 0;
+
+	if (_write_length > 0 && _buffer_file_offset + _write_length != _position)
+	{
+		// 缓冲区中待写入的数据与本次写入不连续。
+		FlushWriteBuffer();
+	}
+
+	uint8_t const *buffer = span.Buffer();
+	int64_t count = span.Size();
+
+	if (_write_behind != nullptr)
+	{
+		_write_behind->Write(_position, buffer, count);
+		_position += count;
+		return;
+	}
+
+	if (count >= _buffer_size && IsAligned(buffer, _position, count))
+	{
+		// 比缓冲区还大，直接写入，省去一次拷贝。
+		FlushWriteBuffer();
+		NativeWrite(_position, buffer, count);
+		_position += count;
+		return;
+	}
+
+	int64_t have_written = 0;
+
+	while (have_written < count)
+	{
+		if (_write_length == 0)
+		{
+			BeginWriteBuffer();
+		}
+
+		int64_t size = std::min(_buffer_size - _write_length, count - have_written);
+		std::memcpy(_buffer.Buffer() + _write_length, buffer + have_written, size);
+		_write_length += size;
+		have_written += size;
+		_position += size;
+
+		if (_write_length == _buffer_size)
+		{
+			FlushWriteBuffer();
+		}
+	}
+}
+
+bool base::FileStream::TryScatterGather(bool is_read,
+										std::vector<FILE_SEGMENT_ELEMENT> &segments,
+										int64_t count,
+										int64_t &transferred)
+{
+	if (_alignment == 0 || _write_behind != nullptr)
+	{
+		return false;
+	}
+
+	if (count == 0 || count > MaxNativeIoSize || count % _alignment != 0 || _position % _alignment != 0)
+	{
+		return false;
+	}
+
+	EnsureAsyncHandle();
+
+	if (_async_handle == INVALID_HANDLE_VALUE)
+	{
+		// 这两个函数只能用在重叠句柄上。
+		return false;
+	}
+
+	// 用户态缓冲区中待写入的数据要先落盘，保证写入的先后顺序。
+	FlushWriteBuffer();
+
+	// 事件句柄的最低位置 1, 操作完成后就不会往完成端口投递完成包。
+	OVERLAPPED overlapped = CreateOverlapped(_position);
+	overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<uintptr_t>(ThreadEvent()) | 1);
+
+	BOOL call_result = FALSE;
+
+	if (is_read)
+	{
+		call_result = ReadFileScatter(_async_handle, segments.data(), static_cast<DWORD>(count), nullptr, &overlapped);
+	}
+	else
+	{
+		call_result = WriteFileGather(_async_handle, segments.data(), static_cast<DWORD>(count), nullptr, &overlapped);
+	}
+
+	DWORD error = ERROR_SUCCESS;
+	if (!call_result)
+	{
+		error = GetLastError();
+	}
+
+	DWORD once_transferred = 0;
+
+	if (error == ERROR_SUCCESS || error == ERROR_IO_PENDING)
+	{
+		error = GetOverlappedResult(_async_handle, &overlapped, &once_transferred, TRUE) ? ERROR_SUCCESS : GetLastError();
+	}
+
+	if (error != ERROR_SUCCESS && error != ERROR_HANDLE_EOF)
+	{
+		throw std::runtime_error{CODE_POS_STR + std::format("读写 {} 失败。", _path.ToString()) + msys::FormatError(error)};
+	}
+
+	if (!is_read)
+	{
+		// 文件内容变了，缓存的数据作废。
+		_read_length = 0;
+	}
+
+	transferred = once_transferred;
+	_position += once_transferred;
+	return true;
+}
+
+int64_t base::FileStream::ReadV(std::vector<base::Span> const &spans)
+{
+	if (!_can_read)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法读取文件。"};
+	}
+
+	int64_t total_size = 0;
+
+	for (base::Span const &span : spans)
+	{
+		total_size += span.Size();
+	}
+
+	std::vector<FILE_SEGMENT_ELEMENT> segments;
+	int64_t transferred = 0;
+
+	if (_alignment > 0 &&
+		CreatePageSegments(spans, segments) &&
+		TryScatterGather(true, segments, total_size, transferred))
+	{
+		// 无缓冲模式下所有 span 都按页对齐，一次 ReadFileScatter 读完。
+		return transferred;
+	}
+
+	int64_t have_read = 0;
+
+	for (base::Span const &span : spans)
+	{
+		int64_t once_read = Read(span);
+		have_read += once_read;
+
+		if (once_read < span.Size())
+		{
+			// 到达文件末尾。
+			break;
+		}
+	}
+
+	return have_read;
+}
+
+void base::FileStream::WriteV(std::vector<base::ReadOnlySpan> const &spans)
+{
+	if (!_can_write)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法写入文件。"};
+	}
+
+	int64_t total_size = 0;
+
+	for (base::ReadOnlySpan const &span : spans)
+	{
+		total_size += span.Size();
+	}
+
+	std::vector<FILE_SEGMENT_ELEMENT> segments;
+	int64_t transferred = 0;
+
+	if (_alignment > 0 &&
+		CreatePageSegments(spans, segments) &&
+		TryScatterGather(false, segments, total_size, transferred))
+	{
+		// 无缓冲模式下所有 span 都按页对齐，一次 WriteFileGather 写完。
+		return;
+	}
+
+	// 缓冲区要腾出来给写入用。
+	_read_length = 0;
+
+	if (_write_length > 0 &&
+		(_buffer_file_offset + _write_length != _position || _write_length + total_size > _buffer_size))
+	{
+		// 缓冲区中待写入的数据与本次写入不连续，或者剩余空间放不下本次的全部数据。
+		// 先把缓冲区腾空，尽量让本次的所有 span 落在同一次 WriteFile 中。
+		FlushWriteBuffer();
+	}
+
+	if (_alignment == 0 &&
+		_write_behind == nullptr &&
+		spans.size() > 1 &&
+		total_size > _buffer_size &&
+		total_size <= MaxCoalescedWriteSize)
+	{
+		// 用户态缓冲区放不下，但总量不大。拼接成一块，头部、大块数据、尾部只需要一次 WriteFile.
+		std::unique_ptr<uint8_t[]> buffer{new uint8_t[total_size]};
+		int64_t offset = 0;
+
+		for (base::ReadOnlySpan const &span : spans)
+		{
+			std::memcpy(buffer.get() + offset, span.Buffer(), span.Size());
+			offset += span.Size();
+		}
+
+		NativeWrite(_position, buffer.get(), total_size);
+		_position += total_size;
+		return;
+	}
+
+	for (base::ReadOnlySpan const &span : spans)
+	{
+		Write(span);
+	}
+}
+
+void base::FileStream::Close()
+{
+	if (_async_handle != INVALID_HANDLE_VALUE)
+	{
+		// 关闭句柄会让还没完成的异步操作以 ERROR_OPERATION_ABORTED 完成。
+		CloseHandle(_async_handle);
+		_async_handle = INVALID_HANDLE_VALUE;
+	}
+
+	for (HANDLE handle : _retired_async_handles)
+	{
+		CloseHandle(handle);
+	}
+
+	_retired_async_handles.clear();
+
+	if (_handle == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	try
+	{
+		FlushWriteBuffer();
+	}
+	catch (...)
+	{
+		_write_behind.reset();
+		CloseHandle(_handle);
+		_handle = INVALID_HANDLE_VALUE;
+		throw;
+	}
+
+	// 后台线程要在句柄关闭前停下来。
+	_write_behind.reset();
+	CloseHandle(_handle);
+	_handle = INVALID_HANDLE_VALUE;
+}
+
+void base::FileStream::AdviseAccessPattern(base::FileAdvice advice, int64_t offset, int64_t length)
+{
+	if (offset < 0 || length < 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "区间的起始位置和长度不能小于 0."};
+	}
+
+	switch (advice)
+	{
+	case base::FileAdvice::Normal:
+	case base::FileAdvice::Sequential:
+	case base::FileAdvice::Random:
+		{
+			DWORD flags = _flags & ~(FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_RANDOM_ACCESS);
+
+			if (advice == base::FileAdvice::Sequential)
+			{
+				flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+			}
+			else if (advice == base::FileAdvice::Random)
+			{
+				flags |= FILE_FLAG_RANDOM_ACCESS;
+			}
+
+			if (flags == _flags)
+			{
+				return;
+			}
+
+			DWORD access = 0;
+
+			if (_can_read)
+			{
+				access |= GENERIC_READ;
+			}
+
+			if (_can_write)
+			{
+				access |= GENERIC_WRITE;
+			}
+
+			FlushWriteBuffer();
+
+			// 等待其他线程上正在使用句柄的定位读写结束。
+			std::unique_lock l{_handle_lock};
+
+			// 预读策略是打开句柄时决定的，只能换一个句柄。
+			HANDLE handle = ReOpenFile(_handle, access, _share_mode, flags);
+
+			if (handle == INVALID_HANDLE_VALUE)
+			{
+				throw std::runtime_error{CODE_POS_STR + std::format("重新打开 {} 失败。", _path.ToString()) + msys::FormatError(GetLastError())};
+			}
+
+			HANDLE async_handle = INVALID_HANDLE_VALUE;
+
+			if (_async_handle != INVALID_HANDLE_VALUE)
+			{
+				// 重叠句柄是从旧句柄重新打开的，带的还是旧的标志，也要换掉。
+				async_handle = ReOpenFile(handle, access, _share_mode, flags | FILE_FLAG_OVERLAPPED);
+
+				if (async_handle == INVALID_HANDLE_VALUE)
+				{
+					DWORD error = GetLastError();
+					CloseHandle(handle);
+					throw std::runtime_error{CODE_POS_STR + std::format("重新打开 {} 失败。", _path.ToString()) + msys::FormatError(error)};
+				}
+
+				_async_by_iocp = msys::IoCompletionPort::Instance().Associate(async_handle);
+				_retired_async_handles.push_back(_async_handle);
+				_async_handle = async_handle;
+			}
+
+			CloseHandle(_handle);
+			_handle = handle;
+			_flags = flags;
+			return;
+		}
+	case base::FileAdvice::WillNeed:
+		{
+			if (!_can_read)
+			{
+				throw std::runtime_error{CODE_POS_STR + "无法读取文件，所以无法预读。"};
+			}
+
+			int64_t file_length = Length();
+			if (offset >= file_length)
+			{
+				return;
+			}
+
+			if (length == 0 || offset + length > file_length)
+			{
+				length = file_length - offset;
+			}
+
+			// 还在用户态缓冲区中的数据没有写入文件，映射看不到。
+			FlushWriteBuffer();
+
+			HANDLE mapping = CreateFileMappingA(_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping == nullptr)
+			{
+				throw std::runtime_error{CODE_POS_STR + std::format("为 {} 创建文件映射对象失败。", _path.ToString()) + msys::FormatError(GetLastError())};
+			}
+
+			msys::HandleGuard mapping_guard{mapping};
+
+			SYSTEM_INFO info{};
+			GetSystemInfo(&info);
+			int64_t view_offset = offset / info.dwAllocationGranularity * info.dwAllocationGranularity;
+			int64_t view_size = offset + length - view_offset;
+
+			void *view = MapViewOfFile(mapping,
+									   FILE_MAP_READ,
+									   static_cast<DWORD>(view_offset >> 32),
+									   static_cast<DWORD>(view_offset & 0xFFFFFFFF),
+									   static_cast<SIZE_T>(view_size));
+
+			if (view == nullptr)
+			{
+				throw std::runtime_error{CODE_POS_STR + std::format("映射 {} 失败。", _path.ToString()) + msys::FormatError(GetLastError())};
+			}
+
+			WIN32_MEMORY_RANGE_ENTRY range{};
+			range.VirtualAddress = view;
+			range.NumberOfBytes = static_cast<SIZE_T>(view_size);
+
+			// 页面读入后会留在系统的文件缓存中，解除映射不影响。
+			BOOL call_result = PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+			DWORD error = GetLastError();
+			UnmapViewOfFile(view);
+
+			if (!call_result)
+			{
+				throw std::runtime_error{CODE_POS_STR + std::format("预读 {} 失败。", _path.ToString()) + msys::FormatError(error)};
+			}
+
+			return;
+		}
+	case base::FileAdvice::DontNeed:
+		{
+			FlushWriteBuffer();
+			_read_length = 0;
+			return;
+		}
+	}
+}
+
+/* #region 定位读写 */
+
+int64_t base::FileStream::OverlappedTransfer(bool is_read, int64_t offset, uint8_t *buffer, int64_t count)
+{
+	// 使用句柄期间不允许 AdviseAccessPattern 替换句柄。
+	std::shared_lock l{_handle_lock};
+	EnsureAsyncHandle();
+
+	if (_async_handle == INVALID_HANDLE_VALUE)
+	{
+		// 没有重叠句柄，只能在同步句柄上做定位读写，内核会把它们串行化，但结果仍然正确。
+		if (is_read)
+		{
+			return NativeRead(offset, buffer, count);
+		}
+
+		NativeWrite(offset, buffer, count);
+		return count;
+	}
+
+	// 事件句柄的最低位置 1, 操作完成后就不会往完成端口投递完成包。
+	HANDLE event = reinterpret_cast<HANDLE>(reinterpret_cast<uintptr_t>(ThreadEvent()) | 1);
+	int64_t have_transferred = 0;
+
+	while (have_transferred < count)
+	{
+		DWORD size = static_cast<DWORD>(std::min(count - have_transferred, MaxNativeIoSize));
+		OVERLAPPED overlapped = CreateOverlapped(offset + have_transferred);
+		overlapped.hEvent = event;
+
+		BOOL call_result = FALSE;
+
+		if (is_read)
+		{
+			call_result = ReadFile(_async_handle, buffer + have_transferred, size, nullptr, &overlapped);
+		}
+		else
+		{
+			call_result = WriteFile(_async_handle, buffer + have_transferred, size, nullptr, &overlapped);
+		}
+
+		DWORD error = ERROR_SUCCESS;
+		if (!call_result)
+		{
+			error = GetLastError();
+		}
+
+		DWORD once_transferred = 0;
+
+		if (error == ERROR_SUCCESS || error == ERROR_IO_PENDING)
+		{
+			if (!GetOverlappedResult(_async_handle, &overlapped, &once_transferred, TRUE))
+			{
+				error = GetLastError();
+			}
+			else
+			{
+				error = ERROR_SUCCESS;
+			}
+		}
+
+		if (error == ERROR_HANDLE_EOF)
+		{
+			break;
+		}
+
+		if (error != ERROR_SUCCESS)
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("读写 {} 失败。", _path.ToString()) + msys::FormatError(error)};
+		}
+
+		if (once_transferred == 0)
+		{
+			break;
+		}
+
+		have_transferred += once_transferred;
+	}
+
+	return have_transferred;
+}
+
+int64_t base::FileStream::ReadAt(int64_t offset, base::Span const &span)
+{
+	if (!_can_read)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法读取文件。"};
+	}
+
+	if (offset < 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "偏移量不能小于 0."};
+	}
+
+	if (!IsAligned(span.Buffer(), offset, span.Size()))
+	{
+		throw std::invalid_argument{CODE_POS_STR + "无缓冲模式下，内存、偏移量和大小都要按扇区对齐。"};
+	}
+
+	return OverlappedTransfer(true, offset, span.Buffer(), span.Size());
+}
+
+void base::FileStream::WriteAt(int64_t offset, base::ReadOnlySpan const &span)
+{
+	if (!_can_write)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法写入文件。"};
+	}
+
+	if (offset < 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "偏移量不能小于 0."};
+	}
+
+	if (!IsAligned(span.Buffer(), offset, span.Size()))
+	{
+		throw std::invalid_argument{CODE_POS_STR + "无缓冲模式下，内存、偏移量和大小都要按扇区对齐。"};
+	}
+
+	// WriteFile 不会修改缓冲区，这里去掉 const 只是为了和读取共用一个函数。
+	OverlappedTransfer(false, offset, const_cast<uint8_t *>(span.Buffer()), span.Size());
+}
+
+/* #endregion */
+
+/* #region 异步读写 */
+
+void base::FileStream::EnsureAsyncHandle()
+{
+	std::call_once(_async_init_flag, [this]()
+				   {
+					   DWORD access = 0;
+
+					   if (_can_read)
+					   {
+						   access |= GENERIC_READ;
+					   }
+
+					   if (_can_write)
+					   {
+						   access |= GENERIC_WRITE;
+					   }
+
+					   _async_handle = ReOpenFile(_handle,
+												  access,
+												  _share_mode,
+												  _flags | FILE_FLAG_OVERLAPPED);
+
+					   if (_async_handle == INVALID_HANDLE_VALUE)
+					   {
+						   // 无法重新打开，退化为在线程池中用 _handle 做同步读写。
+						   return;
+					   }
+
+					   // 关联失败时，重叠句柄仍然可以给 ReadAt 和 WriteAt 用。
+					   _async_by_iocp = msys::IoCompletionPort::Instance().Associate(_async_handle);
+				   });
+}
+
+void base::FileStream::SubmitAsync(bool is_read,
+								   int64_t offset,
+								   uint8_t *buffer,
+								   int64_t count,
+								   AsyncCallback callback)
+{
+	if (offset < 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "偏移量不能小于 0."};
+	}
+
+	if (count > MaxNativeIoSize)
+	{
+		throw std::invalid_argument{CODE_POS_STR + std::format("单次异步操作不能超过 {} 字节。", MaxNativeIoSize)};
+	}
+
+	// 发起期间不允许 AdviseAccessPattern 替换句柄。
+	std::shared_lock l{_handle_lock};
+	EnsureAsyncHandle();
+
+	if (!_async_by_iocp)
+	{
+		msys::ThreadPool::Instance().Post([this, is_read, offset, buffer, count, callback]()
+										  {
+											  int64_t transferred = 0;
+
+											  try
+											  {
+												  // 回调不在锁内调用，回调中可以再调用 AdviseAccessPattern.
+												  std::shared_lock l{_handle_lock};
+
+												  if (is_read)
+												  {
+													  transferred = NativeRead(offset, buffer, count);
+												  }
+												  else
+												  {
+													  NativeWrite(offset, buffer, count);
+													  transferred = count;
+												  }
+											  }
+											  catch (...)
+											  {
+												  callback(0, std::current_exception());
+												  return;
+											  }
+
+											  callback(transferred, nullptr);
+										  });
+
+		return;
+	}
+
+	std::string path = _path.ToString();
+
+	auto on_completed = [callback, path](DWORD bytes_transferred, DWORD error)
+	{
+		if (error == ERROR_SUCCESS || error == ERROR_HANDLE_EOF)
+		{
+			callback(bytes_transferred, nullptr);
+			return;
+		}
+
+		std::string message = CODE_POS_STR + std::format("异步读写 {} 失败。", path) + msys::FormatError(error);
+		callback(0, std::make_exception_ptr(std::runtime_error{message}));
+	};
+
+	msys::IoCompletionPort::Operation *operation = new msys::IoCompletionPort::Operation{offset, on_completed};
+
+	BOOL call_result = FALSE;
+
+	if (is_read)
+	{
+		call_result = ReadFile(_async_handle, buffer, static_cast<DWORD>(count), nullptr, operation);
+	}
+	else
+	{
+		call_result = WriteFile(_async_handle, buffer, static_cast<DWORD>(count), nullptr, operation);
+	}
+
+	if (call_result)
+	{
+		// 同步完成了，完成包仍然会投递到完成端口。
+		return;
+	}
+
+	DWORD error = GetLastError();
+	if (error == ERROR_IO_PENDING)
+	{
+		return;
+	}
+
+	// 没有发起成功，不会有完成包，要在这里回调。回调中可以调用 AdviseAccessPattern,
+	// 要先释放锁。
+	delete operation;
+	l.unlock();
+	on_completed(0, error);
+}
+
+void base::FileStream::ReadAsync(int64_t offset, base::Span const &span, AsyncCallback callback)
+{
+	if (!_can_read)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法读取文件。"};
+	}
+
+	SubmitAsync(true, offset, span.Buffer(), span.Size(), std::move(callback));
+}
+
+std::future<int64_t> base::FileStream::ReadAsync(int64_t offset, base::Span const &span)
+{
+	std::shared_ptr<std::promise<int64_t>> promise{new std::promise<int64_t>{}};
+	std::future<int64_t> future = promise->get_future();
+
+	ReadAsync(offset,
+			  span,
+			  [promise](int64_t bytes_transferred, std::exception_ptr exception)
+			  {
+				  if (exception != nullptr)
+				  {
+					  promise->set_exception(exception);
+					  return;
+				  }
+
+				  promise->set_value(bytes_transferred);
+			  });
+
+	return future;
+}
+
+void base::FileStream::WriteAsync(int64_t offset, base::ReadOnlySpan const &span, AsyncCallback callback)
+{
+	if (!_can_write)
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法写入文件。"};
+	}
+
+	// WriteFile 不会修改缓冲区，这里去掉 const 只是为了和读取共用一个函数。
+	SubmitAsync(false,
+				offset,
+				const_cast<uint8_t *>(span.Buffer()),
+				span.Size(),
+				std::move(callback));
+}
+
+std::future<int64_t> base::FileStream::WriteAsync(int64_t offset, base::ReadOnlySpan const &span)
+{
+	std::shared_ptr<std::promise<int64_t>> promise{new std::promise<int64_t>{}};
+	std::future<int64_t> future = promise->get_future();
+
+	WriteAsync(offset,
+			   span,
+			   [promise](int64_t bytes_transferred, std::exception_ptr exception)
+			   {
+				   if (exception != nullptr)
+				   {
+					   promise->set_exception(exception);
+					   return;
+				   }
+
+				   promise->set_value(bytes_transferred);
+			   });
+
+	return future;
 }
 
 /* #endregion */
@@ -1,40 +1,308 @@
 #pragma once
 #include "base/filesystem/Path.h"
 #include "base/string/define.h"
-#include <filesystem>
-#include <fstream>
+#include "msys-base/AlignedBuffer.h"
+#include "msys-base/OpenOptions.h"
+#include "msys-base/windows_api.h"
+#include "msys-base/WriteBehindWriter.h"
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <stdexcept>
+#include <vector>
 
 #if HAS_THREAD
 
 namespace base
 {
+	///
+	/// @brief 直接基于 Windows 文件句柄的文件流。
+	///
+	/// @note 内部带有一个用户态缓冲区。流的位置只是记录在对象中的一个整数，
+	/// 与内核交互时通过 OVERLAPPED 结构体指定偏移量，所以读写和定位都不会调用 seek.
+	///
 	class FileStream final :
 		public base::Stream
 	{
+	public:
+		///
+		/// @brief 异步操作完成后的回调。
+		///
+		/// @note 第 1 个参数是传输的字节数。第 2 个参数是操作失败时的异常，成功时为空。
+		///
+		using AsyncCallback = std::function<void(int64_t, std::exception_ptr)>;
+
 	private:
 		FileStream(base::Path const &path)
 		{
 			_path = path;
+			_buffer = base::AlignedBuffer{_buffer_size, 4096};
 		}
 
 		base::Path _path;
-		std::shared_ptr<std::fstream> _fs;
+		HANDLE _handle = INVALID_HANDLE_VALUE;
 		bool _can_read = false;
 		bool _can_write = false;
 		bool _can_seek = false;
 
+		///
+		/// @brief 打开文件时使用的共享模式。
+		///
+		DWORD _share_mode = FILE_SHARE_READ | FILE_SHARE_WRITE;
+
+		///
+		/// @brief 打开文件时使用的，可以在 ReOpenFile 时再次使用的 FILE_FLAG_* 标志。
+		///
+		DWORD _flags = 0;
+
+		///
+		/// @brief 流的当前位置。
+		///
+		int64_t _position = 0;
+
+		///
+		/// @brief 用户态缓冲区。
+		///
+		/// @note 同一时刻要么用来缓存读取到的数据，要么用来缓存待写入的数据，不会同时用于两者。
+		/// @note 按扇区对齐，这样无缓冲模式下也能直接用它与内核交互。
+		///
+		base::AlignedBuffer _buffer;
+
+		///
+		/// @brief 用户态缓冲区的大小。
+		///
+		int64_t _buffer_size = 1024 * 64;
+
+		///
+		/// @brief 无缓冲模式下要求的对齐字节数。为 0 表示不是无缓冲模式。
+		///
+		int64_t _alignment = 0;
+
+		///
+		/// @brief 缓冲区第 0 个字节对应的文件偏移量。
+		///
+		int64_t _buffer_file_offset = 0;
+
+		///
+		/// @brief 缓冲区中可读数据的长度。为 0 表示缓冲区中没有可读数据。
+		///
+		int64_t _read_length = 0;
+
+		///
+		/// @brief 缓冲区中尚未写入文件的数据的长度。为 0 表示缓冲区中没有待写入的数据。
+		///
+		int64_t _write_length = 0;
+
+		///
+		/// @brief 后台写入器。为空表示没有开启后台写入模式。
+		///
+		std::unique_ptr<msys::WriteBehindWriter> _write_behind;
+
+		///
+		/// @brief 用于异步操作的句柄。
+		///
+		/// @note 第一次发起异步操作时才用 ReOpenFile 以 FILE_FLAG_OVERLAPPED 重新打开，
+		/// 所以同步读写的路径不受影响。
+		///
+		HANDLE _async_handle = INVALID_HANDLE_VALUE;
+
+		///
+		/// @brief _async_handle 是否关联到了 IO 完成端口。
+		///
+		/// @note 为 false 时异步操作退化为在线程池中执行同步读写。
+		///
+		bool _async_by_iocp = false;
+
+		std::once_flag _async_init_flag;
+
+		///
+		/// @brief 保护 _handle, _async_handle 的替换。
+		///
+		/// @note 定位读写和异步读写在使用句柄期间持有共享锁，AdviseAccessPattern 替换句柄时持有独占锁。
+		///
+		std::shared_mutex _handle_lock;
+
+		///
+		/// @brief 被 AdviseAccessPattern 替换下来的重叠句柄。
+		///
+		/// @note 上面可能还有没完成的异步操作，关闭句柄会取消它们，所以留到 Close 时再关闭。
+		///
+		std::vector<HANDLE> _retired_async_handles;
+
+		///
+		/// @brief 按照 options 打开文件。只调用一次 CreateFileA.
+		///
+		/// @param path
+		/// @param options
+		/// @param error 失败时用来返回错误代码。
+		///
+		/// @return 成功返回 FileStream 对象，失败返回空指针。
+		///
+		static std::shared_ptr<base::FileStream> TryOpen(base::Path const &path,
+														 base::OpenOptions const &options,
+														 DWORD &error);
+
+		///
+		/// @brief 打开失败后，根据错误代码分析原因，生成错误消息。
+		///
+		/// @param path
+		/// @param options
+		/// @param error
+		///
+		/// @return
+		///
+		static std::string CreateOpenErrorMessage(base::Path const &path,
+												  base::OpenOptions const &options,
+												  DWORD error);
+
+		///
+		/// @brief 确保用于异步操作的句柄已经打开。
+		///
+		void EnsureAsyncHandle();
+
+		///
+		/// @brief 发起一次异步读写。
+		///
+		/// @param is_read 为 true 表示读取，为 false 表示写入。
+		/// @param offset
+		/// @param buffer
+		/// @param count
+		/// @param callback
+		///
+		void SubmitAsync(bool is_read,
+						 int64_t offset,
+						 uint8_t *buffer,
+						 int64_t count,
+						 AsyncCallback callback);
+
+		///
+		/// @brief 在 _async_handle 上发起读写并等待完成。供 ReadAt 和 WriteAt 使用。
+		///
+		/// @note 同步句柄上的读写会被内核按句柄串行化，重叠句柄不会，所以多个线程可以
+		/// 真正并行地读写。
+		///
+		/// @param is_read 为 true 表示读取，为 false 表示写入。
+		/// @param offset
+		/// @param buffer
+		/// @param count
+		///
+		/// @return 传输的字节数。
+		///
+		int64_t OverlappedTransfer(bool is_read, int64_t offset, uint8_t *buffer, int64_t count);
+
+		///
+		/// @brief 从文件的 offset 处读取 count 个字节到 buffer 中。不经过用户态缓冲区，
+		/// 也不改变流的位置。
+		///
+		/// @param offset
+		/// @param buffer
+		/// @param count
+		///
+		/// @return 实际读取的字节数。小于 count 说明到达文件末尾了。
+		///
+		int64_t NativeRead(int64_t offset, uint8_t *buffer, int64_t count);
+
+		///
+		/// @brief 将 buffer 中的 count 个字节写入到文件的 offset 处。不经过用户态缓冲区，
+		/// 也不改变流的位置。
+		///
+		/// @param offset
+		/// @param buffer
+		/// @param count
+		///
+		void NativeWrite(int64_t offset, uint8_t const *buffer, int64_t count);
+
+		///
+		/// @brief 文件在内核中的长度。不包括用户态缓冲区中待写入的数据。
+		///
+		/// @return
+		///
+		int64_t NativeLength() const;
+
+		///
+		/// @brief 通过句柄设置文件在内核中的长度。
+		///
+		/// @param value
+		///
+		void NativeSetLength(int64_t value);
+
+		///
+		/// @brief 无缓冲模式下，从 buffer 开始，在文件的 offset 处读写 count 个字节能否
+		/// 不经过用户态缓冲区。
+		///
+		/// @param buffer
+		/// @param offset
+		/// @param count
+		///
+		/// @return
+		///
+		bool IsAligned(uint8_t const *buffer, int64_t offset, int64_t count) const;
+
+		///
+		/// @brief 无缓冲模式下，在 _position 处用 ReadFileScatter 或 WriteFileGather 一次传输
+		/// segments 描述的所有内存页。成功后流的位置向后移动。
+		///
+		/// @param is_read 为 true 表示读取，为 false 表示写入。
+		/// @param segments 每页一个元素，以空元素结尾。
+		/// @param count 总字节数。
+		/// @param transferred 用来返回传输的字节数。
+		///
+		/// @return 不是无缓冲模式、位置或大小没有按扇区对齐、没有重叠句柄时返回 false,
+		/// 调用者要改为逐个 span 读写。
+		///
+		bool TryScatterGather(bool is_read,
+							  std::vector<FILE_SEGMENT_ELEMENT> &segments,
+							  int64_t count,
+							  int64_t &transferred);
+
+		///
+		/// @brief 开始往空的用户态缓冲区中写入数据，缓冲区将从 _position 处开始。
+		///
+		/// @note 无缓冲模式下缓冲区的起始偏移量要按扇区对齐，对齐后多出来的头部要先从文件中读出来。
+		///
+		void BeginWriteBuffer();
+
+		///
+		/// @brief 将用户态缓冲区中待写入的数据写入文件。
+		///
+		/// @note 后台写入模式下，等待后台写入器把数据全部写完。
+		///
+		void FlushWriteBuffer();
+
 	public:
 		~FileStream()
 		{
-			Close();
+			try
+			{
+				Close();
+			}
+			catch (...)
+			{
+			}
 		}
 
 		/* #region 工厂函数 */
 
+		///
+		/// @brief 按照 options 打开文件。只调用一次 CreateFileA.
+		///
+		/// @param path
+		/// @param options
+		///
+		/// @return 成功打开则返回 FileStream 对象。失败会抛出异常，不会返回空指针。
+		///
+		static std::shared_ptr<base::FileStream> Open(base::Path const &path, base::OpenOptions const &options);
+
 		///
 		/// @brief 先尝试打开文件。如果不存在会创建。
 		///
+		/// @note 路径是目录时删除目录后创建新文件。只读文件、没有权限的文件会抛出异常，不会被删除。
+		///
 		/// @param path
 		///
 		/// @return
@@ -104,48 +372,26 @@ namespace base
 		///
 		/// @return
 		///
-		virtual int64_t Length() const override
-		{
-			// 记录当前位置
-			int64_t current_pos = _fs->tellg();
-
-			// seek 到文件末尾
-			_fs->seekg(0, _fs->end);
-
-			// 记录文件末尾的位置（最后一个字节之后一个字节，所以 end_pos 等于文件长度）
-			int64_t end_pos = _fs->tellg();
-
-			// seek 回原来的位置
-			_fs->seekg(current_pos);
-
-			return end_pos;
-		}
+		virtual int64_t Length() const override;
 
 		///
 		/// @brief 设置流的长度。
 		///
 		/// @param value
 		///
-		virtual void SetLength(int64_t value) override
-		{
-			if (!_can_write)
-			{
-				throw std::runtime_error{CODE_POS_STR + "无法写入文件，所以无法设置文件长度。"};
-			}
+		virtual void SetLength(int64_t value) override;
 
-			if (!_can_seek)
-			{
-				throw std::runtime_error{CODE_POS_STR + "无法定位文件，所以无法设置文件长度。"};
-			}
-
-			// 防止 Position 属性超出边界
-			int64_t current_pos = Position();
-			SetPosition(std::min(value, current_pos));
-
-			// 重设大小
-			std::filesystem::resize_file(_path.ToString().c_str(), value);
-			std::cout << "更改大小后文件大小=" << Length() << std::endl;
-		}
+		///
+		/// @brief 为文件预留磁盘空间。
+		///
+		/// @note 已知最终大小的大文件，先预留好空间再写入，可以避免文件碎片，
+		/// 也可以避免每次写入导致文件变长时更新元数据。
+		///
+		/// @param length 预留到多大。小于等于当前长度时不做任何事。
+		/// @param keep_size 为 true 时只预留空间，不改变文件长度。为 false 时同时把文件长度
+		/// 设置为 length.
+		///
+		void Preallocate(int64_t length, bool keep_size = true);
 
 		///
 		/// @brief 流当前的位置。
@@ -154,12 +400,14 @@ namespace base
 		///
 		virtual int64_t Position() const override
 		{
-			return _fs->tellg();
+			return _position;
 		}
 
 		///
 		/// @brief 设置流当前的位置。
 		///
+		/// @note 只是修改记录在对象中的位置，不会与内核交互。
+		///
 		/// @param value
 		///
 		virtual void SetPosition(int64_t value) override
@@ -169,12 +417,12 @@ namespace base
 				throw std::runtime_error{CODE_POS_STR + "无法定位文件，所以无法设置文件指针位置。"};
 			}
 
-			/* 必须先清除标志。因为如果不清除，上次读写如果触发了 eof 了，即使在这里 seek 到非尾部
-			 * 下次读写流时仍会因为 eof 已经被设置了而无法读写。
-			 */
-			_fs->clear();
-			_fs->seekg(value);
-			_fs->seekp(value);
+			if (value < 0)
+			{
+				throw std::invalid_argument{CODE_POS_STR + "文件指针位置不能小于 0."};
+			}
+
+			_position = value;
 		}
 
 		/* #endregion */
@@ -188,29 +436,46 @@ namespace base
 		///
 		/// @return
 		///
-		virtual int64_t Read(base::Span const &span) override
-		{
-			_fs->read(reinterpret_cast<char *>(span.Buffer()), span.Size());
-			int64_t have_read = _fs->gcount();
-			SetPosition(_fs->tellg());
-			return have_read;
-		}
+		virtual int64_t Read(base::Span const &span) override;
 
 		///
 		/// @brief 将 span 中的数据写入本流。
 		///
 		/// @param span
 		///
-		virtual void Write(base::ReadOnlySpan const &span) override
-		{
-			if (!_can_write)
-			{
-				throw std::runtime_error{CODE_POS_STR + "无法写入文件。"};
-			}
+		virtual void Write(base::ReadOnlySpan const &span) override;
 
-			_fs->write(reinterpret_cast<char const *>(span.Buffer()), span.Size());
-			SetPosition(_fs->tellp());
-		}
+		///
+		/// @brief 依次读取数据到 spans 中的每一个 span.
+		///
+		/// @note 某个 span 没有被填满说明到达文件末尾了，此时不会再继续读取后面的 span.
+		///
+		/// @note 无缓冲模式下，如果每个 span 的内存和大小都按页对齐，流的位置按扇区对齐，
+		/// 用一次 ReadFileScatter 读完。其他情况逐个 span 调用 Read, 小的 span 由用户态缓冲区服务，
+		/// 不小于缓冲区的 span 各自是一次 ReadFile.
+		///
+		/// @param spans
+		///
+		/// @return 读取到的总字节数。
+		///
+		int64_t ReadV(std::vector<base::Span> const &spans);
+
+		///
+		/// @brief 依次将 spans 中的每一个 span 写入本流。
+		///
+		/// @note 总大小不超过用户态缓冲区时，所有 span 会在用户态缓冲区中拼接起来，
+		/// 最终用一次 WriteFile 写入，调用者不需要自己把它们拷贝到一个临时缓冲区中。
+		/// 总大小超过用户态缓冲区但不超过 1 MiB 时，拼接到一块临时内存中，也只有一次 WriteFile.
+		///
+		/// @note 无缓冲模式下，如果每个 span 的内存和大小都按页对齐，流的位置按扇区对齐，
+		/// 用一次 WriteFileGather 写入，不拷贝。
+		///
+		/// @note 其他情况，即缓冲模式下总大小超过 1 MiB, 或者无缓冲模式下有没对齐的 span,
+		/// 会逐个 span 调用 Write, 不小于用户态缓冲区的 span 各自是一次 WriteFile.
+		///
+		/// @param spans
+		///
+		void WriteV(std::vector<base::ReadOnlySpan> const &spans);
 
 		///
 		/// @brief 冲洗流。
@@ -225,7 +490,7 @@ namespace base
 				throw std::runtime_error{CODE_POS_STR + "无法写入文件，所以无法冲洗。"};
 			}
 
-			_fs->flush();
+			FlushWriteBuffer();
 		}
 
 		///
@@ -233,10 +498,139 @@ namespace base
 		///
 		/// @note 关闭后对流的操作将会引发异常。
 		///
-		virtual void Close() override
-		{
-			_fs->close();
-		}
+		virtual void Close() override;
+
+		/* #endregion */
+
+		///
+		/// @brief 开启后台写入模式。
+		///
+		/// @note 开启后，Write 只是把数据拷贝到池化的缓冲块中就返回，由后台线程写入文件，
+		/// 写入的延迟不再取决于磁盘。Flush 会等待后台线程写完。不调用 Flush 时，数据最迟在
+		/// 空闲 idle_flush_interval 之后写入文件。
+		/// @note 后台写入失败时，错误会在下一次调用 Write 或 Flush 等函数时抛出。
+		/// @note Read, SetLength 等需要看到最新数据的操作会先等待后台线程写完。
+		/// @note 不支持无缓冲模式。
+		///
+		/// @param block_size 每个缓冲块的大小。
+		/// @param block_count 缓冲块的数量。所有缓冲块都在排队时，Write 才会阻塞。
+		/// @param idle_flush_interval 多久没有调用 Write 后，后台线程把没填满的缓冲块也写入文件。
+		///
+		void EnableWriteBehind(int64_t block_size = 1024 * 1024,
+							   int64_t block_count = 8,
+							   std::chrono::milliseconds idle_flush_interval = std::chrono::milliseconds{1000});
+
+		///
+		/// @brief 文件所在卷的物理扇区大小。
+		///
+		/// @note 无缓冲模式下，直接交给内核的内存地址、大小和文件偏移量都要是它的整数倍。
+		///
+		/// @return 获取失败时返回 4096.
+		///
+		int64_t SectorSize() const;
+
+		///
+		/// @brief 告诉操作系统接下来怎么访问本文件。
+		///
+		/// @note Normal, Sequential, Random 会用 ReOpenFile 带上对应的 FILE_FLAG_* 标志重新打开
+		/// 句柄，作用于整个文件，会忽略 offset 和 length. 定位读写和异步读写使用的重叠句柄也会
+		/// 一起重新打开，同样带上新的标志。
+		///
+		/// @note 替换句柄时会等待其他线程上正在进行的 ReadAt, WriteAt 和异步操作的发起返回，
+		/// 已经发起的异步操作在旧句柄上完成。不能与同步的 Read, Write 等函数同时调用。
+		///
+		/// @note WillNeed 把 [offset, offset + length) 映射到内存中，用 PrefetchVirtualMemory
+		/// 让系统把这些页读入缓存。
+		///
+		/// @note Windows 的缓存管理器没有按区间淘汰文件缓存的接口，DontNeed 只会释放本流的
+		/// 用户态缓冲区中的数据。
+		///
+		/// @param advice
+		/// @param offset 区间的起始位置。
+		/// @param length 区间的长度。为 0 表示一直到文件末尾。
+		///
+		void AdviseAccessPattern(base::FileAdvice advice, int64_t offset, int64_t length);
+
+		/* #region 定位读写 */
+
+		///
+		/// @brief 从文件的 offset 处读取数据到 span 中。
+		///
+		/// @note 不使用也不改变流的位置，不经过用户态缓冲区。多个线程可以同时对同一个流调用
+		/// ReadAt 和 WriteAt, 不需要加锁。
+		/// @note 看不到还在用户态缓冲区中的数据。与 Write 混用时，要先 Flush.
+		/// @note 无缓冲模式下，span 的内存、offset 和大小都要按扇区对齐。
+		///
+		/// @param offset
+		/// @param span
+		///
+		/// @return 读取到的字节数。小于 span 的大小说明到达文件末尾了。
+		///
+		int64_t ReadAt(int64_t offset, base::Span const &span);
+
+		///
+		/// @brief 将 span 中的数据写入到文件的 offset 处。
+		///
+		/// @note 不使用也不改变流的位置，不经过用户态缓冲区。多个线程可以同时对同一个流调用
+		/// ReadAt 和 WriteAt, 不需要加锁。
+		/// @note 不会让用户态缓冲区中的数据失效。与 Read 混用时，不要读取被 WriteAt 改过的区域
+		/// 的旧缓存。
+		/// @note 无缓冲模式下，span 的内存、offset 和大小都要按扇区对齐。
+		///
+		/// @param offset
+		/// @param span
+		///
+		void WriteAt(int64_t offset, base::ReadOnlySpan const &span);
+
+		/* #endregion */
+
+		/* #region 异步读写 */
+
+		///
+		/// @brief 从文件的 offset 处异步读取数据到 span 中。
+		///
+		/// @note 不经过用户态缓冲区，也不改变流的位置。与同步写入混用时，要先 Flush.
+		/// @note 可以同时发起多个异步操作。span 的内存和本流都必须存活到回调被调用。
+		/// @note 回调在 IO 完成端口或线程池的线程上执行。
+		///
+		/// @param offset
+		/// @param span
+		/// @param callback
+		///
+		void ReadAsync(int64_t offset, base::Span const &span, AsyncCallback callback);
+
+		///
+		/// @brief 从文件的 offset 处异步读取数据到 span 中。
+		///
+		/// @param offset
+		/// @param span
+		///
+		/// @return 读取到的字节数。小于 span 的大小说明到达文件末尾了。
+		///
+		std::future<int64_t> ReadAsync(int64_t offset, base::Span const &span);
+
+		///
+		/// @brief 将 span 中的数据异步写入到文件的 offset 处。
+		///
+		/// @note 不经过用户态缓冲区，也不改变流的位置。与同步读写混用时，要先 Flush.
+		/// @note 可以同时发起多个异步操作。span 的内存和本流都必须存活到回调被调用。
+		/// @note 回调在 IO 完成端口或线程池的线程上执行。
+		///
+		/// @param offset
+		/// @param span
+		/// @param callback
+		///
+		void WriteAsync(int64_t offset, base::ReadOnlySpan const &span, AsyncCallback callback);
+
+		///
+		/// @brief 将 span 中的数据异步写入到文件的 offset 处。
+		///
+		/// @param offset
+		/// @param span
+		///
+		/// @return 写入的字节数。
+		///
+		std::future<int64_t> WriteAsync(int64_t offset, base::ReadOnlySpan const &span);
 
 		/* #endregion */
 	};
@@ -21,4 +21,30 @@ namespace msys
 		}
 	};
 
+	///
+	/// @brief 在析构时用 FindClose 关闭 FindFirstFileExA 返回的句柄。
+	///
+	class FindHandleGuard
+	{
+	private:
+		HANDLE _handle = INVALID_HANDLE_VALUE;
+
+	public:
+		FindHandleGuard(HANDLE handle)
+			: _handle{handle}
+		{
+		}
+
+		~FindHandleGuard()
+		{
+			if (_handle != INVALID_HANDLE_VALUE)
+			{
+				FindClose(_handle);
+			}
+		}
+
+		FindHandleGuard(FindHandleGuard const &) = delete;
+		FindHandleGuard &operator=(FindHandleGuard const &) = delete;
+	};
+
 } // namespace msys
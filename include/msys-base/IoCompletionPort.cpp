@@ -0,0 +1,117 @@
+#include "IoCompletionPort.h"
+#include <algorithm>
+
+namespace
+{
+	///
+	/// @brief 投递这个完成键表示让工作线程退出。
+	///
+	ULONG_PTR constexpr ExitKey = 1;
+
+} // namespace
+
+msys::IoCompletionPort::IoCompletionPort()
+{
+	_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0);
+	if (_port == nullptr)
+	{
+		return;
+	}
+
+	int64_t thread_count = std::max<int64_t>(std::thread::hardware_concurrency(), 1);
+
+	for (int64_t i = 0; i < thread_count; i++)
+	{
+		_threads.emplace_back([this]()
+							  {
+								  WorkerThreadFunc();
+							  });
+	}
+}
+
+msys::IoCompletionPort::~IoCompletionPort()
+{
+	if (_port == nullptr)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < _threads.size(); i++)
+	{
+		PostQueuedCompletionStatus(_port, 0, ExitKey, nullptr);
+	}
+
+	for (std::thread &thread : _threads)
+	{
+		thread.join();
+	}
+
+	CloseHandle(_port);
+	_port = nullptr;
+}
+
+msys::IoCompletionPort &msys::IoCompletionPort::Instance()
+{
+	return *SharedInstance();
+}
+
+std::shared_ptr<msys::IoCompletionPort> const &msys::IoCompletionPort::SharedInstance()
+{
+	static std::shared_ptr<msys::IoCompletionPort> port{new msys::IoCompletionPort{}};
+	return port;
+}
+
+bool msys::IoCompletionPort::Associate(HANDLE handle)
+{
+	if (_port == nullptr)
+	{
+		return false;
+	}
+
+	return CreateIoCompletionPort(handle, _port, 0, 0) == _port;
+}
+
+void msys::IoCompletionPort::WorkerThreadFunc()
+{
+	while (true)
+	{
+		DWORD bytes_transferred = 0;
+		ULONG_PTR key = 0;
+		OVERLAPPED *overlapped = nullptr;
+
+		BOOL call_result = GetQueuedCompletionStatus(_port,
+													 &bytes_transferred,
+													 &key,
+													 &overlapped,
+													 INFINITE);
+
+		if (overlapped == nullptr)
+		{
+			if (key == ExitKey)
+			{
+				return;
+			}
+
+			// 完成端口本身出错，没有取出任何完成包。
+			continue;
+		}
+
+		DWORD error = ERROR_SUCCESS;
+		if (!call_result)
+		{
+			error = GetLastError();
+		}
+
+		Operation *operation = static_cast<Operation *>(overlapped);
+
+		try
+		{
+			operation->_callback(bytes_transferred, error);
+		}
+		catch (...)
+		{
+		}
+
+		delete operation;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "msys-base/windows_api.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace msys
+{
+	///
+	/// @brief 进程共享的 IO 完成端口。
+	///
+	/// @note 内部有若干个线程等待完成包，异步操作完成后在这些线程上调用回调函数。
+	///
+	class IoCompletionPort
+	{
+	public:
+		///
+		/// @brief 一次异步操作。
+		///
+		/// @note 把本对象的指针作为 OVERLAPPED 指针传给 ReadFile, WriteFile 等函数。
+		/// 操作完成后，完成端口的线程会调用 _callback, 然后 delete 本对象。
+		///
+		class Operation :
+			public OVERLAPPED
+		{
+		public:
+			///
+			/// @brief 操作完成后的回调。
+			///
+			/// @note 第 1 个参数是传输的字节数，第 2 个参数是错误代码，成功时为 ERROR_SUCCESS.
+			///
+			std::function<void(DWORD, DWORD)> _callback;
+
+			Operation(int64_t offset, std::function<void(DWORD, DWORD)> callback)
+				: OVERLAPPED{},
+				  _callback{std::move(callback)}
+			{
+				Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+				OffsetHigh = static_cast<DWORD>(offset >> 32);
+			}
+		};
+
+	private:
+		HANDLE _port = nullptr;
+		std::vector<std::thread> _threads;
+
+		IoCompletionPort();
+
+		///
+		/// @brief 工作线程的线程函数。
+		///
+		void WorkerThreadFunc();
+
+	public:
+		~IoCompletionPort();
+
+		///
+		/// @brief 单例。
+		///
+		/// @return
+		///
+		static msys::IoCompletionPort &Instance();
+
+		///
+		/// @brief 以共享指针持有的单例。
+		///
+		/// @note 静态对象按构造的逆序析构。在析构时还要等待完成包的对象，如果可能在完成端口之前构造，
+		/// 应该持有这个指针，让完成端口在自己之后析构。
+		///
+		/// @return
+		///
+		static std::shared_ptr<msys::IoCompletionPort> const &SharedInstance();
+
+		///
+		/// @brief 完成端口是否可用。
+		///
+		/// @return
+		///
+		bool IsValid() const
+		{
+			return _port != nullptr;
+		}
+
+		///
+		/// @brief 将以 FILE_FLAG_OVERLAPPED 打开的句柄关联到完成端口。
+		///
+		/// @param handle
+		///
+		/// @return 成功返回 true. 失败返回 false, 此时调用者应该改用其他方式执行异步操作。
+		///
+		bool Associate(HANDLE handle);
+	};
+
+} // namespace msys
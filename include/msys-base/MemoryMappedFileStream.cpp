@@ -0,0 +1,253 @@
+#include "MemoryMappedFileStream.h"
+#include "base/filesystem/filesystem.h"
+#include "msys-base/win32_error.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	///
+	/// @brief 整体映射失败时退化为窗口映射所使用的窗口大小。
+	///
+	int64_t constexpr FallbackWindowSize = 1024 * 1024 * 256;
+
+	///
+	/// @brief 系统的分配粒度。视图的起始偏移量必须是它的整数倍。
+	///
+	/// @return
+	///
+	int64_t AllocationGranularity()
+	{
+		static int64_t const granularity = []()
+		{
+			SYSTEM_INFO info{};
+			GetSystemInfo(&info);
+			return static_cast<int64_t>(info.dwAllocationGranularity);
+		}();
+
+		return granularity;
+	}
+
+} // namespace
+
+/* #region 工厂函数 */
+
+std::shared_ptr<base::MemoryMappedFileStream> base::MemoryMappedFileStream::OpenFileAndCreateMapping(base::Path const &path)
+{
+	std::shared_ptr<MemoryMappedFileStream> fs{new MemoryMappedFileStream{path}};
+
+	fs->_file_handle = CreateFileA(base::filesystem::ToWindowsLongPathString(path).c_str(),
+								   GENERIC_READ,
+								   FILE_SHARE_READ | FILE_SHARE_WRITE,
+								   nullptr,
+								   OPEN_EXISTING,
+								   FILE_ATTRIBUTE_NORMAL,
+								   nullptr);
+
+	if (fs->_file_handle == INVALID_HANDLE_VALUE)
+	{
+		std::string message = CODE_POS_STR + std::format("打开 {} 失败。", path.ToString()) + msys::FormatError(GetLastError());
+		throw std::runtime_error{message};
+	}
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(fs->_file_handle, &size))
+	{
+		std::string message = CODE_POS_STR + std::format("获取 {} 的大小失败。", path.ToString()) + msys::FormatError(GetLastError());
+		throw std::runtime_error{message};
+	}
+
+	fs->_length = size.QuadPart;
+
+	if (fs->_length == 0)
+	{
+		// 无法为空文件创建映射对象。空文件也没有什么可读的，不创建就行了。
+		return fs;
+	}
+
+	fs->_mapping_handle = CreateFileMappingA(fs->_file_handle,
+											 nullptr,
+											 PAGE_READONLY,
+											 0,
+											 0,
+											 nullptr);
+
+	if (fs->_mapping_handle == nullptr)
+	{
+		std::string message = CODE_POS_STR + std::format("为 {} 创建文件映射对象失败。", path.ToString()) + msys::FormatError(GetLastError());
+		throw std::runtime_error{message};
+	}
+
+	return fs;
+}
+
+std::shared_ptr<base::MemoryMappedFileStream> base::MemoryMappedFileStream::Open(base::Path const &path)
+{
+	std::shared_ptr<MemoryMappedFileStream> fs = OpenFileAndCreateMapping(path);
+
+	if (fs->_length == 0)
+	{
+		return fs;
+	}
+
+	if (fs->_length > static_cast<int64_t>(SIZE_MAX))
+	{
+		// 地址空间放不下。
+		fs->_window_size = FallbackWindowSize;
+		return fs;
+	}
+
+	fs->_view = static_cast<uint8_t *>(MapViewOfFile(fs->_mapping_handle, FILE_MAP_READ, 0, 0, 0));
+
+	if (fs->_view == nullptr)
+	{
+		DWORD error = GetLastError();
+		if (error != ERROR_NOT_ENOUGH_MEMORY)
+		{
+			std::string message = CODE_POS_STR + std::format("映射 {} 失败。", path.ToString()) + msys::FormatError(error);
+			throw std::runtime_error{message};
+		}
+
+		// 找不到足够大的连续地址空间，退化为窗口映射。
+		fs->_window_size = FallbackWindowSize;
+		return fs;
+	}
+
+	fs->_view_offset = 0;
+	fs->_view_size = fs->_length;
+	return fs;
+}
+
+std::shared_ptr<base::MemoryMappedFileStream> base::MemoryMappedFileStream::OpenWindowed(base::Path const &path,
+																						  int64_t window_size)
+{
+	if (window_size <= 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "窗口大小必须大于 0."};
+	}
+
+	std::shared_ptr<MemoryMappedFileStream> fs = OpenFileAndCreateMapping(path);
+
+	int64_t granularity = AllocationGranularity();
+	fs->_window_size = (window_size + granularity - 1) / granularity * granularity;
+	return fs;
+}
+
+/* #endregion */
+
+void base::MemoryMappedFileStream::EnsureMapped(int64_t offset, int64_t size)
+{
+	if (_view != nullptr &&
+		offset >= _view_offset &&
+		offset + size <= _view_offset + _view_size)
+	{
+		return;
+	}
+
+	if (_mapping_handle == nullptr)
+	{
+		throw std::runtime_error{CODE_POS_STR + "流已关闭，或者文件为空。"};
+	}
+
+	Unmap();
+
+	int64_t view_offset = offset / AllocationGranularity() * AllocationGranularity();
+	int64_t view_end = std::min(std::max(view_offset + _window_size, offset + size), _length);
+	int64_t view_size = view_end - view_offset;
+
+	_view = static_cast<uint8_t *>(MapViewOfFile(_mapping_handle,
+												 FILE_MAP_READ,
+												 static_cast<DWORD>(view_offset >> 32),
+												 static_cast<DWORD>(view_offset & 0xFFFFFFFF),
+												 static_cast<SIZE_T>(view_size)));
+
+	if (_view == nullptr)
+	{
+		std::string message = CODE_POS_STR + std::format("映射 {} 的 [{}, {}) 区间失败。",
+														 _path.ToString(),
+														 view_offset,
+														 view_end) +
+							  msys::FormatError(GetLastError());
+
+		throw std::runtime_error{message};
+	}
+
+	_view_offset = view_offset;
+	_view_size = view_size;
+}
+
+void base::MemoryMappedFileStream::Unmap()
+{
+	if (_view == nullptr)
+	{
+		return;
+	}
+
+	UnmapViewOfFile(_view);
+	_view = nullptr;
+	_view_offset = 0;
+	_view_size = 0;
+}
+
+base::ReadOnlySpan base::MemoryMappedFileStream::View(int64_t offset, int64_t size)
+{
+	if (offset < 0 || size < 0 || offset + size > _length)
+	{
+		std::string message = CODE_POS_STR + std::format("区间 [{}, {}) 超出了文件范围。文件长度：{}",
+														 offset,
+														 offset + size,
+														 _length);
+
+		throw std::out_of_range{message};
+	}
+
+	if (size == 0)
+	{
+		return base::ReadOnlySpan{};
+	}
+
+	EnsureMapped(offset, size);
+	return base::ReadOnlySpan(_view + (offset - _view_offset), size);
+}
+
+int64_t base::MemoryMappedFileStream::Read(base::Span const &span)
+{
+	uint8_t *buffer = span.Buffer();
+	int64_t count = span.Size();
+	int64_t have_read = 0;
+
+	while (have_read < count && _position < _length)
+	{
+		int64_t size = std::min(count - have_read, _length - _position);
+
+		if (_window_size > 0)
+		{
+			// 窗口模式下每次最多拷贝一个窗口。
+			size = std::min(size, _window_size);
+		}
+
+		EnsureMapped(_position, size);
+		std::memcpy(buffer + have_read, _view + (_position - _view_offset), size);
+		have_read += size;
+		_position += size;
+	}
+
+	return have_read;
+}
+
+void base::MemoryMappedFileStream::Close()
+{
+	Unmap();
+
+	if (_mapping_handle != nullptr)
+	{
+		CloseHandle(_mapping_handle);
+		_mapping_handle = nullptr;
+	}
+
+	if (_file_handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file_handle);
+		_file_handle = INVALID_HANDLE_VALUE;
+	}
+}
@@ -0,0 +1,252 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include "base/string/define.h"
+#include "msys-base/windows_api.h"
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace base
+{
+	///
+	/// @brief 将文件映射到内存中的只读流。
+	///
+	/// @note 除了 base::Stream 的接口外，还可以通过 View 函数直接拿到映射内存的视图，
+	/// 不需要拷贝到调用者的缓冲区中。
+	///
+	/// @note 有两种映射模式：
+	/// 	@li 整体映射。整个文件映射成一块连续的内存，View 返回的视图在流关闭前一直有效。
+	/// 	@li 窗口映射。每次只映射文件的一个窗口，用于比地址空间还大的文件。窗口移动后，
+	/// 	之前 View 返回的视图就失效了。
+	///
+	/// @note 与 base::FileStream 的默认选项一样允许其他人读写，可以与正在写入的进程共存。
+	/// 流的长度在打开时确定，之后追加的内容读不到。
+	///
+	class MemoryMappedFileStream final :
+		public base::Stream
+	{
+	private:
+		MemoryMappedFileStream(base::Path const &path)
+		{
+			_path = path;
+		}
+
+		base::Path _path;
+		HANDLE _file_handle = INVALID_HANDLE_VALUE;
+		HANDLE _mapping_handle = nullptr;
+		int64_t _length = 0;
+		int64_t _position = 0;
+
+		///
+		/// @brief 窗口大小。为 0 表示整体映射。
+		///
+		int64_t _window_size = 0;
+
+		///
+		/// @brief 当前映射的视图。
+		///
+		uint8_t *_view = nullptr;
+
+		///
+		/// @brief 当前视图的第 0 个字节对应的文件偏移量。
+		///
+		int64_t _view_offset = 0;
+
+		///
+		/// @brief 当前视图的大小。
+		///
+		int64_t _view_size = 0;
+
+		///
+		/// @brief 打开文件并创建文件映射对象。
+		///
+		/// @param path
+		///
+		/// @return
+		///
+		static std::shared_ptr<base::MemoryMappedFileStream> OpenFileAndCreateMapping(base::Path const &path);
+
+		///
+		/// @brief 映射一个视图，使其覆盖文件的 [offset, offset + size) 区间。
+		///
+		/// @note 如果当前视图已经覆盖了这个区间，不会重新映射。
+		///
+		/// @param offset
+		/// @param size
+		///
+		void EnsureMapped(int64_t offset, int64_t size);
+
+		///
+		/// @brief 解除当前视图的映射。
+		///
+		void Unmap();
+
+	public:
+		~MemoryMappedFileStream()
+		{
+			Close();
+		}
+
+		/* #region 工厂函数 */
+
+		///
+		/// @brief 整体映射一个存在的文件。
+		///
+		/// @note 如果地址空间不足以容纳整个文件，会自动退化为窗口映射。
+		///
+		/// @param path
+		///
+		/// @return 成功打开则返回对象。失败会抛出异常，不会返回空指针。
+		///
+		static std::shared_ptr<base::MemoryMappedFileStream> Open(base::Path const &path);
+
+		///
+		/// @brief 以窗口映射模式打开一个存在的文件。
+		///
+		/// @param path
+		/// @param window_size 窗口大小。会向上对齐到系统的分配粒度。
+		///
+		/// @return 成功打开则返回对象。失败会抛出异常，不会返回空指针。
+		///
+		static std::shared_ptr<base::MemoryMappedFileStream> OpenWindowed(base::Path const &path,
+																		  int64_t window_size);
+
+		/* #endregion */
+
+		///
+		/// @brief 获取文件 [offset, offset + size) 区间的只读视图。不会发生拷贝。
+		///
+		/// @note 整体映射模式下，视图在流关闭前一直有效。窗口映射模式下，下一次 View 或 Read
+		/// 如果移动了窗口，之前的视图就会失效。
+		///
+		/// @note 访问映射内存时如果发生 IO 错误，系统会抛出 EXCEPTION_IN_PAGE_ERROR 结构化异常，
+		/// 而不是 C++ 异常。
+		///
+		/// @param offset
+		/// @param size
+		///
+		/// @return
+		///
+		base::ReadOnlySpan View(int64_t offset, int64_t size);
+
+		/* #region 流属性 */
+
+		///
+		/// @brief 本流能否读取。
+		///
+		/// @return
+		///
+		virtual bool CanRead() const override
+		{
+			return true;
+		}
+
+		///
+		/// @brief 本流能否写入。
+		///
+		/// @return
+		///
+		virtual bool CanWrite() const override
+		{
+			return false;
+		}
+
+		///
+		/// @brief 本流能否定位。
+		///
+		/// @return
+		///
+		virtual bool CanSeek() const override
+		{
+			return true;
+		}
+
+		///
+		/// @brief 流的长度
+		///
+		/// @note 打开时的文件长度。映射期间文件长度不会改变。
+		///
+		/// @return
+		///
+		virtual int64_t Length() const override
+		{
+			return _length;
+		}
+
+		///
+		/// @brief 设置流的长度。
+		///
+		/// @param value
+		///
+		virtual void SetLength(int64_t value) override
+		{
+			throw std::runtime_error{CODE_POS_STR + "只读的内存映射流无法设置长度。"};
+		}
+
+		///
+		/// @brief 流当前的位置。
+		///
+		/// @return
+		///
+		virtual int64_t Position() const override
+		{
+			return _position;
+		}
+
+		///
+		/// @brief 设置流当前的位置。
+		///
+		/// @param value
+		///
+		virtual void SetPosition(int64_t value) override
+		{
+			if (value < 0)
+			{
+				throw std::invalid_argument{CODE_POS_STR + "流的位置不能小于 0."};
+			}
+
+			_position = value;
+		}
+
+		/* #endregion */
+
+		/* #region 读写冲关 */
+
+		///
+		/// @brief 将本流的数据读取到 span 中。
+		///
+		/// @param span
+		///
+		/// @return
+		///
+		virtual int64_t Read(base::Span const &span) override;
+
+		///
+		/// @brief 将 span 中的数据写入本流。
+		///
+		/// @param span
+		///
+		virtual void Write(base::ReadOnlySpan const &span) override
+		{
+			throw std::runtime_error{CODE_POS_STR + "只读的内存映射流无法写入。"};
+		}
+
+		///
+		/// @brief 冲洗流。
+		///
+		virtual void Flush() override
+		{
+			throw std::runtime_error{CODE_POS_STR + "只读的内存映射流无法冲洗。"};
+		}
+
+		///
+		/// @brief 关闭流。
+		///
+		/// @note 关闭后对流的操作将会引发异常。
+		///
+		virtual void Close() override;
+
+		/* #endregion */
+	};
+
+} // namespace base
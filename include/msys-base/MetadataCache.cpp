@@ -0,0 +1,283 @@
+#include "MetadataCache.h"
+#include "base/filesystem/filesystem.h"
+#include "base/string/define.h"
+#include "msys-base/DirectorySnapshot.h"
+#include "msys-base/windows_api.h"
+#include <stdexcept>
+
+/* #region InvalidationGuard */
+
+msys::MetadataCache::InvalidationGuard::InvalidationGuard(base::Path const &path)
+	: _path(path)
+{
+}
+
+msys::MetadataCache::InvalidationGuard::~InvalidationGuard()
+{
+	try
+	{
+		msys::MetadataCache::Instance().Invalidate(_path);
+	}
+	catch (...)
+	{
+	}
+}
+
+/* #endregion */
+
+msys::MetadataCache::MetadataCache()
+{
+}
+
+msys::MetadataCache::~MetadataCache()
+{
+	Disable();
+}
+
+msys::MetadataCache &msys::MetadataCache::Instance()
+{
+	static msys::MetadataCache cache{};
+	return cache;
+}
+
+std::wstring msys::MetadataCache::ToKey(base::Path const &path)
+{
+	return msys::ToPathKey(base::filesystem::ToWindowsLongPathString(path));
+}
+
+msys::MetadataCache::Entry *msys::MetadataCache::Find(std::wstring const &key)
+{
+	auto it = _entries.find(key);
+
+	if (it == _entries.end())
+	{
+		return nullptr;
+	}
+
+	if (std::chrono::steady_clock::now() >= it->second.expire_time)
+	{
+		_lru.erase(it->second.lru_position);
+		_entries.erase(it);
+		return nullptr;
+	}
+
+	_lru.splice(_lru.begin(), _lru, it->second.lru_position);
+	return &it->second;
+}
+
+msys::MetadataCache::Entry &msys::MetadataCache::FindOrInsert(std::wstring const &key)
+{
+	Entry *entry = Find(key);
+
+	if (entry != nullptr)
+	{
+		return *entry;
+	}
+
+	while (!_lru.empty() && static_cast<int64_t>(_entries.size()) >= _options.capacity)
+	{
+		_entries.erase(_lru.back());
+		_lru.pop_back();
+	}
+
+	_lru.push_front(key);
+
+	Entry &new_entry = _entries[key];
+	new_entry.expire_time = std::chrono::steady_clock::now() + _options.ttl;
+	new_entry.lru_position = _lru.begin();
+	return new_entry;
+}
+
+void msys::MetadataCache::InvalidateKey(std::wstring const &key)
+{
+	_generation++;
+
+	// 同一个前缀下，子路径和名称更长的兄弟路径交错排列，只删除分隔符之后的部分。
+	auto it = _entries.lower_bound(key);
+
+	while (it != _entries.end() && it->first.starts_with(key))
+	{
+		if (it->first.size() == key.size() || it->first[key.size()] == L'\\')
+		{
+			_lru.erase(it->second.lru_position);
+			it = _entries.erase(it);
+			continue;
+		}
+
+		++it;
+	}
+}
+
+void msys::MetadataCache::OnChanges(std::vector<msys::DirectoryChange> const &changes)
+{
+	std::vector<std::wstring> keys;
+
+	for (msys::DirectoryChange const &change : changes)
+	{
+		keys.push_back(ToKey(change.path));
+	}
+
+	std::lock_guard l{_lock};
+
+	for (std::wstring const &key : keys)
+	{
+		InvalidateKey(key);
+	}
+}
+
+void msys::MetadataCache::Enable(msys::MetadataCacheOptions const &options)
+{
+	if (options.capacity <= 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "capacity 必须大于 0."};
+	}
+
+	std::lock_guard l{_lock};
+	_options = options;
+
+	if (_monitor == nullptr)
+	{
+		_monitor = std::unique_ptr<msys::DirectoryChangeMonitor>{new msys::DirectoryChangeMonitor{
+			[this](std::vector<msys::DirectoryChange> const &changes)
+			{
+				OnChanges(changes);
+			},
+		}};
+	}
+
+	_enabled = true;
+}
+
+void msys::MetadataCache::Disable()
+{
+	std::unique_ptr<msys::DirectoryChangeMonitor> monitor;
+
+	{
+		std::lock_guard l{_lock};
+		_enabled = false;
+		monitor = std::move(_monitor);
+		_entries.clear();
+		_lru.clear();
+		_generation++;
+	}
+
+	// 监视器析构时会等待正在进行的回调，回调要获取 _lock, 所以在锁外析构。
+	monitor.reset();
+}
+
+void msys::MetadataCache::AddWatchRoot(base::Path const &root)
+{
+	std::lock_guard l{_lock};
+
+	if (_monitor == nullptr)
+	{
+		throw std::runtime_error{CODE_POS_STR + "元数据缓存没有开启。"};
+	}
+
+	_monitor->AddWatch(root);
+
+	// 监视开始之前缓存的状态可能已经过时。
+	InvalidateKey(ToKey(root));
+}
+
+void msys::MetadataCache::Invalidate(base::Path const &path)
+{
+	if (!_enabled)
+	{
+		return;
+	}
+
+	std::wstring key = ToKey(path);
+	std::lock_guard l{_lock};
+	InvalidateKey(key);
+}
+
+void msys::MetadataCache::Clear()
+{
+	std::lock_guard l{_lock};
+	_entries.clear();
+	_lru.clear();
+	_generation++;
+}
+
+msys::FileStatus msys::MetadataCache::Status(base::Path const &path, bool follow_links)
+{
+	if (!_enabled)
+	{
+		return msys::Status(path, follow_links);
+	}
+
+	std::wstring key = ToKey(path);
+	std::optional<msys::FileStatus> status;
+	uint64_t generation = 0;
+
+	{
+		std::lock_guard l{_lock};
+		Entry *entry = Find(key);
+
+		if (entry != nullptr)
+		{
+			status = entry->status;
+		}
+
+		generation = _generation;
+	}
+
+	if (!status.has_value())
+	{
+		status = msys::Status(path, false);
+
+		std::lock_guard l{_lock};
+
+		if (_enabled && _generation == generation)
+		{
+			FindOrInsert(key).status = status;
+		}
+	}
+
+	if (follow_links && (status->attributes & FILE_ATTRIBUTE_REPARSE_POINT))
+	{
+		// 链接目标被修改时，变化通知和 InvalidationGuard 只会让目标路径失效，
+		// 以链接路径为键缓存的目标状态会过时。
+		return msys::Status(path, true);
+	}
+
+	return status.value();
+}
+
+base::Path msys::MetadataCache::ReadSymbolicLink(base::Path const &path,
+												 std::function<base::Path(base::Path const &)> const &read)
+{
+	if (!_enabled)
+	{
+		return read(path);
+	}
+
+	std::wstring key = ToKey(path);
+	uint64_t generation = 0;
+
+	{
+		std::lock_guard l{_lock};
+		Entry *entry = Find(key);
+
+		if (entry != nullptr && entry->link_target.has_value())
+		{
+			return entry->link_target.value();
+		}
+
+		generation = _generation;
+	}
+
+	base::Path target = read(path);
+
+	{
+		std::lock_guard l{_lock};
+
+		if (_enabled && _generation == generation)
+		{
+			FindOrInsert(key).link_target = target;
+		}
+	}
+
+	return target;
+}
@@ -0,0 +1,208 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include "msys-base/DirectoryChangeMonitor.h"
+#include "msys-base/FileStatus.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace msys
+{
+	///
+	/// @brief 元数据缓存的选项。
+	///
+	class MetadataCacheOptions
+	{
+	public:
+		///
+		/// @brief 最多缓存多少个路径。超过后淘汰最久没有访问的路径。
+		///
+		int64_t capacity = 1024 * 128;
+
+		///
+		/// @brief 每个路径从第一次缓存起的有效期。
+		///
+		/// @note 不在监视目录下的路径只靠有效期保证不会一直过时。
+		///
+		std::chrono::milliseconds ttl{5000};
+	};
+
+	///
+	/// @brief 进程共享的元数据缓存，缓存 base::filesystem::Exists, IsDirectory, IsRegularFile,
+	/// IsSymbolicLink 和 ReadSymboliclink 的结果。默认关闭，调用 Enable 后生效。
+	///
+	/// @note 缓存按 LRU 淘汰，每个路径有有效期。AddWatchRoot 添加的目录树由 msys::DirectoryChangeMonitor
+	/// 监视，其中条目变化时，这个路径以及它下面的所有路径立即失效。
+	///
+	/// @note 不存在的路径也会缓存。
+	///
+	/// @note 本库中修改文件系统的函数通过 InvalidationGuard 在返回时让被修改的路径失效，
+	/// 不用等变化通知。
+	///
+	class MetadataCache
+	{
+	public:
+		///
+		/// @brief 在析构时让 path 及其下所有路径的缓存失效。
+		///
+		/// @note 修改文件系统的函数在开头构造它，无论成功还是抛出异常，返回后缓存中都不会留下修改前的状态。
+		///
+		class InvalidationGuard
+		{
+		private:
+			base::Path _path;
+
+		public:
+			InvalidationGuard(base::Path const &path);
+			~InvalidationGuard();
+
+			InvalidationGuard(InvalidationGuard const &) = delete;
+			InvalidationGuard &operator=(InvalidationGuard const &) = delete;
+		};
+
+	private:
+		///
+		/// @brief 一个路径的缓存。
+		///
+		class Entry
+		{
+		public:
+			///
+			/// @brief 不跟随链接的状态。
+			///
+			std::optional<msys::FileStatus> status;
+
+			///
+			/// @brief 符号链接指向的路径。
+			///
+			std::optional<base::Path> link_target;
+
+			std::chrono::steady_clock::time_point expire_time;
+
+			///
+			/// @brief 在 _lru 中的位置。
+			///
+			std::list<std::wstring>::iterator lru_position;
+		};
+
+		std::atomic_bool _enabled = false;
+
+		std::mutex _lock;
+		msys::MetadataCacheOptions _options;
+
+		///
+		/// @brief 键是 Windows 长路径经过 msys::ToPathKey 转换的结果。有序，方便让一个目录下的路径一起失效。
+		///
+		std::map<std::wstring, Entry> _entries;
+
+		///
+		/// @brief 最近访问的在前。
+		///
+		std::list<std::wstring> _lru;
+
+		///
+		/// @brief 每次失效都加 1. 查询文件系统期间发生过失效，查询结果就不放入缓存。
+		///
+		uint64_t _generation = 0;
+
+		std::unique_ptr<msys::DirectoryChangeMonitor> _monitor;
+
+		MetadataCache();
+
+		static std::wstring ToKey(base::Path const &path);
+
+		///
+		/// @brief 查找没有过期的缓存，并移到 LRU 的最前面。要在持有 _lock 时调用。
+		///
+		Entry *Find(std::wstring const &key);
+
+		///
+		/// @brief 查找或插入缓存，需要时淘汰最久没有访问的路径。要在持有 _lock 时调用。
+		///
+		Entry &FindOrInsert(std::wstring const &key);
+
+		///
+		/// @brief 让 key 及其下所有路径失效。要在持有 _lock 时调用。
+		///
+		void InvalidateKey(std::wstring const &key);
+
+		void OnChanges(std::vector<msys::DirectoryChange> const &changes);
+
+	public:
+		~MetadataCache();
+
+		MetadataCache(MetadataCache const &) = delete;
+		MetadataCache &operator=(MetadataCache const &) = delete;
+
+		static msys::MetadataCache &Instance();
+
+		///
+		/// @brief 开启缓存。已经开启时只更新选项。
+		///
+		/// @param options
+		///
+		void Enable(msys::MetadataCacheOptions const &options);
+
+		///
+		/// @brief 关闭缓存，停止所有监视并清空缓存。
+		///
+		void Disable();
+
+		bool IsEnabled() const
+		{
+			return _enabled;
+		}
+
+		///
+		/// @brief 递归监视 root, 其中条目变化时相应的缓存立即失效。要在开启后调用。
+		///
+		/// @param root
+		///
+		void AddWatchRoot(base::Path const &root);
+
+		///
+		/// @brief 让 path 及其下所有路径失效。
+		///
+		/// @param path
+		///
+		void Invalidate(base::Path const &path);
+
+		///
+		/// @brief 清空缓存。
+		///
+		void Clear();
+
+		///
+		/// @brief 带缓存的 msys::Status. 没有开启时直接调用 msys::Status.
+		///
+		/// @note 只缓存不跟随链接的状态。路径不是重分析点时跟随与否结果相同，直接返回缓存的状态；
+		/// 是重分析点时链接目标的变化不会让链接路径失效，所以跟随链接的状态每次都重新获取。
+		///
+		/// @param path
+		/// @param follow_links
+		///
+		/// @return
+		///
+		msys::FileStatus Status(base::Path const &path, bool follow_links);
+
+		///
+		/// @brief 带缓存的读取符号链接。
+		///
+		/// @param path
+		/// @param read 没有缓存时用来读取。
+		///
+		/// @return
+		///
+		base::Path ReadSymbolicLink(base::Path const &path,
+									std::function<base::Path(base::Path const &)> const &read);
+	};
+
+} // namespace msys
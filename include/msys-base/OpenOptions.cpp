@@ -0,0 +1 @@
+#include "OpenOptions.h" // IWYU pragma: keep
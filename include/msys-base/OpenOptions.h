@@ -0,0 +1,149 @@
+#pragma once
+
+namespace base
+{
+	///
+	/// @brief 打开文件时请求的访问权限。
+	///
+	enum class FileAccess
+	{
+		Read,
+		Write,
+		ReadWrite,
+	};
+
+	///
+	/// @brief 文件存在或不存在时怎么处理。
+	///
+	enum class FileCreateDisposition
+	{
+		///
+		/// @brief 只打开存在的文件。不存在则失败。
+		///
+		OpenExisting,
+
+		///
+		/// @brief 只创建新文件。已存在则失败。
+		///
+		CreateNew,
+
+		///
+		/// @brief 总是创建新文件。已存在则截断为 0 字节。
+		///
+		CreateAlways,
+
+		///
+		/// @brief 存在则打开，不存在则创建。
+		///
+		OpenAlways,
+
+		///
+		/// @brief 打开存在的文件并截断为 0 字节。不存在则失败。
+		///
+		TruncateExisting,
+	};
+
+	///
+	/// @brief 访问模式提示。供操作系统的缓存管理器决定预读策略。
+	///
+	enum class FileAccessHint
+	{
+		Normal,
+
+		///
+		/// @brief 从头到尾顺序访问。
+		///
+		Sequential,
+
+		///
+		/// @brief 随机访问。
+		///
+		Random,
+	};
+
+	///
+	/// @brief 打开文件后对访问模式的建议。用于 base::FileStream::AdviseAccessPattern.
+	///
+	enum class FileAdvice
+	{
+		///
+		/// @brief 没有特别的访问模式。恢复默认的预读策略。
+		///
+		Normal,
+
+		///
+		/// @brief 接下来会顺序访问。
+		///
+		Sequential,
+
+		///
+		/// @brief 接下来会随机访问，不要预读。
+		///
+		Random,
+
+		///
+		/// @brief 指定的区间很快就会被访问，提前读入缓存。
+		///
+		WillNeed,
+
+		///
+		/// @brief 指定的区间短期内不会再被访问。
+		///
+		DontNeed,
+	};
+
+	///
+	/// @brief 打开文件的选项。
+	///
+	/// @note 用于 base::FileStream::Open. 打开时只调用一次 CreateFileA, 不会预先检查文件
+	/// 是否存在、是否是目录、是否可读写。失败后才根据错误代码判断原因。
+	///
+	class OpenOptions
+	{
+	public:
+		base::FileAccess access = base::FileAccess::ReadWrite;
+		base::FileCreateDisposition disposition = base::FileCreateDisposition::OpenExisting;
+
+		///
+		/// @brief 允许其他句柄同时读取。
+		///
+		bool share_read = true;
+
+		///
+		/// @brief 允许其他句柄同时写入。
+		///
+		bool share_write = true;
+
+		///
+		/// @brief 允许其他句柄同时删除或重命名。
+		///
+		bool share_delete = false;
+
+		base::FileAccessHint hint = base::FileAccessHint::Normal;
+
+		///
+		/// @brief 如果路径是符号链接，打开符号链接本身，而不是它指向的目标。
+		///
+		bool no_follow = false;
+
+		///
+		/// @brief 临时文件。操作系统会尽量让它的数据留在缓存中，不写入磁盘。
+		///
+		bool temporary = false;
+
+		///
+		/// @brief 最后一个句柄关闭时删除文件。
+		///
+		bool delete_on_close = false;
+
+		///
+		/// @brief 无缓冲模式。读写绕过操作系统的文件缓存，直接与磁盘交互。
+		///
+		/// @note 适合只写一次、不会再读的大文件，避免把其他程序的缓存挤出去。
+		/// @note FileStream 内部会处理对齐。调用者的内存、位置和大小都按扇区对齐时，
+		/// 大块读写不会经过用户态缓冲区。对齐的内存可以用 base::AlignedBuffer 分配。
+		///
+		bool no_buffering = false;
+	};
+
+} // namespace base
@@ -0,0 +1,388 @@
+#include "ParallelDirectoryWalker.h"
+#include <utility>
+
+namespace
+{
+	///
+	/// @brief 用枚举器的当前条目构造遍历结果。
+	///
+	/// @param directory 条目所在的目录。
+	/// @param depth 条目的深度。
+	/// @param enumerator
+	///
+	/// @return
+	///
+	msys::ParallelWalkEntry CreateEntry(base::Path const &directory,
+										int64_t depth,
+										msys::DirectoryBatchEnumerator &enumerator)
+	{
+		msys::DirectoryBatchEntry const &current = enumerator.Current();
+
+		msys::ParallelWalkEntry entry;
+		entry.path = directory + base::Path{enumerator.CurrentNarrowName()};
+		entry.type = current.type;
+		entry.size = current.size;
+		entry.last_write_time = current.last_write_time;
+		entry.attributes = current.attributes;
+		entry.reparse_tag = current.reparse_tag;
+		entry.depth = depth;
+		return entry;
+	}
+
+} // namespace
+
+msys::ParallelDirectoryWalker::ParallelDirectoryWalker(base::Path const &path,
+													   msys::ParallelDirectoryWalkerOptions const &options)
+	: _options(options),
+	  _queue(options.queue_capacity),
+	  _pool(options.thread_count)
+{
+	if (_options.depth_first_order)
+	{
+		std::shared_ptr<DirectoryNode> root{new DirectoryNode{}};
+		root->path = path;
+		root->depth = 0;
+
+		Post([this, root]()
+			 {
+				 EmitInOrder(root);
+			 });
+
+		return;
+	}
+
+	Post([this, path]()
+		 {
+			 ReadDirectory(path, 0);
+		 });
+}
+
+msys::ParallelDirectoryWalker::~ParallelDirectoryWalker()
+{
+	Stop();
+	WaitForTasks();
+}
+
+bool msys::ParallelDirectoryWalker::IsStopping() const
+{
+	if (_stopping)
+	{
+		return true;
+	}
+
+	return _options.cancellation_token != nullptr && _options.cancellation_token->IsCancellationRequested();
+}
+
+void msys::ParallelDirectoryWalker::Post(std::function<void()> task)
+{
+	{
+		std::lock_guard l{_lock};
+
+		if (_error != nullptr)
+		{
+			return;
+		}
+
+		_task_count++;
+	}
+
+	_pool.Post([this, task = std::move(task)]()
+			   {
+				   std::exception_ptr error;
+
+				   try
+				   {
+					   task();
+				   }
+				   catch (...)
+				   {
+					   error = std::current_exception();
+				   }
+
+				   bool finished = false;
+
+				   {
+					   std::lock_guard l{_lock};
+
+					   if (error != nullptr && _error == nullptr)
+					   {
+						   _error = error;
+					   }
+
+					   _task_count--;
+					   finished = _task_count == 0;
+				   }
+
+				   if (error != nullptr)
+				   {
+					   // 出错后其他任务不再读取新的条目。
+					   Stop();
+				   }
+
+				   _condition.notify_all();
+
+				   if (finished)
+				   {
+					   _finished = true;
+					   _push_signal++;
+					   _push_signal.notify_all();
+				   }
+			   });
+}
+
+bool msys::ParallelDirectoryWalker::Push(msys::ParallelWalkEntry &entry)
+{
+	while (true)
+	{
+		// 先取信号再尝试入队。入队失败后如果有人出队，信号已经变化，wait 会立即返回。
+		uint64_t signal = _pop_signal.load();
+
+		if (IsStopping())
+		{
+			return false;
+		}
+
+		if (_queue.TryPush(entry))
+		{
+			_push_signal++;
+			_push_signal.notify_one();
+			return true;
+		}
+
+		_pop_signal.wait(signal);
+	}
+}
+
+void msys::ParallelDirectoryWalker::Stop()
+{
+	_stopping = true;
+
+	_pop_signal++;
+	_pop_signal.notify_all();
+
+	_push_signal++;
+	_push_signal.notify_all();
+}
+
+void msys::ParallelDirectoryWalker::WaitForTasks()
+{
+	std::unique_lock l{_lock};
+
+	_condition.wait(l, [this]()
+					{
+						return _task_count == 0;
+					});
+}
+
+void msys::ParallelDirectoryWalker::ReadDirectory(base::Path const &path, int64_t depth)
+{
+	msys::DirectoryBatchEnumerator enumerator{path};
+
+	while (!IsStopping() && enumerator.MoveNext())
+	{
+		msys::ParallelWalkEntry entry = CreateEntry(path, depth, enumerator);
+
+		if (entry.type == msys::DirectoryEntryType::Directory)
+		{
+			// 先提交子目录，让它的读取与当前目录剩下的条目重叠。
+			Post([this, child = entry.path, depth]()
+				 {
+					 ReadDirectory(child, depth + 1);
+				 });
+		}
+
+		if (!Push(entry))
+		{
+			return;
+		}
+	}
+}
+
+void msys::ParallelDirectoryWalker::ReadNode(std::shared_ptr<DirectoryNode> const &node)
+{
+	std::vector<std::shared_ptr<DirectoryNode>> read_ahead_nodes;
+
+	try
+	{
+		msys::DirectoryBatchEnumerator enumerator{node->path};
+
+		while (!IsStopping() && enumerator.MoveNext())
+		{
+			node->entries.push_back(CreateEntry(node->path, node->depth, enumerator));
+			msys::ParallelWalkEntry const &entry = node->entries.back();
+
+			if (entry.type == msys::DirectoryEntryType::Directory)
+			{
+				std::shared_ptr<DirectoryNode> child{new DirectoryNode{}};
+				child->path = entry.path;
+				child->depth = node->depth + 1;
+				node->children.push_back(std::move(child));
+			}
+		}
+
+		for (std::shared_ptr<DirectoryNode> const &child : node->children)
+		{
+			if (_read_ahead_count >= _options.max_read_ahead_count)
+			{
+				// 剩下的子目录等输出到它们时再读取。
+				break;
+			}
+
+			_read_ahead_count++;
+			child->read_ahead = true;
+			read_ahead_nodes.push_back(child);
+		}
+	}
+	catch (...)
+	{
+		node->error = std::current_exception();
+	}
+
+	node->state = NodeState::Ready;
+	node->state.notify_all();
+
+	for (std::shared_ptr<DirectoryNode> &child : read_ahead_nodes)
+	{
+		Post([this, child = std::move(child)]()
+			 {
+				 if (IsStopping())
+				 {
+					 return;
+				 }
+
+				 // 输出线程可能已经先一步开始读取了。
+				 NodeState expected = NodeState::NotStarted;
+				 if (child->state.compare_exchange_strong(expected, NodeState::Reading))
+				 {
+					 ReadNode(child);
+				 }
+			 });
+	}
+}
+
+void msys::ParallelDirectoryWalker::WaitForNode(std::shared_ptr<DirectoryNode> const &node)
+{
+	NodeState state = NodeState::NotStarted;
+
+	if (node->state.compare_exchange_strong(state, NodeState::Reading))
+	{
+		ReadNode(node);
+	}
+	else
+	{
+		while (state != NodeState::Ready)
+		{
+			node->state.wait(state);
+			state = node->state;
+		}
+	}
+
+	if (node->error != nullptr)
+	{
+		std::rethrow_exception(node->error);
+	}
+}
+
+void msys::ParallelDirectoryWalker::EmitInOrder(std::shared_ptr<DirectoryNode> const &root)
+{
+	///
+	/// @brief 正在输出的目录。
+	///
+	class Frame
+	{
+	public:
+		std::shared_ptr<DirectoryNode> node;
+
+		///
+		/// @brief 下一个要输出的条目。
+		///
+		size_t entry_index = 0;
+
+		///
+		/// @brief 下一个要进入的子目录。
+		///
+		size_t child_index = 0;
+	};
+
+	// 目录树可能很深，用显式的栈代替递归。
+	std::vector<Frame> stack;
+
+	WaitForNode(root);
+	stack.push_back(Frame{root});
+
+	while (!stack.empty())
+	{
+		Frame &frame = stack.back();
+		DirectoryNode &node = *frame.node;
+
+		if (frame.entry_index == node.entries.size())
+		{
+			// 整个子树已经输出完，释放它占用的内存。
+			if (node.read_ahead)
+			{
+				_read_ahead_count--;
+			}
+
+			node.entries = std::vector<msys::ParallelWalkEntry>{};
+			node.children = std::vector<std::shared_ptr<DirectoryNode>>{};
+			stack.pop_back();
+			continue;
+		}
+
+		msys::ParallelWalkEntry &entry = node.entries[frame.entry_index++];
+		bool is_directory = entry.type == msys::DirectoryEntryType::Directory;
+
+		if (!Push(entry))
+		{
+			return;
+		}
+
+		if (is_directory)
+		{
+			std::shared_ptr<DirectoryNode> child = node.children[frame.child_index++];
+			WaitForNode(child);
+
+			// push_back 之后 frame 和 node 不再有效。
+			stack.push_back(Frame{std::move(child)});
+		}
+	}
+}
+
+bool msys::ParallelDirectoryWalker::MoveNext()
+{
+	while (true)
+	{
+		// 先取信号和结束标志再尝试出队，避免错过最后的条目和唤醒。
+		uint64_t signal = _push_signal.load();
+		bool finished = _finished;
+
+		if (_queue.TryPop(_current))
+		{
+			_pop_signal++;
+			_pop_signal.notify_one();
+			return true;
+		}
+
+		if (_options.cancellation_token != nullptr && _options.cancellation_token->IsCancellationRequested())
+		{
+			Stop();
+			WaitForTasks();
+			_options.cancellation_token->ThrowIfCancellationRequested();
+		}
+
+		if (finished)
+		{
+			std::lock_guard l{_lock};
+
+			if (_error != nullptr)
+			{
+				std::rethrow_exception(_error);
+			}
+
+			_current = msys::ParallelWalkEntry{};
+			return false;
+		}
+
+		_push_signal.wait(signal);
+	}
+}
@@ -0,0 +1,292 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include "msys-base/BoundedConcurrentQueue.h"
+#include "msys-base/CancellationToken.h"
+#include "msys-base/DirectoryBatchEnumerator.h"
+#include "msys-base/ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace msys
+{
+	///
+	/// @brief 并行遍历得到的一个条目。
+	///
+	class ParallelWalkEntry
+	{
+	public:
+		base::Path path;
+
+		msys::DirectoryEntryType type = msys::DirectoryEntryType::Other;
+
+		///
+		/// @brief 文件大小。目录为 0.
+		///
+		int64_t size = 0;
+
+		///
+		/// @brief 最后修改时间。FILETIME 的值，单位是 100 纳秒。
+		///
+		int64_t last_write_time = 0;
+
+		///
+		/// @brief FILE_ATTRIBUTE_* 属性。
+		///
+		uint32_t attributes = 0;
+
+		///
+		/// @brief 重分析点标记。不是重分析点则为 0.
+		///
+		uint32_t reparse_tag = 0;
+
+		///
+		/// @brief 深度。根目录下的条目为 0.
+		///
+		int64_t depth = 0;
+	};
+
+	///
+	/// @brief 并行遍历目录树的选项。
+	///
+	class ParallelDirectoryWalkerOptions
+	{
+	public:
+		///
+		/// @brief 读取目录的线程数。小于等于 0 时使用硬件线程数。
+		///
+		int64_t thread_count = 0;
+
+		///
+		/// @brief 结果队列的容量。
+		///
+		/// @note 队列满了之后读取线程会等待使用者取走条目。
+		///
+		int64_t queue_capacity = 1024 * 4;
+
+		///
+		/// @brief 按深度优先的顺序输出。
+		///
+		/// @note 为 true 时输出顺序与 msys::RecursiveDirectoryEntryEnumerator 相同：目录条目之后
+		/// 紧接着它的整个子树。目录仍然由线程池提前并行读取，只是按顺序输出。
+		///
+		/// @note 为 false 时条目读出来就输出，不同子树的条目交错出现，延迟最低。
+		///
+		bool depth_first_order = false;
+
+		///
+		/// @brief 按顺序输出时，最多提前读取多少个还没输出的目录。
+		///
+		/// @note 限制提前读取的目录数，避免巨大的目录树全部堆在内存中。
+		///
+		int64_t max_read_ahead_count = 1024;
+
+		///
+		/// @brief 取消令牌。可以为空。
+		///
+		/// @note 请求取消后读取线程不再读取新的条目。MoveNext 在所有线程停下来后抛出
+		/// msys::OperationCanceledException.
+		///
+		std::shared_ptr<msys::CancellationToken> cancellation_token;
+	};
+
+	///
+	/// @brief 并行递归遍历目录树。
+	///
+	/// @note 每个目录由线程池上的一个任务用 msys::DirectoryBatchEnumerator 成批读取，子目录交给新的任务，
+	/// 不同目录的读取互相重叠。读出的条目放入有界的无锁队列，调用 MoveNext 的线程从队列中取出。
+	///
+	/// @note 不会进入符号链接和目录交接点，与 msys::RecursiveDirectoryEntryEnumerator 相同。
+	///
+	/// @note 某个目录读取失败后不再读取新的条目。队列中已有的条目取完后，MoveNext 抛出第一个错误。
+	///
+	class ParallelDirectoryWalker
+	{
+	private:
+		///
+		/// @brief 按顺序输出时目录节点的状态。
+		///
+		enum class NodeState
+		{
+			NotStarted,
+			Reading,
+			Ready,
+		};
+
+		///
+		/// @brief 按顺序输出时的目录节点。
+		///
+		class DirectoryNode
+		{
+		public:
+			base::Path path;
+
+			///
+			/// @brief 目录中条目的深度。
+			///
+			int64_t depth = 0;
+
+			std::atomic<NodeState> state = NodeState::NotStarted;
+
+			///
+			/// @brief 是否计入了提前读取的目录数。
+			///
+			bool read_ahead = false;
+
+			std::vector<msys::ParallelWalkEntry> entries;
+
+			///
+			/// @brief 子目录节点。顺序与 entries 中的目录相同。
+			///
+			std::vector<std::shared_ptr<DirectoryNode>> children;
+
+			///
+			/// @brief 读取失败时的错误。输出到这个目录时抛出。
+			///
+			std::exception_ptr error;
+		};
+
+		msys::ParallelDirectoryWalkerOptions _options;
+		msys::BoundedConcurrentQueue<msys::ParallelWalkEntry> _queue;
+		msys::ParallelWalkEntry _current;
+
+		std::atomic_bool _stopping = false;
+
+		///
+		/// @brief 所有任务都已结束。
+		///
+		std::atomic_bool _finished = false;
+
+		///
+		/// @brief 每次入队后递增。使用者在队列空时等待它变化。
+		///
+		std::atomic_uint64_t _push_signal = 0;
+
+		///
+		/// @brief 每次出队后递增。读取线程在队列满时等待它变化。
+		///
+		std::atomic_uint64_t _pop_signal = 0;
+
+		///
+		/// @brief 已经安排提前读取、还没输出完的目录数。
+		///
+		std::atomic_int64_t _read_ahead_count = 0;
+
+		std::mutex _lock;
+		std::condition_variable _condition;
+
+		///
+		/// @brief 已经提交但还没执行完的任务数。
+		///
+		int64_t _task_count = 0;
+
+		std::exception_ptr _error;
+
+		///
+		/// @brief 放在最后，析构时最先等待工作线程退出。
+		///
+		msys::ThreadPool _pool;
+
+		///
+		/// @brief 是否应该停下来。已经停止、出错或请求了取消。
+		///
+		/// @return
+		///
+		bool IsStopping() const;
+
+		///
+		/// @brief 向线程池提交任务。已经出错时不再提交。
+		///
+		void Post(std::function<void()> task);
+
+		///
+		/// @brief 将条目放入队列。队列满时等待。
+		///
+		/// @param entry 成功时被移走。
+		///
+		/// @return 等待期间需要停下来时返回 false.
+		///
+		bool Push(msys::ParallelWalkEntry &entry);
+
+		///
+		/// @brief 让所有任务尽快停下来，并唤醒正在等待的线程。
+		///
+		void Stop();
+
+		///
+		/// @brief 等待所有任务结束。
+		///
+		void WaitForTasks();
+
+		///
+		/// @brief 读取一个目录，条目直接放入队列，子目录交给新的任务。
+		///
+		/// @param path
+		/// @param depth 目录中条目的深度。
+		///
+		void ReadDirectory(base::Path const &path, int64_t depth);
+
+		///
+		/// @brief 读取目录节点，安排提前读取子目录，然后将节点标记为就绪。
+		///
+		/// @note 调用者需要先把节点从 NotStarted 切换为 Reading.
+		///
+		void ReadNode(std::shared_ptr<DirectoryNode> const &node);
+
+		///
+		/// @brief 等待节点就绪。还没有人开始读取时在当前线程读取。
+		///
+		/// @note 节点读取失败时抛出读取时的错误。
+		///
+		void WaitForNode(std::shared_ptr<DirectoryNode> const &node);
+
+		///
+		/// @brief 按深度优先的顺序输出目录树。
+		///
+		void EmitInOrder(std::shared_ptr<DirectoryNode> const &root);
+
+	public:
+		///
+		/// @brief 开始遍历。
+		///
+		/// @note 根目录本身不会输出。根目录打不开时在第一次调用 MoveNext 时抛出异常。
+		///
+		/// @param path 根目录。
+		/// @param options
+		///
+		ParallelDirectoryWalker(base::Path const &path, msys::ParallelDirectoryWalkerOptions const &options);
+
+		///
+		/// @brief 停止遍历，等待所有线程停下来。
+		///
+		~ParallelDirectoryWalker();
+
+		ParallelDirectoryWalker(ParallelDirectoryWalker const &) = delete;
+		ParallelDirectoryWalker &operator=(ParallelDirectoryWalker const &) = delete;
+
+		///
+		/// @brief 取出下一个条目。队列空时等待。
+		///
+		/// @note 只能在一个线程上调用。
+		///
+		/// @return 遍历完时返回 false.
+		///
+		bool MoveNext();
+
+		///
+		/// @brief 当前条目。
+		///
+		/// @return
+		///
+		msys::ParallelWalkEntry const &Current() const
+		{
+			return _current;
+		}
+	};
+
+} // namespace msys
@@ -17,6 +17,7 @@ namespace msys
 	{
 	private:
 		base::filesystem::DirectoryEntry _current;
+		bool _current_valid = false;
 		std::filesystem::recursive_directory_iterator _current_it;
 		std::filesystem::recursive_directory_iterator _end_it;
 		base::IEnumerator<base::filesystem::DirectoryEntry const>::Context_t _context{};
@@ -50,7 +51,13 @@ namespace msys
 		///
 		virtual base::filesystem::DirectoryEntry const &CurrentValue() override
 		{
-			_current = base::filesystem::DirectoryEntry{base::filesystem::WindowsLongPathStringToPath(_current_it->path().string())};
+			// 同一个位置只构造一次。
+			if (!_current_valid)
+			{
+				_current = base::filesystem::DirectoryEntry{base::filesystem::WindowsLongPathStringToPath(_current_it->path().string())};
+				_current_valid = true;
+			}
+
 			return _current;
 		}
 
@@ -61,6 +68,7 @@ namespace msys
 		virtual void Add() override
 		{
 			++_current_it;
+			_current_valid = false;
 		}
 
 		///
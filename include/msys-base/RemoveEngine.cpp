@@ -0,0 +1,224 @@
+#include "RemoveEngine.h"
+#include "base/filesystem/filesystem.h"
+#include "base/string/define.h"
+#include "msys-base/DirectorySnapshot.h"
+#include "msys-base/win32_error.h"
+#include "msys-base/windows_api.h"
+#include <stdexcept>
+
+namespace
+{
+	///
+	/// @brief 每个删除任务处理的条目数。
+	///
+	size_t constexpr RemoveBatchSize = 64;
+
+} // namespace
+
+msys::RemoveEngine::RemoveEngine(int64_t thread_count)
+	: _pool(thread_count)
+{
+}
+
+void msys::RemoveEngine::Post(std::function<void()> task)
+{
+	{
+		std::lock_guard l{_lock};
+
+		if (_error != nullptr)
+		{
+			return;
+		}
+
+		_task_count++;
+	}
+
+	_pool.Post([this, task = std::move(task)]()
+			   {
+				   std::exception_ptr error;
+
+				   try
+				   {
+					   task();
+				   }
+				   catch (...)
+				   {
+					   error = std::current_exception();
+				   }
+
+				   {
+					   std::lock_guard l{_lock};
+
+					   if (error != nullptr && _error == nullptr)
+					   {
+						   _error = error;
+					   }
+
+					   _task_count--;
+				   }
+
+				   _condition.notify_all();
+			   });
+}
+
+msys::RemoveEngine::DirectoryNode *msys::RemoveEngine::CreateNode(std::string path,
+																   DirectoryNode *parent,
+																   uint32_t attributes)
+{
+	std::unique_ptr<DirectoryNode> node{new DirectoryNode{}};
+	node->path = std::move(path);
+	node->parent = parent;
+	node->attributes = attributes;
+
+	DirectoryNode *ret = node.get();
+	std::lock_guard l{_lock};
+	_nodes.push_back(std::move(node));
+	return ret;
+}
+
+void msys::RemoveEngine::RemoveEntry(std::string const &path, uint32_t attributes)
+{
+	if (attributes & FILE_ATTRIBUTE_READONLY)
+	{
+		if (!SetFileAttributesA(path.c_str(), attributes & ~FILE_ATTRIBUTE_READONLY))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("移除 {} 的只读属性失败。", path) + msys::FormatError(GetLastError())};
+		}
+	}
+
+	// 指向目录的符号链接和目录交接点带有目录属性，要用 RemoveDirectoryA 删除链接本身。
+	bool call_result = (attributes & FILE_ATTRIBUTE_DIRECTORY) ? RemoveDirectoryA(path.c_str()) : DeleteFileA(path.c_str());
+
+	if (!call_result)
+	{
+		DWORD error = GetLastError();
+
+		if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND)
+		{
+			// 已经被别人删除了。
+			return;
+		}
+
+		throw std::runtime_error{CODE_POS_STR + std::format("删除 {} 失败。", path) + msys::FormatError(error)};
+	}
+}
+
+void msys::RemoveEngine::Release(DirectoryNode *node, int64_t count)
+{
+	while (node != nullptr)
+	{
+		if (node->pending_count.fetch_sub(count) != count)
+		{
+			// 还有子条目没删除。
+			return;
+		}
+
+		// 目录已经空了。
+		RemoveEntry(node->path, node->attributes);
+		node = node->parent;
+		count = 1;
+	}
+}
+
+void msys::RemoveEngine::RemoveEntries(DirectoryNode *node, std::vector<EntryToRemove> const &entries)
+{
+	for (EntryToRemove const &entry : entries)
+	{
+		RemoveEntry(entry.path, entry.attributes);
+	}
+
+	Release(node, static_cast<int64_t>(entries.size()));
+}
+
+void msys::RemoveEngine::EnumerateDirectory(DirectoryNode *node)
+{
+	std::vector<EntryToRemove> batch;
+
+	msys::ForEachDirectoryEntry(node->path,
+								[&](WIN32_FIND_DATAA const &data)
+								{
+									std::string path = node->path + "\\" + data.cFileName;
+									node->pending_count++;
+
+									if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+										!(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+									{
+										DirectoryNode *child = CreateNode(std::move(path), node, data.dwFileAttributes);
+
+										Post([this, child]()
+											 {
+												 EnumerateDirectory(child);
+											 });
+
+										return true;
+									}
+
+									batch.push_back(EntryToRemove{std::move(path), static_cast<uint32_t>(data.dwFileAttributes)});
+
+									if (batch.size() == RemoveBatchSize)
+									{
+										Post([this, node, batch = std::move(batch)]()
+											 {
+												 RemoveEntries(node, batch);
+											 });
+
+										batch = std::vector<EntryToRemove>{};
+									}
+
+									return true;
+								});
+
+	if (!batch.empty())
+	{
+		Post([this, node, batch = std::move(batch)]()
+			 {
+				 RemoveEntries(node, batch);
+			 });
+	}
+
+	// 枚举完成，释放额外加的 1.
+	Release(node, 1);
+}
+
+void msys::RemoveEngine::RemoveDirectoryTree(base::Path const &path)
+{
+	std::string root_path = base::filesystem::ToWindowsLongPathString(path);
+	DWORD attributes = GetFileAttributesA(root_path.c_str());
+
+	if (attributes == INVALID_FILE_ATTRIBUTES)
+	{
+		throw std::runtime_error{CODE_POS_STR + std::format("获取 {} 的属性失败。", path.ToString()) + msys::FormatError(GetLastError())};
+	}
+
+	if (attributes & FILE_ATTRIBUTE_REPARSE_POINT)
+	{
+		// 目录交接点，只删除它本身，不能进入它指向的目录。
+		RemoveEntry(root_path, attributes);
+		return;
+	}
+
+	DirectoryNode *root = CreateNode(root_path, nullptr, attributes);
+
+	Post([this, root]()
+		 {
+			 EnumerateDirectory(root);
+		 });
+
+	{
+		std::unique_lock l{_lock};
+
+		_condition.wait(l, [this]()
+						{
+							return _task_count == 0;
+						});
+	}
+
+	_nodes.clear();
+
+	if (_error != nullptr)
+	{
+		std::exception_ptr error = _error;
+		_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
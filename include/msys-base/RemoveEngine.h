@@ -0,0 +1,134 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include "msys-base/ThreadPool.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace msys
+{
+	///
+	/// @brief 并行删除目录树。
+	///
+	/// @note 遍历、清除只读属性、删除在一趟中完成：
+	/// 	@li 每个目录由一个任务用 FindFirstFileExA 枚举，子目录交给新的任务。
+	/// 	@li 文件分批交给线程池并行删除。只读属性来自枚举结果，只对带有只读属性的条目清除。
+	/// 	@li 每个目录记录还没删除的子条目数，减到 0 时删除目录本身，再通知父目录。
+	/// 目录因此从下往上删除，不需要第二次遍历。
+	///
+	/// @note 不会进入符号链接和目录交接点，只删除链接本身。
+	///
+	class RemoveEngine
+	{
+	private:
+		///
+		/// @brief 正在删除的目录。
+		///
+		class DirectoryNode
+		{
+		public:
+			///
+			/// @brief Windows 长路径。
+			///
+			std::string path;
+
+			DirectoryNode *parent = nullptr;
+
+			uint32_t attributes = 0;
+
+			///
+			/// @brief 还没删除的子条目数。枚举完成之前额外加 1.
+			///
+			std::atomic_int64_t pending_count = 1;
+		};
+
+		///
+		/// @brief 待删除的非目录条目。
+		///
+		class EntryToRemove
+		{
+		public:
+			std::string path;
+			uint32_t attributes = 0;
+		};
+
+		std::mutex _lock;
+		std::condition_variable _condition;
+
+		///
+		/// @brief 已经提交但还没执行完的任务数。
+		///
+		int64_t _task_count = 0;
+
+		std::exception_ptr _error;
+
+		///
+		/// @brief 所有目录节点。出错时未删除的节点在这里统一释放。
+		///
+		std::vector<std::unique_ptr<DirectoryNode>> _nodes;
+
+		///
+		/// @brief 放在其他成员之后，析构时最先销毁，等工作线程退出后才销毁它们用到的锁和条件变量。
+		///
+		msys::ThreadPool _pool;
+
+		///
+		/// @brief 向线程池提交任务。已经出错时不再提交。
+		///
+		void Post(std::function<void()> task);
+
+		DirectoryNode *CreateNode(std::string path, DirectoryNode *parent, uint32_t attributes);
+
+		///
+		/// @brief 枚举一个目录，提交它的子条目。
+		///
+		void EnumerateDirectory(DirectoryNode *node);
+
+		///
+		/// @brief 删除一批非目录条目。
+		///
+		void RemoveEntries(DirectoryNode *node, std::vector<EntryToRemove> const &entries);
+
+		///
+		/// @brief node 有 count 个子条目已经删除。目录空了就删除它，并继续通知父目录。
+		///
+		void Release(DirectoryNode *node, int64_t count);
+
+	public:
+		///
+		/// @brief 构造删除引擎。
+		///
+		/// @param thread_count 线程数。小于等于 0 时使用硬件线程数。
+		///
+		RemoveEngine(int64_t thread_count);
+
+		RemoveEngine(RemoveEngine const &) = delete;
+		RemoveEngine &operator=(RemoveEngine const &) = delete;
+
+		///
+		/// @brief 删除目录及其中的所有内容。
+		///
+		/// @note 某个条目删除失败后不再提交新的任务，等已提交的任务结束后抛出第一个错误。
+		///
+		/// @param path
+		///
+		void RemoveDirectoryTree(base::Path const &path);
+
+		///
+		/// @brief 删除单个非目录条目、空目录或目录链接。需要时先清除只读属性。
+		///
+		/// @note 条目已经不存在时直接返回。
+		///
+		/// @param path Windows 长路径。
+		/// @param attributes 枚举时得到的属性。
+		///
+		static void RemoveEntry(std::string const &path, uint32_t attributes);
+	};
+
+} // namespace msys
@@ -0,0 +1,157 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace
+{
+	///
+	/// @brief 当前线程所属的线程池。不是工作线程则为空。
+	///
+	thread_local msys::ThreadPool const *_current_pool = nullptr;
+
+	///
+	/// @brief 当前线程在所属线程池中的序号。
+	///
+	thread_local int64_t _current_index = -1;
+
+} // namespace
+
+msys::ThreadPool::ThreadPool(int64_t thread_count)
+{
+	if (thread_count <= 0)
+	{
+		thread_count = std::max<int64_t>(std::thread::hardware_concurrency(), 1);
+	}
+
+	for (int64_t i = 0; i < thread_count; i++)
+	{
+		_queues.emplace_back(new WorkerQueue{});
+	}
+
+	for (int64_t i = 0; i < thread_count; i++)
+	{
+		_threads.emplace_back([this, i]()
+							  {
+								  WorkerThreadFunc(i);
+							  });
+	}
+}
+
+msys::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard l{_lock};
+		_stopping = true;
+	}
+
+	_condition.notify_all();
+
+	for (std::thread &thread : _threads)
+	{
+		thread.join();
+	}
+}
+
+msys::ThreadPool &msys::ThreadPool::Instance()
+{
+	static msys::ThreadPool pool{0};
+	return pool;
+}
+
+void msys::ThreadPool::Post(std::function<void()> task)
+{
+	int64_t index = 0;
+
+	if (_current_pool == this)
+	{
+		// 工作线程上投递的任务放入自己的队列，局部性更好。
+		index = _current_index;
+	}
+	else
+	{
+		index = static_cast<int64_t>(_next_queue++ % _queues.size());
+	}
+
+	{
+		std::lock_guard l{_queues[index]->_lock};
+		_queues[index]->_tasks.push_back(std::move(task));
+	}
+
+	{
+		// 在锁内增加计数，避免工作线程检查完条件、还没开始等待时错过通知。
+		std::lock_guard l{_lock};
+		_queued_count++;
+	}
+
+	_condition.notify_one();
+}
+
+bool msys::ThreadPool::TryTake(int64_t index, std::function<void()> &task)
+{
+	{
+		WorkerQueue &queue = *_queues[index];
+		std::lock_guard l{queue._lock};
+
+		if (!queue._tasks.empty())
+		{
+			task = std::move(queue._tasks.back());
+			queue._tasks.pop_back();
+			_queued_count--;
+			return true;
+		}
+	}
+
+	int64_t count = static_cast<int64_t>(_queues.size());
+
+	for (int64_t i = 1; i < count; i++)
+	{
+		WorkerQueue &queue = *_queues[(index + i) % count];
+		std::lock_guard l{queue._lock};
+
+		if (!queue._tasks.empty())
+		{
+			task = std::move(queue._tasks.front());
+			queue._tasks.pop_front();
+			_queued_count--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void msys::ThreadPool::WorkerThreadFunc(int64_t index)
+{
+	_current_pool = this;
+	_current_index = index;
+
+	while (true)
+	{
+		std::function<void()> task;
+
+		if (!TryTake(index, task))
+		{
+			std::unique_lock l{_lock};
+
+			_condition.wait(l, [this]()
+							{
+								return _stopping || _queued_count > 0;
+							});
+
+			if (_stopping && _queued_count == 0)
+			{
+				// 要停止了，并且队列已经清空。
+				return;
+			}
+
+			continue;
+		}
+
+		try
+		{
+			task();
+		}
+		catch (...)
+		{
+		}
+	}
+}
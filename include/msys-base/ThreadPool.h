@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace msys
+{
+	///
+	/// @brief 固定线程数的工作窃取线程池。
+	///
+	/// @note 每个工作线程有自己的任务队列。工作线程上投递的任务放入自己的队列，从队尾取出执行；
+	/// 自己的队列空了就从其他线程的队列头部窃取。其他线程上投递的任务轮流放入各个队列。
+	///
+	class ThreadPool
+	{
+	private:
+		///
+		/// @brief 一个工作线程的任务队列。
+		///
+		class WorkerQueue
+		{
+		public:
+			std::deque<std::function<void()>> _tasks;
+			std::mutex _lock;
+		};
+
+		std::vector<std::unique_ptr<WorkerQueue>> _queues;
+		std::vector<std::thread> _threads;
+
+		///
+		/// @brief 所有队列中的任务总数。
+		///
+		std::atomic_int64_t _queued_count = 0;
+
+		///
+		/// @brief 非工作线程投递任务时，下一个放入的队列。
+		///
+		std::atomic_uint64_t _next_queue = 0;
+
+		std::mutex _lock;
+		std::condition_variable _condition;
+		bool _stopping = false;
+
+		///
+		/// @brief 工作线程的线程函数。
+		///
+		/// @param index 工作线程的序号。
+		///
+		void WorkerThreadFunc(int64_t index);
+
+		///
+		/// @brief 取出一个任务。先从自己的队列尾部取，取不到再从其他队列头部窃取。
+		///
+		/// @param index 工作线程的序号。
+		/// @param task 用来返回任务。
+		///
+		/// @return 取到了返回 true.
+		///
+		bool TryTake(int64_t index, std::function<void()> &task);
+
+	public:
+		///
+		/// @brief 构造线程池。
+		///
+		/// @param thread_count 线程数。小于等于 0 时使用硬件线程数。
+		///
+		ThreadPool(int64_t thread_count);
+
+		///
+		/// @brief 析构时会等待队列中已有的任务执行完。
+		///
+		~ThreadPool();
+
+		ThreadPool(ThreadPool const &) = delete;
+		ThreadPool &operator=(ThreadPool const &) = delete;
+
+		///
+		/// @brief 进程共享的线程池。线程数等于硬件线程数。
+		///
+		/// @return
+		///
+		static msys::ThreadPool &Instance();
+
+		///
+		/// @brief 线程数。
+		///
+		/// @return
+		///
+		int64_t ThreadCount() const
+		{
+			return static_cast<int64_t>(_threads.size());
+		}
+
+		///
+		/// @brief 将任务放入队列。任务会在某个工作线程上执行。
+		///
+		/// @note 任务抛出的异常会被吞掉，需要任务自己捕获并传递出去。
+		///
+		/// @param task
+		///
+		void Post(std::function<void()> task);
+	};
+
+} // namespace msys
@@ -0,0 +1,407 @@
+#include "TrashReclaimer.h"
+#include "base/filesystem/filesystem.h"
+#include "base/string/define.h"
+#include "msys-base/DirectorySnapshot.h"
+#include "msys-base/MetadataCache.h"
+#include "msys-base/RemoveEngine.h"
+#include "msys-base/win32_error.h"
+#include "msys-base/windows_api.h"
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+	///
+	/// @brief 回收目录在卷根目录下的名称。
+	///
+	char const *const TrashDirectoryName = "msys-base.trash";
+
+	///
+	/// @brief 枚举目录中的直接子条目。
+	///
+	/// @param path Windows 长路径。
+	/// @param callback 参数是子条目的 Windows 长路径和属性。返回 false 停止枚举。
+	///
+	/// @return 被回调停止时返回 false.
+	///
+	template <typename CallbackType>
+	bool EnumerateChildren(std::string const &path, CallbackType const &callback)
+	{
+		return msys::ForEachDirectoryEntry(path,
+										   [&](WIN32_FIND_DATAA const &data)
+										   {
+											   return callback(path + "\\" + data.cFileName, static_cast<uint32_t>(data.dwFileAttributes));
+										   });
+	}
+
+	///
+	/// @brief 回收目录中的条目是否属于一个还在运行的进程。
+	///
+	/// @note 条目名称以创建它的进程号开头。那个进程还在运行时，条目可能正在被它删除。
+	/// 进程号被新进程复用时会误判为还在运行，条目留到以后再恢复，不会被删错。
+	///
+	/// @param name 条目的名称。
+	///
+	/// @return 名称不是回收器生成的格式时返回 false.
+	///
+	bool IsOwnedByLiveProcess(std::string const &name)
+	{
+		size_t separator = name.find('-');
+
+		if (separator == std::string::npos)
+		{
+			return false;
+		}
+
+		uint32_t process_id = 0;
+		std::from_chars_result result = std::from_chars(name.data(), name.data() + separator, process_id, 16);
+
+		if (result.ec != std::errc{} || result.ptr != name.data() + separator)
+		{
+			return false;
+		}
+
+		if (process_id == GetCurrentProcessId())
+		{
+			// 属于本进程中的回收器。
+			return true;
+		}
+
+		HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, process_id);
+
+		if (process == nullptr)
+		{
+			// 进程不存在时是 ERROR_INVALID_PARAMETER. 其他错误，例如没有权限，说明进程存在。
+			return GetLastError() != ERROR_INVALID_PARAMETER;
+		}
+
+		bool running = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+		CloseHandle(process);
+		return running;
+	}
+
+} // namespace
+
+msys::TrashReclaimer::TrashReclaimer()
+{
+	_thread = std::thread{[this]()
+						  {
+							  ThreadFunc();
+						  }};
+}
+
+msys::TrashReclaimer::~TrashReclaimer()
+{
+	Shutdown(false);
+}
+
+msys::TrashReclaimer &msys::TrashReclaimer::Instance()
+{
+	static msys::TrashReclaimer reclaimer{};
+	return reclaimer;
+}
+
+void msys::TrashReclaimer::ThreadFunc()
+{
+	// 降低 I/O 和内存优先级。
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+
+	while (true)
+	{
+		std::string path;
+
+		{
+			std::unique_lock l{_lock};
+
+			_condition.wait(l, [this]()
+							{
+								return _stopping || !_queue.empty();
+							});
+
+			if (_abort || _queue.empty())
+			{
+				return;
+			}
+
+			path = std::move(_queue.front());
+			_queue.pop_front();
+			_busy = true;
+		}
+
+		try
+		{
+			Reclaim(path);
+		}
+		catch (...)
+		{
+			// 删除失败的条目留在回收目录中，下次恢复时重试。
+		}
+
+		{
+			std::lock_guard l{_lock};
+			_busy = false;
+		}
+
+		_condition.notify_all();
+	}
+}
+
+void msys::TrashReclaimer::Reclaim(std::string const &path)
+{
+	DWORD attributes = GetFileAttributesA(path.c_str());
+
+	if (attributes == INVALID_FILE_ATTRIBUTES)
+	{
+		// 已经被别人删除了。
+		return;
+	}
+
+	if (!(attributes & FILE_ATTRIBUTE_DIRECTORY) || (attributes & FILE_ATTRIBUTE_REPARSE_POINT))
+	{
+		msys::RemoveEngine::RemoveEntry(path, attributes);
+		return;
+	}
+
+	class DirectoryToRemove
+	{
+	public:
+		std::string path;
+		uint32_t attributes = 0;
+	};
+
+	// 目录按发现的顺序记录，子目录总在父目录之后，逆序删除时目录已经清空。
+	std::vector<DirectoryToRemove> directories{DirectoryToRemove{path, static_cast<uint32_t>(attributes)}};
+
+	for (size_t i = 0; i < directories.size(); i++)
+	{
+		std::string directory_path = directories[i].path;
+
+		bool completed = EnumerateChildren(directory_path,
+										   [&](std::string const &child_path, uint32_t child_attributes)
+										   {
+											   if (_abort)
+											   {
+												   return false;
+											   }
+
+											   if ((child_attributes & FILE_ATTRIBUTE_DIRECTORY) &&
+												   !(child_attributes & FILE_ATTRIBUTE_REPARSE_POINT))
+											   {
+												   directories.push_back(DirectoryToRemove{child_path, child_attributes});
+												   return true;
+											   }
+
+											   msys::RemoveEngine::RemoveEntry(child_path, child_attributes);
+											   return true;
+										   });
+
+		if (!completed)
+		{
+			return;
+		}
+	}
+
+	for (auto it = directories.rbegin(); it != directories.rend(); ++it)
+	{
+		if (_abort)
+		{
+			return;
+		}
+
+		msys::RemoveEngine::RemoveEntry(it->path, it->attributes);
+	}
+}
+
+void msys::TrashReclaimer::Enqueue(std::string path)
+{
+	{
+		std::lock_guard l{_lock};
+
+		if (_stopping)
+		{
+			// 后台线程已经停止或正在停止，条目留给下次启动时恢复。
+			return;
+		}
+
+		_queue.push_back(std::move(path));
+	}
+
+	_condition.notify_all();
+}
+
+std::string msys::TrashReclaimer::GetTrashDirectory(std::string const &path)
+{
+	// 卷路径不会比 path 长。
+	std::string volume_path(path.size() + 2, '\0');
+
+	if (!GetVolumePathNameA(path.c_str(), volume_path.data(), static_cast<DWORD>(volume_path.size())))
+	{
+		throw std::runtime_error{CODE_POS_STR + std::format("获取 {} 所在的卷失败。", path) + msys::FormatError(GetLastError())};
+	}
+
+	volume_path.resize(std::strlen(volume_path.c_str()));
+
+	if (volume_path.empty() || volume_path.back() != '\\')
+	{
+		volume_path += '\\';
+	}
+
+	std::string trash_path = volume_path + TrashDirectoryName;
+	std::wstring key = msys::ToPathKey(trash_path);
+
+	{
+		std::lock_guard l{_lock};
+
+		if (_trash_directories.contains(key))
+		{
+			return trash_path;
+		}
+	}
+
+	if (CreateDirectoryA(trash_path.c_str(), nullptr))
+	{
+		SetFileAttributesA(trash_path.c_str(), FILE_ATTRIBUTE_HIDDEN);
+	}
+	else
+	{
+		DWORD error = GetLastError();
+
+		if (error != ERROR_ALREADY_EXISTS)
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("创建回收目录 {} 失败。", trash_path) + msys::FormatError(error)};
+		}
+	}
+
+	{
+		std::lock_guard l{_lock};
+
+		if (!_trash_directories.insert(key).second)
+		{
+			// 另一个线程已经恢复过了。
+			return trash_path;
+		}
+	}
+
+	// 上次没删完的条目。还在运行的进程留下的条目可能正在被它删除，不能动。
+	std::vector<std::string> orphans;
+
+	EnumerateChildren(trash_path,
+					  [&orphans](std::string const &child_path, uint32_t)
+					  {
+						  if (!IsOwnedByLiveProcess(child_path.substr(child_path.rfind('\\') + 1)))
+						  {
+							  orphans.push_back(child_path);
+						  }
+
+						  return true;
+					  });
+
+	for (std::string const &orphan : orphans)
+	{
+		// 先重命名为本进程的名称认领下来。多个进程同时恢复同一个条目时只有一个能重命名成功。
+		std::string claimed_path = NewEntryPath(trash_path);
+
+		if (MoveFileExA(orphan.c_str(), claimed_path.c_str(), 0))
+		{
+			Enqueue(std::move(claimed_path));
+		}
+	}
+
+	return trash_path;
+}
+
+std::string msys::TrashReclaimer::NewEntryPath(std::string const &trash_path)
+{
+	// 进程号、时间和序号一起保证名称不会和残留的条目冲突。
+	int64_t now = std::chrono::system_clock::now().time_since_epoch().count();
+
+	return trash_path + std::format("\\{:x}-{:x}-{:x}",
+									static_cast<uint32_t>(GetCurrentProcessId()),
+									now,
+									_next_id++);
+}
+
+void msys::TrashReclaimer::RemoveDeferred(base::Path const &path)
+{
+	msys::MetadataCache::InvalidationGuard invalidation_guard{path};
+
+	if (!base::filesystem::Exists(path))
+	{
+		// 路径不存在，直接返回。
+		return;
+	}
+
+	if (path.IsRootPath())
+	{
+		throw std::runtime_error{CODE_POS_STR + "不能删除根路径。"};
+	}
+
+	std::string source_path = base::filesystem::ToWindowsLongPathString(path);
+	std::string trash_path;
+
+	try
+	{
+		trash_path = GetTrashDirectory(source_path);
+	}
+	catch (...)
+	{
+		base::filesystem::Remove(path);
+		return;
+	}
+
+	std::string target_path = NewEntryPath(trash_path);
+
+	// 不带 MOVEFILE_COPY_ALLOWED, 只做同一个卷内的重命名。
+	if (!MoveFileExA(source_path.c_str(), target_path.c_str(), 0))
+	{
+		base::filesystem::Remove(path);
+		return;
+	}
+
+	Enqueue(std::move(target_path));
+}
+
+void msys::TrashReclaimer::Resume(base::Path const &path)
+{
+	GetTrashDirectory(base::filesystem::ToWindowsLongPathString(path));
+}
+
+void msys::TrashReclaimer::Drain()
+{
+	std::unique_lock l{_lock};
+
+	_condition.wait(l, [this]()
+					{
+						return (_queue.empty() && !_busy) || _abort;
+					});
+}
+
+void msys::TrashReclaimer::Shutdown(bool drain)
+{
+	{
+		std::lock_guard l{_lock};
+
+		if (_stopping)
+		{
+			return;
+		}
+
+		_stopping = true;
+
+		if (!drain)
+		{
+			_abort = true;
+		}
+	}
+
+	_condition.notify_all();
+	_thread.join();
+}
+
+void msys::RemoveDeferred(base::Path const &path)
+{
+	msys::TrashReclaimer::Instance().RemoveDeferred(path);
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+namespace msys
+{
+	///
+	/// @brief 延迟删除。把要删除的条目重命名到所在卷的回收目录中，由后台线程慢慢删除。
+	///
+	/// @note 回收目录是卷根目录下的隐藏目录 msys-base.trash. 重命名不跨卷，是原子的，
+	/// 调用者立刻就看不到原路径了。
+	///
+	/// @note 后台线程以 THREAD_MODE_BACKGROUND_BEGIN 运行，I/O 优先级很低，不会和前台请求争抢磁盘。
+	///
+	/// @note 某个卷的回收目录第一次被使用时，会把其中上次没删完的条目加入队列。
+	/// 也可以在启动时调用 Resume 主动恢复。回收目录由所有进程共用，只恢复已经退出的进程留下的条目，
+	/// 认领时先重命名为本进程的名称，不会和其他进程同时删除同一个条目。
+	///
+	class TrashReclaimer
+	{
+	private:
+		std::mutex _lock;
+		std::condition_variable _condition;
+
+		///
+		/// @brief 回收目录中等待删除的条目。Windows 长路径。
+		///
+		std::deque<std::string> _queue;
+
+		///
+		/// @brief 后台线程正在删除一个条目。
+		///
+		bool _busy = false;
+
+		bool _stopping = false;
+
+		///
+		/// @brief 不等队列清空，尽快停止。
+		///
+		std::atomic_bool _abort = false;
+
+		///
+		/// @brief 已经创建并恢复过的回收目录。
+		///
+		std::unordered_set<std::wstring> _trash_directories;
+
+		std::atomic_uint64_t _next_id = 0;
+
+		std::thread _thread;
+
+		void ThreadFunc();
+
+		///
+		/// @brief 删除回收目录中的一个条目。子条目先删除，目录最后删除。
+		///
+		/// @param path Windows 长路径。
+		///
+		void Reclaim(std::string const &path);
+
+		///
+		/// @brief 获取 path 所在卷的回收目录。第一次使用时创建它，并把其中残留的条目加入队列。
+		///
+		/// @param path Windows 长路径。
+		///
+		/// @return 回收目录的 Windows 长路径。
+		///
+		std::string GetTrashDirectory(std::string const &path);
+
+		void Enqueue(std::string path);
+
+		///
+		/// @brief 在回收目录中生成一个新条目的路径。名称以本进程的进程号开头。
+		///
+		/// @param trash_path 回收目录的 Windows 长路径。
+		///
+		/// @return
+		///
+		std::string NewEntryPath(std::string const &trash_path);
+
+	public:
+		///
+		/// @brief 构造时启动后台线程。
+		///
+		TrashReclaimer();
+
+		///
+		/// @brief 调用 Shutdown(false).
+		///
+		~TrashReclaimer();
+
+		TrashReclaimer(TrashReclaimer const &) = delete;
+		TrashReclaimer &operator=(TrashReclaimer const &) = delete;
+
+		///
+		/// @brief 进程共享的回收器。
+		///
+		/// @return
+		///
+		static msys::TrashReclaimer &Instance();
+
+		///
+		/// @brief 把 path 重命名到回收目录中并立即返回。
+		///
+		/// @note 路径不存在时直接返回。无法重命名到回收目录时（例如卷根目录不可写），
+		/// 退回到 base::filesystem::Remove 同步删除。
+		///
+		/// @note 停止后仍然可以调用，条目会留在回收目录中，下次启动时恢复删除。
+		///
+		/// @param path
+		///
+		void RemoveDeferred(base::Path const &path);
+
+		///
+		/// @brief 把 path 所在卷的回收目录中残留的条目加入队列。
+		///
+		/// @param path 该卷上的任意路径。
+		///
+		void Resume(base::Path const &path);
+
+		///
+		/// @brief 等待队列中的条目全部删除完。
+		///
+		void Drain();
+
+		///
+		/// @brief 停止后台线程。
+		///
+		/// @param drain 为 true 时先删除完队列中的所有条目。为 false 时正在删除的条目也会中途停下，
+		/// 没删完的条目留在回收目录中。
+		///
+		void Shutdown(bool drain);
+	};
+
+	///
+	/// @brief 通过 msys::TrashReclaimer::Instance() 延迟删除 path.
+	///
+	/// @param path
+	///
+	void RemoveDeferred(base::Path const &path);
+
+} // namespace msys
@@ -0,0 +1,334 @@
+#include "Watcher.h"
+#include "base/string/define.h"
+#include "msys-base/DirectorySnapshot.h"
+#include <stdexcept>
+
+namespace
+{
+	std::wstring ToKey(base::Path const &path)
+	{
+		return msys::ToPathKey(path.ToString());
+	}
+
+} // namespace
+
+msys::Watcher::Watcher(base::Path const &root, msys::WatchCallback callback, msys::WatcherOptions const &options)
+	: _callback(std::move(callback)),
+	  _options(options),
+	  _root(root)
+{
+	if (_callback == nullptr)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "callback 不能为空。"};
+	}
+
+	_thread = std::thread{[this]()
+						  {
+							  ThreadFunc();
+						  }};
+
+	try
+	{
+		_monitor = std::unique_ptr<msys::DirectoryChangeMonitor>{new msys::DirectoryChangeMonitor{
+			[this](std::vector<msys::DirectoryChange> const &changes)
+			{
+				OnChanges(changes);
+			},
+		}};
+
+		_monitor->AddWatch(root);
+	}
+	catch (...)
+	{
+		Stop();
+		throw;
+	}
+}
+
+msys::Watcher::~Watcher()
+{
+	Stop();
+}
+
+void msys::Watcher::Put(std::wstring const &key, msys::WatchEvent event)
+{
+	auto result = _pending.insert_or_assign(key, std::move(event));
+
+	if (result.second)
+	{
+		_order.push_back(key);
+	}
+}
+
+void msys::Watcher::Merge(msys::WatchEvent event)
+{
+	if (event.type == msys::WatchEventType::Renamed)
+	{
+		auto old_it = _pending.find(ToKey(event.old_path));
+
+		if (old_it != _pending.end())
+		{
+			msys::WatchEvent old_event = std::move(old_it->second);
+			_pending.erase(old_it);
+
+			if (old_event.type == msys::WatchEventType::Created)
+			{
+				// 本批次内新创建的条目，对使用者来说只是在新路径上创建了。
+				event = msys::WatchEvent{msys::WatchEventType::Created, event.path, base::Path{}};
+			}
+			else if (old_event.type == msys::WatchEventType::Renamed)
+			{
+				event.old_path = old_event.old_path;
+			}
+		}
+	}
+
+	std::wstring key = ToKey(event.path);
+	auto it = _pending.find(key);
+
+	if (it == _pending.end())
+	{
+		Put(key, std::move(event));
+		return;
+	}
+
+	msys::WatchEvent &previous = it->second;
+
+	switch (event.type)
+	{
+	case msys::WatchEventType::Created:
+		{
+			if (previous.type == msys::WatchEventType::Removed)
+			{
+				// 删除后又创建，对使用者来说是内容变了。
+				previous.type = msys::WatchEventType::Modified;
+			}
+
+			break;
+		}
+	case msys::WatchEventType::Modified:
+		{
+			if (previous.type == msys::WatchEventType::Removed)
+			{
+				previous.type = msys::WatchEventType::Modified;
+			}
+
+			// 创建、修改、重命名之后的修改不需要单独报告。
+			break;
+		}
+	case msys::WatchEventType::Removed:
+		{
+			if (previous.type == msys::WatchEventType::Created)
+			{
+				// 创建后删除，两者抵消。
+				_pending.erase(it);
+				break;
+			}
+
+			if (previous.type == msys::WatchEventType::Renamed)
+			{
+				// 重命名后删除，对使用者来说是旧路径被删除了。
+				base::Path old_path = previous.old_path;
+				_pending.erase(it);
+				Merge(msys::WatchEvent{msys::WatchEventType::Removed, old_path, base::Path{}});
+				break;
+			}
+
+			previous.type = msys::WatchEventType::Removed;
+			break;
+		}
+	case msys::WatchEventType::Renamed:
+	default:
+		{
+			// 其他条目被重命名到这里，覆盖了原来的内容。
+			previous = std::move(event);
+			break;
+		}
+	}
+}
+
+void msys::Watcher::OnChanges(std::vector<msys::DirectoryChange> const &changes)
+{
+	std::lock_guard l{_lock};
+
+	if (!HasPending())
+	{
+		_batch_start_time = std::chrono::steady_clock::now();
+	}
+
+	for (msys::DirectoryChange const &change : changes)
+	{
+		if (_rename_old_path.has_value() && change.type != msys::DirectoryChangeType::RenamedNewName)
+		{
+			// 旧名称后面没有新名称，条目被移出了监视的目录树。
+			Merge(msys::WatchEvent{msys::WatchEventType::Removed, _rename_old_path.value(), base::Path{}});
+			_rename_old_path.reset();
+		}
+
+		switch (change.type)
+		{
+		case msys::DirectoryChangeType::Added:
+			{
+				Merge(msys::WatchEvent{msys::WatchEventType::Created, change.path, base::Path{}});
+				break;
+			}
+		case msys::DirectoryChangeType::Removed:
+			{
+				Merge(msys::WatchEvent{msys::WatchEventType::Removed, change.path, base::Path{}});
+				break;
+			}
+		case msys::DirectoryChangeType::RenamedOldName:
+			{
+				_rename_old_path = change.path;
+				break;
+			}
+		case msys::DirectoryChangeType::RenamedNewName:
+			{
+				if (_rename_old_path.has_value())
+				{
+					Merge(msys::WatchEvent{msys::WatchEventType::Renamed, change.path, _rename_old_path.value()});
+					_rename_old_path.reset();
+				}
+				else
+				{
+					// 没有旧名称，条目是从监视的目录树外面移进来的。
+					Merge(msys::WatchEvent{msys::WatchEventType::Created, change.path, base::Path{}});
+				}
+
+				break;
+			}
+		case msys::DirectoryChangeType::Overflow:
+			{
+				// 之前的事件都不再有意义，使用者要重新扫描。
+				_overflowed = true;
+				_pending.clear();
+				_order.clear();
+				break;
+			}
+		case msys::DirectoryChangeType::Modified:
+		default:
+			{
+				Merge(msys::WatchEvent{msys::WatchEventType::Modified, change.path, base::Path{}});
+				break;
+			}
+		}
+	}
+
+	// 旧名称是这次读取的最后一个变化时，新名称可能在下一次读取中。监视器按读取的顺序逐批
+	// 调用本函数，所以留到下一批再配对。窗口结束时还没配对的由 TakeBatch 处理。
+
+	if (_overflowed)
+	{
+		_pending.clear();
+		_order.clear();
+	}
+
+	_condition.notify_all();
+}
+
+std::vector<msys::WatchEvent> msys::Watcher::TakeBatch()
+{
+	std::vector<msys::WatchEvent> batch;
+
+	if (_rename_old_path.has_value())
+	{
+		// 窗口结束时旧名称还没等到新名称，条目被移出了监视的目录树。
+		Merge(msys::WatchEvent{msys::WatchEventType::Removed, _rename_old_path.value(), base::Path{}});
+		_rename_old_path.reset();
+	}
+
+	if (_overflowed)
+	{
+		batch.push_back(msys::WatchEvent{msys::WatchEventType::Overflow, _root, base::Path{}});
+	}
+	else
+	{
+		for (std::wstring const &key : _order)
+		{
+			auto it = _pending.find(key);
+
+			if (it == _pending.end())
+			{
+				// 被抵消了，或者已经按更早的顺序取出。
+				continue;
+			}
+
+			batch.push_back(std::move(it->second));
+			_pending.erase(it);
+		}
+	}
+
+	_pending.clear();
+	_order.clear();
+	_overflowed = false;
+	return batch;
+}
+
+void msys::Watcher::ThreadFunc()
+{
+	while (true)
+	{
+		std::vector<msys::WatchEvent> batch;
+
+		{
+			std::unique_lock l{_lock};
+
+			_condition.wait(l, [this]()
+							{
+								return _stopping || HasPending();
+							});
+
+			if (_stopping)
+			{
+				return;
+			}
+
+			// 收集到窗口结束。
+			_condition.wait_until(l,
+								  _batch_start_time + _options.coalescing_window,
+								  [this]()
+								  {
+									  return _stopping;
+								  });
+
+			if (_stopping)
+			{
+				return;
+			}
+
+			batch = TakeBatch();
+		}
+
+		if (batch.empty())
+		{
+			// 这个窗口内的变化全部抵消了。
+			continue;
+		}
+
+		try
+		{
+			_callback(batch);
+		}
+		catch (...)
+		{
+		}
+	}
+}
+
+void msys::Watcher::Stop()
+{
+	// 先停止监视，之后不会再有变化进来。
+	_monitor.reset();
+
+	{
+		std::lock_guard l{_lock};
+		_stopping = true;
+	}
+
+	_condition.notify_all();
+
+	if (_thread.joinable())
+	{
+		_thread.join();
+	}
+}
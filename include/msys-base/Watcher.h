@@ -0,0 +1,173 @@
+#pragma once
+#include "base/filesystem/Path.h"
+#include "msys-base/DirectoryChangeMonitor.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace msys
+{
+	///
+	/// @brief 合并后的变化类型。
+	///
+	enum class WatchEventType
+	{
+		Created,
+		Modified,
+		Removed,
+		Renamed,
+
+		///
+		/// @brief 变化丢失了，需要重新扫描整个目录树。出现时批次中只有这一个事件。
+		///
+		Overflow,
+	};
+
+	///
+	/// @brief 一个变化事件。
+	///
+	class WatchEvent
+	{
+	public:
+		msys::WatchEventType type = msys::WatchEventType::Modified;
+
+		///
+		/// @brief 发生变化的路径。Renamed 时是新路径，Overflow 时是监视的根目录。
+		///
+		base::Path path;
+
+		///
+		/// @brief Renamed 时是旧路径。
+		///
+		base::Path old_path;
+	};
+
+	///
+	/// @brief 批次回调。
+	///
+	using WatchCallback = std::function<void(std::vector<msys::WatchEvent> const &)>;
+
+	///
+	/// @brief 监视器的选项。
+	///
+	class WatcherOptions
+	{
+	public:
+		///
+		/// @brief 一个批次从第一个变化起收集多久。这段时间内同一路径的变化合并为一个事件。
+		///
+		std::chrono::milliseconds coalescing_window{100};
+	};
+
+	///
+	/// @brief 递归监视目录树，把变化合并去重后分批交给回调。
+	///
+	/// @note 变化来自 msys::DirectoryChangeMonitor. 同一个批次中同一路径只有一个事件：
+	/// 	@li 创建后修改仍是创建，创建后删除则两者抵消。
+	/// 	@li 删除后又创建是修改。
+	/// 	@li 新创建的条目被重命名是新路径上的创建，连续重命名合并为从最初的路径重命名。
+	/// 	@li 重命名后删除是旧路径上的删除。
+	/// 事件按路径第一次变化的顺序排列。
+	///
+	/// @note 合并规则依赖变化的先后顺序。msys::DirectoryChangeMonitor 对同一个目录按读取的顺序
+	/// 逐批调用回调，不会并发，所以跨越两次读取的变化也按发生的顺序合并，重命名的旧名称和新名称
+	/// 分在两次读取中也能配对。
+	///
+	/// @note 回调在监视器自己的线程上调用，不能在回调中调用 Stop 或析构监视器。
+	///
+	class Watcher
+	{
+	private:
+		msys::WatchCallback _callback;
+		msys::WatcherOptions _options;
+		base::Path _root;
+
+		std::mutex _lock;
+		std::condition_variable _condition;
+		bool _stopping = false;
+
+		///
+		/// @brief 当前批次中每个路径合并后的事件。
+		///
+		std::unordered_map<std::wstring, msys::WatchEvent> _pending;
+
+		///
+		/// @brief 路径第一次进入当前批次的顺序。被抵消的路径留在这里，交付时跳过。
+		///
+		std::vector<std::wstring> _order;
+
+		///
+		/// @brief 当前批次中发生过溢出。
+		///
+		bool _overflowed = false;
+
+		///
+		/// @brief 当前批次第一个变化到来的时间。
+		///
+		std::chrono::steady_clock::time_point _batch_start_time;
+
+		///
+		/// @brief 等待配对的 RenamedOldName.
+		///
+		std::optional<base::Path> _rename_old_path;
+
+		std::thread _thread;
+		std::unique_ptr<msys::DirectoryChangeMonitor> _monitor;
+
+		bool HasPending() const
+		{
+			return _overflowed || !_pending.empty() || _rename_old_path.has_value();
+		}
+
+		///
+		/// @brief 把事件合并到当前批次。要在持有 _lock 时调用。
+		///
+		void Merge(msys::WatchEvent event);
+
+		///
+		/// @brief 插入或替换一个路径的事件。要在持有 _lock 时调用。
+		///
+		void Put(std::wstring const &key, msys::WatchEvent event);
+
+		void OnChanges(std::vector<msys::DirectoryChange> const &changes);
+
+		///
+		/// @brief 取出当前批次。要在持有 _lock 时调用。
+		///
+		std::vector<msys::WatchEvent> TakeBatch();
+
+		void ThreadFunc();
+
+	public:
+		///
+		/// @brief 开始监视。
+		///
+		/// @param root 要递归监视的目录。
+		/// @param callback
+		/// @param options
+		///
+		Watcher(base::Path const &root, msys::WatchCallback callback, msys::WatcherOptions const &options);
+
+		///
+		/// @brief 调用 Stop.
+		///
+		~Watcher();
+
+		Watcher(Watcher const &) = delete;
+		Watcher &operator=(Watcher const &) = delete;
+
+		///
+		/// @brief 停止监视。还没交付的批次被丢弃。返回后不会再调用回调。
+		///
+		void Stop();
+	};
+
+} // namespace msys
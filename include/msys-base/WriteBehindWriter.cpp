@@ -0,0 +1,206 @@
+#include "WriteBehindWriter.h"
+#include "base/string/define.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+msys::WriteBehindWriter::WriteBehindWriter(int64_t block_size,
+											 int64_t block_count,
+											 WriteFunction write,
+											 std::chrono::milliseconds idle_flush_interval)
+{
+	if (block_size <= 0 || block_count <= 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "缓冲块的大小和数量都必须大于 0."};
+	}
+
+	if (idle_flush_interval.count() <= 0)
+	{
+		throw std::invalid_argument{CODE_POS_STR + "空闲写入间隔必须大于 0."};
+	}
+
+	_write = std::move(write);
+	_block_size = block_size;
+	_idle_flush_interval = idle_flush_interval;
+
+	for (int64_t i = 0; i < block_count; i++)
+	{
+		std::unique_ptr<Block> block{new Block{}};
+		block->_buffer = std::unique_ptr<uint8_t[]>{new uint8_t[block_size]};
+		_free_blocks.push_back(block.get());
+		_blocks.push_back(std::move(block));
+	}
+
+	_thread = std::thread{[this]()
+						  {
+							  WriterThreadFunc();
+						  }};
+}
+
+msys::WriteBehindWriter::~WriteBehindWriter()
+{
+	{
+		std::unique_lock l{_lock};
+
+		if (_current != nullptr && _current->_length > 0)
+		{
+			SubmitCurrent(l);
+		}
+
+		_stopping = true;
+	}
+
+	_condition.notify_all();
+	_thread.join();
+}
+
+void msys::WriteBehindWriter::WriterThreadFunc()
+{
+	std::unique_lock l{_lock};
+
+	while (true)
+	{
+		_condition.wait_for(l, _idle_flush_interval, [this]()
+							{
+								return _stopping || !_pending_blocks.empty();
+							});
+
+		if (_pending_blocks.empty() &&
+			_current != nullptr &&
+			_current->_length > 0 &&
+			std::chrono::steady_clock::now() - _last_write_time >= _idle_flush_interval)
+		{
+			// 调用者空闲了一段时间，没填满的缓冲块也写下去。调用者拷贝数据时持有锁，
+			// 所以这里可以安全地拿走它。
+			SubmitCurrent(l);
+		}
+
+		if (_pending_blocks.empty())
+		{
+			if (_stopping)
+			{
+				// 要停止了，并且队列已经清空。
+				return;
+			}
+
+			continue;
+		}
+
+		Block *block = _pending_blocks.front();
+		_pending_blocks.pop_front();
+		_writing = true;
+
+		// 写入期间不持有锁，调用者可以继续往其他缓冲块中拷贝。
+		l.unlock();
+
+		std::exception_ptr error;
+
+		try
+		{
+			_write(block->_offset, block->_buffer.get(), block->_length);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		l.lock();
+
+		if (error != nullptr && _error == nullptr)
+		{
+			_error = error;
+		}
+
+		block->_length = 0;
+		_free_blocks.push_back(block);
+		_writing = false;
+		_condition.notify_all();
+	}
+}
+
+void msys::WriteBehindWriter::SubmitCurrent(std::unique_lock<std::mutex> &l)
+{
+	if (_current == nullptr)
+	{
+		return;
+	}
+
+	_pending_blocks.push_back(_current);
+	_current = nullptr;
+	_condition.notify_all();
+}
+
+void msys::WriteBehindWriter::ThrowIfFailed(std::unique_lock<std::mutex> &l)
+{
+	if (_error == nullptr)
+	{
+		return;
+	}
+
+	// 错误只报告一次。
+	std::exception_ptr error = _error;
+	_error = nullptr;
+	std::rethrow_exception(error);
+}
+
+void msys::WriteBehindWriter::Write(int64_t offset, uint8_t const *buffer, int64_t count)
+{
+	std::unique_lock l{_lock};
+	ThrowIfFailed(l);
+
+	int64_t have_written = 0;
+
+	while (have_written < count)
+	{
+		if (_current != nullptr &&
+			(_current->_offset + _current->_length != offset + have_written || _current->_length == _block_size))
+		{
+			// 与正在填充的缓冲块不连续，或者缓冲块已满。
+			SubmitCurrent(l);
+		}
+
+		if (_current == nullptr)
+		{
+			_condition.wait(l, [this]()
+							{
+								return !_free_blocks.empty();
+							});
+
+			_current = _free_blocks.front();
+			_free_blocks.pop_front();
+			_current->_offset = offset + have_written;
+			_current->_length = 0;
+		}
+
+		int64_t size = std::min(_block_size - _current->_length, count - have_written);
+		std::memcpy(_current->_buffer.get() + _current->_length, buffer + have_written, size);
+		_current->_length += size;
+		have_written += size;
+	}
+
+	_end_offset = std::max(_end_offset, offset + count);
+	_last_write_time = std::chrono::steady_clock::now();
+}
+
+void msys::WriteBehindWriter::Flush()
+{
+	std::unique_lock l{_lock};
+
+	if (_current != nullptr && _current->_length > 0)
+	{
+		SubmitCurrent(l);
+	}
+
+	_condition.wait(l, [this]()
+					{
+						return _pending_blocks.empty() && !_writing;
+					});
+
+	ThrowIfFailed(l);
+}
+
+int64_t msys::WriteBehindWriter::EndOffset()
+{
+	std::lock_guard l{_lock};
+	return _end_offset;
+}
@@ -0,0 +1,172 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace msys
+{
+	///
+	/// @brief 后台写入器。
+	///
+	/// @note Write 只是把数据拷贝到池化的缓冲块中就返回，后台线程负责把缓冲块写入文件。
+	/// 所有缓冲块都在排队时，Write 才会阻塞等待。
+	///
+	/// @note 调用者空闲超过 idle_flush_interval 后，后台线程会把没填满的缓冲块也写入文件，
+	/// 少量追加、从不 Flush 的调用者（例如日志）的数据不会一直留在内存中。
+	///
+	/// @note 后台写入失败时，错误会在下一次调用 Write 或 Flush 时抛出。
+	///
+	/// @note Write 和 Flush 只能在同一个线程上调用。
+	///
+	class WriteBehindWriter
+	{
+	public:
+		///
+		/// @brief 实际执行写入的函数。在后台线程上调用。
+		///
+		/// @note 参数依次是文件偏移量、数据、数据长度。
+		///
+		using WriteFunction = std::function<void(int64_t, uint8_t const *, int64_t)>;
+
+	private:
+		///
+		/// @brief 缓冲块。
+		///
+		class Block
+		{
+		public:
+			std::unique_ptr<uint8_t[]> _buffer;
+
+			///
+			/// @brief 缓冲块第 0 个字节对应的文件偏移量。
+			///
+			int64_t _offset = 0;
+
+			///
+			/// @brief 缓冲块中有效数据的长度。
+			///
+			int64_t _length = 0;
+		};
+
+		WriteFunction _write;
+		int64_t _block_size = 0;
+
+		///
+		/// @brief 调用者空闲多久后，把没填满的缓冲块交给后台线程。
+		///
+		std::chrono::milliseconds _idle_flush_interval{};
+
+		///
+		/// @brief 最近一次 Write 的时间。
+		///
+		std::chrono::steady_clock::time_point _last_write_time{};
+
+		///
+		/// @brief 所有缓冲块。
+		///
+		std::vector<std::unique_ptr<Block>> _blocks;
+
+		///
+		/// @brief 空闲的缓冲块。
+		///
+		std::deque<Block *> _free_blocks;
+
+		///
+		/// @brief 等待后台线程写入的缓冲块。
+		///
+		std::deque<Block *> _pending_blocks;
+
+		///
+		/// @brief 调用者正在填充的缓冲块。
+		///
+		Block *_current = nullptr;
+
+		///
+		/// @brief 后台线程是否正在写入一个缓冲块。
+		///
+		bool _writing = false;
+
+		bool _stopping = false;
+
+		///
+		/// @brief 已经接收的数据中，最远的那个字节之后的文件偏移量。
+		///
+		int64_t _end_offset = 0;
+
+		std::exception_ptr _error;
+		std::mutex _lock;
+		std::condition_variable _condition;
+		std::thread _thread;
+
+		///
+		/// @brief 后台线程的线程函数。
+		///
+		void WriterThreadFunc();
+
+		///
+		/// @brief 把正在填充的缓冲块交给后台线程。
+		///
+		/// @param l 已经持有的锁。
+		///
+		void SubmitCurrent(std::unique_lock<std::mutex> &l);
+
+		///
+		/// @brief 如果后台线程写入失败过，抛出那个错误。
+		///
+		/// @param l 已经持有的锁。
+		///
+		void ThrowIfFailed(std::unique_lock<std::mutex> &l);
+
+	public:
+		///
+		/// @brief 构造后台写入器。
+		///
+		/// @param block_size 每个缓冲块的大小。
+		/// @param block_count 缓冲块的数量。
+		/// @param write 实际执行写入的函数。
+		/// @param idle_flush_interval 调用者空闲多久后，把没填满的缓冲块也写入文件。必须大于 0.
+		///
+		WriteBehindWriter(int64_t block_size,
+						  int64_t block_count,
+						  WriteFunction write,
+						  std::chrono::milliseconds idle_flush_interval = std::chrono::milliseconds{1000});
+
+		///
+		/// @brief 析构时会等待已经接收的数据写完。写入错误会被忽略，需要知道结果的话，
+		/// 析构前要先调用 Flush.
+		///
+		~WriteBehindWriter();
+
+		WriteBehindWriter(WriteBehindWriter const &) = delete;
+		WriteBehindWriter &operator=(WriteBehindWriter const &) = delete;
+
+		///
+		/// @brief 把数据拷贝到缓冲块中，准备写入到文件的 offset 处。
+		///
+		/// @param offset
+		/// @param buffer
+		/// @param count
+		///
+		void Write(int64_t offset, uint8_t const *buffer, int64_t count);
+
+		///
+		/// @brief 等待已经接收的数据全部写入文件。
+		///
+		void Flush();
+
+		///
+		/// @brief 已经接收的数据中，最远的那个字节之后的文件偏移量。
+		///
+		/// @return
+		///
+		int64_t EndOffset();
+	};
+
+} // namespace msys
@@ -0,0 +1,923 @@
+#include "file_copy.h"
+#include "base/filesystem/filesystem.h"
+#include "base/string/define.h"
+#include "msys-base/BulkOperationContext.h"
+#include "msys-base/CancellationToken.h"
+#include "msys-base/DUPLICATE_EXTENTS_DATA.h"
+#include "msys-base/FileStatus.h"
+#include "msys-base/HandleGuard.h"
+#include "msys-base/REPARSE_DATA_BUFFER.h"
+#include "msys-base/win32_error.h"
+#include "msys-base/windows_api.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+	///
+	/// @brief 用户态循环读写时的缓冲区大小。
+	///
+	int64_t constexpr CopyBufferSize = 1024 * 1024 * 4;
+
+	///
+	/// @brief 增量更新时逐块比较的块大小。
+	///
+	int64_t constexpr DeltaBlockSize = 1024 * 1024;
+
+	///
+	/// @brief 源文件不小于这个大小时才增量更新。小文件直接重新拷贝更快。
+	///
+	int64_t constexpr DeltaCopyMinSize = 1024 * 1024 * 64;
+
+	HANDLE OpenSource(base::Path const &path)
+	{
+		HANDLE h = CreateFileA(base::filesystem::ToWindowsLongPathString(path).c_str(),
+							   GENERIC_READ,
+							   FILE_SHARE_READ | FILE_SHARE_DELETE,
+							   nullptr,
+							   OPEN_EXISTING,
+							   FILE_FLAG_SEQUENTIAL_SCAN,
+							   nullptr);
+
+		if (h == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("打开 {} 失败。", path.ToString()) + msys::FormatError(GetLastError())};
+		}
+
+		return h;
+	}
+
+	HANDLE CreateDestination(base::Path const &path)
+	{
+		// 块克隆要求目标句柄可读可写。
+		HANDLE h = CreateFileA(base::filesystem::ToWindowsLongPathString(path).c_str(),
+							   GENERIC_READ | GENERIC_WRITE,
+							   0,
+							   nullptr,
+							   CREATE_ALWAYS,
+							   FILE_FLAG_SEQUENTIAL_SCAN,
+							   nullptr);
+
+		if (h == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("创建 {} 失败。", path.ToString()) + msys::FormatError(GetLastError())};
+		}
+
+		return h;
+	}
+
+	HANDLE OpenForUpdate(base::Path const &path)
+	{
+		HANDLE h = CreateFileA(base::filesystem::ToWindowsLongPathString(path).c_str(),
+							   GENERIC_READ | GENERIC_WRITE,
+							   0,
+							   nullptr,
+							   OPEN_EXISTING,
+							   FILE_FLAG_SEQUENTIAL_SCAN,
+							   nullptr);
+
+		if (h == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("打开 {} 失败。", path.ToString()) + msys::FormatError(GetLastError())};
+		}
+
+		return h;
+	}
+
+	int64_t GetSize(HANDLE h, base::Path const &path)
+	{
+		LARGE_INTEGER size{};
+
+		if (!GetFileSizeEx(h, &size))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("获取 {} 的大小失败。", path.ToString()) + msys::FormatError(GetLastError())};
+		}
+
+		return size.QuadPart;
+	}
+
+	///
+	/// @brief 拷贝后从源文件继承的属性。与 CopyFileExA 保留的属性一致。
+	///
+	DWORD constexpr InheritedAttributes = FILE_ATTRIBUTE_READONLY |
+										  FILE_ATTRIBUTE_HIDDEN |
+										  FILE_ATTRIBUTE_SYSTEM |
+										  FILE_ATTRIBUTE_ARCHIVE |
+										  FILE_ATTRIBUTE_NOT_CONTENT_INDEXED;
+
+	///
+	/// @brief 所有拷贝方式共用的收尾：把源文件的最后修改时间和属性设置到目标文件上。
+	///
+	/// @note CopyFileExA 本来就会保留这些，其他方式要自己设置，否则结果取决于选中了哪种方式。
+	/// 只读属性只影响之后的打开，已经打开的目标句柄仍然可以设置修改时间。
+	///
+	void CopyMetadata(HANDLE source, HANDLE destination, base::Path const &destination_path)
+	{
+		FILE_BASIC_INFO source_info{};
+
+		if (!GetFileInformationByHandleEx(source, FileBasicInfo, &source_info, sizeof(source_info)))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("拷贝到 {} 时获取源文件的属性失败。", destination_path.ToString()) + msys::FormatError(GetLastError())};
+		}
+
+		// 时间为 0 表示不修改。OverwriteOption::Update 靠比较最后修改时间判断是否需要更新，拷贝后两者要相同。
+		FILE_BASIC_INFO destination_info{};
+		destination_info.LastWriteTime = source_info.LastWriteTime;
+
+		// 属性为 0 表示不修改，所以没有可继承的属性时要显式设置为 FILE_ATTRIBUTE_NORMAL.
+		destination_info.FileAttributes = source_info.FileAttributes & InheritedAttributes;
+
+		if (destination_info.FileAttributes == 0)
+		{
+			destination_info.FileAttributes = FILE_ATTRIBUTE_NORMAL;
+		}
+
+		if (!SetFileInformationByHandle(destination, FileBasicInfo, &destination_info, sizeof(destination_info)))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("设置 {} 的修改时间和属性失败。", destination_path.ToString()) + msys::FormatError(GetLastError())};
+		}
+	}
+
+	///
+	/// @brief 把目标文件的最后修改时间设置为 FILETIME 的 1, 即 1601 年，并让之后通过这个句柄的
+	/// 写入不再更新它。
+	///
+	/// @note 这样目标文件一定比源文件旧，OverwriteOption::Update 会重新处理它。
+	///
+	void MarkStale(HANDLE destination, base::Path const &destination_path)
+	{
+		FILE_BASIC_INFO info{};
+		info.LastWriteTime.QuadPart = 1;
+
+		if (!SetFileInformationByHandle(destination, FileBasicInfo, &info, sizeof(info)))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("设置 {} 的修改时间失败。", destination_path.ToString()) + msys::FormatError(GetLastError())};
+		}
+
+		// -1 表示之后通过这个句柄的操作不再自动更新修改时间。
+		info.LastWriteTime.QuadPart = -1;
+
+		if (!SetFileInformationByHandle(destination, FileBasicInfo, &info, sizeof(info)))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("设置 {} 的修改时间失败。", destination_path.ToString()) + msys::FormatError(GetLastError())};
+		}
+	}
+
+	bool IsSparse(HANDLE h)
+	{
+		FILE_BASIC_INFO info{};
+
+		if (!GetFileInformationByHandleEx(h, FileBasicInfo, &info, sizeof(info)))
+		{
+			return false;
+		}
+
+		return info.FileAttributes & FILE_ATTRIBUTE_SPARSE_FILE;
+	}
+
+	bool TrySetSparse(HANDLE h)
+	{
+		DWORD returned = 0;
+		return DeviceIoControl(h, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &returned, nullptr);
+	}
+
+	bool SupportsBlockClone(HANDLE h)
+	{
+		DWORD flags = 0;
+
+		if (!GetVolumeInformationByHandleW(h, nullptr, 0, nullptr, nullptr, &flags, nullptr, 0))
+		{
+			return false;
+		}
+
+		return flags & FILE_SUPPORTS_BLOCK_REFCOUNTING;
+	}
+
+	///
+	/// @brief 尝试用块克隆拷贝整个文件。
+	///
+	/// @return 文件系统不支持，或者源和目标不在同一个卷上时返回 false.
+	///
+	bool TryBlockClone(HANDLE source, HANDLE destination, int64_t size)
+	{
+		DWORD returned = 0;
+		msys::FSCTL_GET_INTEGRITY_INFORMATION_BUFFER integrity{};
+
+		if (!DeviceIoControl(source,
+							 FSCTL_GET_INTEGRITY_INFORMATION,
+							 nullptr, 0,
+							 &integrity, sizeof(integrity),
+							 &returned,
+							 nullptr))
+		{
+			return false;
+		}
+
+		if (integrity.ClusterSizeInBytes == 0)
+		{
+			return false;
+		}
+
+		// 源文件和目标文件的完整性流设置必须一致，否则无法克隆。
+		msys::FSCTL_SET_INTEGRITY_INFORMATION_BUFFER set_integrity{};
+		set_integrity.ChecksumAlgorithm = integrity.ChecksumAlgorithm;
+		set_integrity.Flags = integrity.Flags;
+
+		if (!DeviceIoControl(destination,
+							 FSCTL_SET_INTEGRITY_INFORMATION,
+							 &set_integrity, sizeof(set_integrity),
+							 nullptr, 0,
+							 &returned,
+							 nullptr))
+		{
+			return false;
+		}
+
+		// 源文件是稀疏文件时，目标文件也必须是稀疏文件。
+		if (IsSparse(source) && !TrySetSparse(destination))
+		{
+			return false;
+		}
+
+		// 克隆不会改变目标文件的长度，要先设置好。
+		FILE_END_OF_FILE_INFO end_of_file{};
+		end_of_file.EndOfFile.QuadPart = size;
+
+		if (!SetFileInformationByHandle(destination, FileEndOfFileInfo, &end_of_file, sizeof(end_of_file)))
+		{
+			return false;
+		}
+
+		// 区间必须按簇对齐。最后一段向上取整到簇，超出文件末尾的部分不会被克隆。
+		int64_t cluster_size = integrity.ClusterSizeInBytes;
+		int64_t aligned_size = (size + cluster_size - 1) / cluster_size * cluster_size;
+
+		// 每次克隆的长度必须小于 4GB.
+		int64_t max_chunk_size = (int64_t{1} << 32) - cluster_size;
+
+		for (int64_t offset = 0; offset < aligned_size;)
+		{
+			int64_t chunk_size = std::min(max_chunk_size, aligned_size - offset);
+
+			msys::DUPLICATE_EXTENTS_DATA data{};
+			data.FileHandle = source;
+			data.SourceFileOffset.QuadPart = offset;
+			data.TargetFileOffset.QuadPart = offset;
+			data.ByteCount.QuadPart = chunk_size;
+
+			if (!DeviceIoControl(destination,
+								 FSCTL_DUPLICATE_EXTENTS_TO_FILE,
+								 &data, sizeof(data),
+								 nullptr, 0,
+								 &returned,
+								 nullptr))
+			{
+				return false;
+			}
+
+			offset += chunk_size;
+		}
+
+		return true;
+	}
+
+	OVERLAPPED CreateOverlapped(int64_t offset)
+	{
+		OVERLAPPED overlapped{};
+		overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		return overlapped;
+	}
+
+	///
+	/// @brief 报告新拷贝了 bytes 个字节。回调要求取消时抛出 msys::OperationCanceledException.
+	///
+	void ReportProgress(msys::CopyProgressCallback const &progress, int64_t bytes)
+	{
+		if (progress != nullptr && !progress(bytes))
+		{
+			throw msys::OperationCanceledException{CODE_POS_STR + "拷贝已取消。"};
+		}
+	}
+
+	///
+	/// @brief 从文件的 offset 处读取 count 个字节。
+	///
+	/// @return 实际读取的字节数。遇到文件末尾时小于 count.
+	///
+	int64_t ReadAt(HANDLE h, int64_t offset, uint8_t *buffer, int64_t count, base::Path const &path)
+	{
+		int64_t have_read = 0;
+
+		while (have_read < count)
+		{
+			DWORD size = static_cast<DWORD>(std::min(CopyBufferSize, count - have_read));
+			DWORD read = 0;
+			OVERLAPPED overlapped = CreateOverlapped(offset + have_read);
+
+			if (!ReadFile(h, buffer + have_read, size, &read, &overlapped))
+			{
+				DWORD error = GetLastError();
+
+				if (error == ERROR_HANDLE_EOF)
+				{
+					break;
+				}
+
+				throw std::runtime_error{CODE_POS_STR + std::format("读取 {} 失败。", path.ToString()) + msys::FormatError(error)};
+			}
+
+			if (read == 0)
+			{
+				break;
+			}
+
+			have_read += read;
+		}
+
+		return have_read;
+	}
+
+	///
+	/// @brief 将 count 个字节写入文件的 offset 处。
+	///
+	void WriteAt(HANDLE h, int64_t offset, uint8_t const *buffer, int64_t count, base::Path const &path)
+	{
+		int64_t have_written = 0;
+
+		while (have_written < count)
+		{
+			DWORD size = static_cast<DWORD>(std::min(CopyBufferSize, count - have_written));
+			DWORD written = 0;
+			OVERLAPPED overlapped = CreateOverlapped(offset + have_written);
+
+			if (!WriteFile(h, buffer + have_written, size, &written, &overlapped))
+			{
+				throw std::runtime_error{CODE_POS_STR + std::format("写入 {} 失败。", path.ToString()) + msys::FormatError(GetLastError())};
+			}
+
+			have_written += written;
+		}
+	}
+
+	///
+	/// @brief 将源文件 [offset, offset + length) 区间的数据拷贝到目标文件的相同位置。
+	///
+	/// @note 遇到源文件末尾时提前结束。
+	///
+	void CopyRange(HANDLE source,
+				   HANDLE destination,
+				   int64_t offset,
+				   int64_t length,
+				   uint8_t *buffer,
+				   msys::CopyProgressCallback const &progress,
+				   base::Path const &source_path,
+				   base::Path const &destination_path)
+	{
+		int64_t end = offset + length;
+
+		while (offset < end)
+		{
+			int64_t size = std::min(CopyBufferSize, end - offset);
+			int64_t have_read = ReadAt(source, offset, buffer, size, source_path);
+			WriteAt(destination, offset, buffer, have_read, destination_path);
+			offset += have_read;
+			ReportProgress(progress, have_read);
+
+			if (have_read < size)
+			{
+				return;
+			}
+		}
+	}
+
+	void CopyByBuffer(HANDLE source,
+					  HANDLE destination,
+					  int64_t size,
+					  msys::CopyProgressCallback const &progress,
+					  base::Path const &source_path,
+					  base::Path const &destination_path)
+	{
+		// 预先分配空间，减少碎片。失败不影响拷贝。
+		FILE_ALLOCATION_INFO allocation{};
+		allocation.AllocationSize.QuadPart = size;
+		SetFileInformationByHandle(destination, FileAllocationInfo, &allocation, sizeof(allocation));
+
+		std::unique_ptr<uint8_t[]> buffer{new uint8_t[CopyBufferSize]};
+		CopyRange(source, destination, 0, size, buffer.get(), progress, source_path, destination_path);
+	}
+
+	///
+	/// @brief 查询源文件中实际分配了磁盘空间的区间。没有列出的部分都是空洞。
+	///
+	std::vector<FILE_ALLOCATED_RANGE_BUFFER> QueryAllocatedRanges(HANDLE source,
+																   int64_t size,
+																   base::Path const &source_path)
+	{
+		std::vector<FILE_ALLOCATED_RANGE_BUFFER> ranges;
+		std::vector<FILE_ALLOCATED_RANGE_BUFFER> buffer(256);
+		int64_t offset = 0;
+
+		while (offset < size)
+		{
+			FILE_ALLOCATED_RANGE_BUFFER query{};
+			query.FileOffset.QuadPart = offset;
+			query.Length.QuadPart = size - offset;
+
+			DWORD returned = 0;
+
+			BOOL call_result = DeviceIoControl(source,
+											   FSCTL_QUERY_ALLOCATED_RANGES,
+											   &query, sizeof(query),
+											   buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(FILE_ALLOCATED_RANGE_BUFFER)),
+											   &returned,
+											   nullptr);
+
+			DWORD error = call_result ? ERROR_SUCCESS : GetLastError();
+
+			if (error != ERROR_SUCCESS && error != ERROR_MORE_DATA)
+			{
+				throw std::runtime_error{CODE_POS_STR + std::format("查询 {} 的已分配区间失败。", source_path.ToString()) + msys::FormatError(error)};
+			}
+
+			int64_t count = returned / sizeof(FILE_ALLOCATED_RANGE_BUFFER);
+
+			for (int64_t i = 0; i < count; i++)
+			{
+				ranges.push_back(buffer[i]);
+			}
+
+			if (error == ERROR_SUCCESS || count == 0)
+			{
+				break;
+			}
+
+			// 缓冲区装不下，从最后一个区间的末尾继续查询。
+			FILE_ALLOCATED_RANGE_BUFFER const &last = buffer[count - 1];
+			offset = last.FileOffset.QuadPart + last.Length.QuadPart;
+		}
+
+		return ranges;
+	}
+
+	///
+	/// @brief 尝试只拷贝稀疏文件中已分配的区间，在目标文件中保留空洞。
+	///
+	/// @return 目标所在的文件系统不支持稀疏文件时返回 false.
+	///
+	bool TrySparseCopy(HANDLE source,
+					   HANDLE destination,
+					   int64_t size,
+					   msys::CopyProgressCallback const &progress,
+					   base::Path const &source_path,
+					   base::Path const &destination_path)
+	{
+		if (!TrySetSparse(destination))
+		{
+			return false;
+		}
+
+		// 先把长度设置好，整个文件都是空洞，再把有数据的区间填进去。
+		FILE_END_OF_FILE_INFO end_of_file{};
+		end_of_file.EndOfFile.QuadPart = size;
+
+		if (!SetFileInformationByHandle(destination, FileEndOfFileInfo, &end_of_file, sizeof(end_of_file)))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("设置 {} 的长度失败。", destination_path.ToString()) + msys::FormatError(GetLastError())};
+		}
+
+		std::unique_ptr<uint8_t[]> buffer{new uint8_t[CopyBufferSize]};
+
+		int64_t copied_end = 0;
+
+		for (FILE_ALLOCATED_RANGE_BUFFER const &range : QueryAllocatedRanges(source, size, source_path))
+		{
+			// 空洞不需要拷贝，直接算作已完成。
+			ReportProgress(progress, range.FileOffset.QuadPart - copied_end);
+
+			CopyRange(source,
+					  destination,
+					  range.FileOffset.QuadPart,
+					  range.Length.QuadPart,
+					  buffer.get(),
+					  progress,
+					  source_path,
+					  destination_path);
+
+			copied_end = range.FileOffset.QuadPart + range.Length.QuadPart;
+		}
+
+		ReportProgress(progress, std::max<int64_t>(size - copied_end, 0));
+		return true;
+	}
+
+	///
+	/// @brief 逐块比较源文件和目标文件，只把不同的块写入目标文件，最后把目标文件截断到源文件的大小。
+	///
+	/// @note 本地拷贝两边的数据都要读一遍，直接比较比计算校验和更快，也不会有哈希碰撞。
+	///
+	void DeltaCopy(HANDLE source,
+				   HANDLE destination,
+				   int64_t size,
+				   msys::CopyProgressCallback const &progress,
+				   base::Path const &source_path,
+				   base::Path const &destination_path)
+	{
+		std::unique_ptr<uint8_t[]> source_buffer{new uint8_t[DeltaBlockSize]};
+		std::unique_ptr<uint8_t[]> destination_buffer{new uint8_t[DeltaBlockSize]};
+
+		for (int64_t offset = 0; offset < size; offset += DeltaBlockSize)
+		{
+			int64_t block_size = std::min(DeltaBlockSize, size - offset);
+			int64_t source_length = ReadAt(source, offset, source_buffer.get(), block_size, source_path);
+			int64_t destination_length = ReadAt(destination, offset, destination_buffer.get(), block_size, destination_path);
+
+			if (source_length != destination_length ||
+				std::memcmp(source_buffer.get(), destination_buffer.get(), source_length) != 0)
+			{
+				WriteAt(destination, offset, source_buffer.get(), source_length, destination_path);
+			}
+
+			ReportProgress(progress, source_length);
+
+			if (source_length < block_size)
+			{
+				// 源文件在拷贝过程中变短了。
+				size = offset + source_length;
+				break;
+			}
+		}
+
+		FILE_END_OF_FILE_INFO end_of_file{};
+		end_of_file.EndOfFile.QuadPart = size;
+
+		if (!SetFileInformationByHandle(destination, FileEndOfFileInfo, &end_of_file, sizeof(end_of_file)))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("设置 {} 的长度失败。", destination_path.ToString()) + msys::FormatError(GetLastError())};
+		}
+	}
+
+	///
+	/// @brief 传给 CopyFileExA 的进度回调的上下文。
+	///
+	class KernelCopyContext
+	{
+	public:
+		msys::CopyProgressCallback const *_progress = nullptr;
+
+		///
+		/// @brief 已经报告过的字节数。
+		///
+		int64_t _reported_bytes = 0;
+
+		///
+		/// @brief 回调要求取消。
+		///
+		bool _canceled = false;
+
+		///
+		/// @brief 回调抛出的异常。不能让异常穿过 CopyFileExA, 先存起来。
+		///
+		std::exception_ptr _error;
+	};
+
+	DWORD CALLBACK KernelCopyProgressRoutine(LARGE_INTEGER total_file_size,
+											 LARGE_INTEGER total_bytes_transferred,
+											 LARGE_INTEGER stream_size,
+											 LARGE_INTEGER stream_bytes_transferred,
+											 DWORD stream_number,
+											 DWORD callback_reason,
+											 HANDLE source_file,
+											 HANDLE destination_file,
+											 LPVOID data)
+	{
+		KernelCopyContext &context = *static_cast<KernelCopyContext *>(data);
+
+		try
+		{
+			int64_t bytes = total_bytes_transferred.QuadPart - context._reported_bytes;
+			context._reported_bytes = total_bytes_transferred.QuadPart;
+
+			if (bytes > 0 && !(*context._progress)(bytes))
+			{
+				context._canceled = true;
+				return PROGRESS_CANCEL;
+			}
+
+			return PROGRESS_CONTINUE;
+		}
+		catch (...)
+		{
+			context._error = std::current_exception();
+			return PROGRESS_CANCEL;
+		}
+	}
+
+	msys::CopyStrategy CopyFileContentCore(base::Path const &source_path,
+										   base::Path const &destination_path,
+										   msys::CopyProgressCallback const &progress)
+	{
+		{
+			HANDLE source = OpenSource(source_path);
+			msys::HandleGuard source_guard{source};
+
+			if (SupportsBlockClone(source))
+			{
+				HANDLE destination = CreateDestination(destination_path);
+				msys::HandleGuard destination_guard{destination};
+				int64_t size = GetSize(source, source_path);
+
+				if (TryBlockClone(source, destination, size))
+				{
+					CopyMetadata(source, destination, destination_path);
+					ReportProgress(progress, size);
+					return msys::CopyStrategy::BlockClone;
+				}
+
+				// 克隆失败留下的目标文件会被后面的方式覆盖。
+			}
+
+			if (IsSparse(source))
+			{
+				HANDLE destination = CreateDestination(destination_path);
+				msys::HandleGuard destination_guard{destination};
+
+				if (TrySparseCopy(source, destination, GetSize(source, source_path), progress, source_path, destination_path))
+				{
+					CopyMetadata(source, destination, destination_path);
+					return msys::CopyStrategy::Sparse;
+				}
+
+				// 目标所在的文件系统不支持稀疏文件，只能把空洞写成 0.
+			}
+		}
+
+		KernelCopyContext context{};
+		context._progress = &progress;
+
+		// CopyFileExA 会保留属性和修改时间。
+		if (CopyFileExA(base::filesystem::ToWindowsLongPathString(source_path).c_str(),
+						base::filesystem::ToWindowsLongPathString(destination_path).c_str(),
+						progress != nullptr ? KernelCopyProgressRoutine : nullptr,
+						&context,
+						nullptr,
+						0))
+		{
+			return msys::CopyStrategy::Kernel;
+		}
+
+		DWORD error = GetLastError();
+
+		if (context._error != nullptr)
+		{
+			std::rethrow_exception(context._error);
+		}
+
+		if (context._canceled)
+		{
+			throw msys::OperationCanceledException{CODE_POS_STR + "拷贝已取消。"};
+		}
+
+		if (error != ERROR_NOT_SUPPORTED &&
+			error != ERROR_INVALID_FUNCTION &&
+			error != ERROR_INVALID_PARAMETER)
+		{
+			// 源文件不存在、没有权限等错误，换一种方式也不会成功。
+			std::string message = CODE_POS_STR + std::format("将 {} 拷贝到 {} 失败。",
+															 source_path.ToString(),
+															 destination_path.ToString());
+
+			throw std::runtime_error{message + msys::FormatError(error)};
+		}
+
+		HANDLE source = OpenSource(source_path);
+		msys::HandleGuard source_guard{source};
+		HANDLE destination = CreateDestination(destination_path);
+		msys::HandleGuard destination_guard{destination};
+
+		// CopyFileExA 可能已经报告过一部分进度，从那里接着报告会重复计数，所以扣掉。
+		ReportProgress(progress, -context._reported_bytes);
+
+		CopyByBuffer(source, destination, GetSize(source, source_path), progress, source_path, destination_path);
+		CopyMetadata(source, destination, destination_path);
+		return msys::CopyStrategy::Buffered;
+	}
+
+	///
+	/// @brief 删除拷贝失败留下的目标文件。
+	///
+	void DeleteIncompleteFile(base::Path const &path)
+	{
+		DeleteFileA(base::filesystem::ToWindowsLongPathString(path).c_str());
+	}
+
+} // namespace
+
+msys::CopyStrategy msys::CopyFileContent(base::Path const &source_path,
+										 base::Path const &destination_path,
+										 msys::CopyProgressCallback const &progress)
+{
+	try
+	{
+		return CopyFileContentCore(source_path, destination_path, progress);
+	}
+	catch (...)
+	{
+		// 目标文件只拷贝了一部分，不能留下。
+		DeleteIncompleteFile(destination_path);
+		throw;
+	}
+}
+
+msys::CopyStrategy msys::UpdateFileContent(base::Path const &source_path,
+										   base::Path const &destination_path,
+										   msys::CopyProgressCallback const &progress)
+{
+	if (msys::Status(destination_path, false).type == msys::FileType::RegularFile)
+	{
+		HANDLE source = OpenSource(source_path);
+		msys::HandleGuard source_guard{source};
+		int64_t size = GetSize(source, source_path);
+
+		// 能块克隆时克隆更快，并且不占用新的空间。
+		if (size >= DeltaCopyMinSize && !SupportsBlockClone(source))
+		{
+			base::filesystem::RemoveReadOnlyAttribute(destination_path);
+
+			HANDLE destination = OpenForUpdate(destination_path);
+			msys::HandleGuard destination_guard{destination};
+
+			// 改写到一半时失败、被取消或者进程被杀，目标文件是新旧内容的混合。不能删除它，
+			// 它可能很大，而且只改了几个块；也不能让它的修改时间比源文件新，否则下次更新会跳过它。
+			// 所以先把修改时间标记为很早，并停止自动更新，成功后再设置为源文件的修改时间。
+			MarkStale(destination, destination_path);
+
+			DeltaCopy(source, destination, size, progress, source_path, destination_path);
+			CopyMetadata(source, destination, destination_path);
+			return msys::CopyStrategy::Delta;
+		}
+	}
+
+	base::filesystem::Remove(destination_path);
+	return msys::CopyFileContent(source_path, destination_path, progress);
+}
+
+std::optional<msys::CopyStrategy> msys::CopyRegularFile(base::Path const &source_path,
+														 base::Path const &destination_path,
+														 base::filesystem::OverwriteOption overwrite_method,
+														 msys::CopyProgressCallback const &progress)
+{
+	msys::FileStatus source_status = msys::Status(source_path, false);
+
+	if (source_status.type == msys::FileType::SymbolicLink)
+	{
+		throw std::runtime_error{CODE_POS_STR + source_path.ToString() + " 是一个符号链接，不是常规文件。"};
+	}
+
+	if (source_status.type != msys::FileType::RegularFile)
+	{
+		throw std::runtime_error{CODE_POS_STR + source_path.ToString() + " 不是一个常规文件。"};
+	}
+
+	if (destination_path.IsRootPath())
+	{
+		throw std::runtime_error{CODE_POS_STR + "无法将源路径移动为根路径。"};
+	}
+
+	msys::FileStatus destination_status = msys::Status(destination_path, false);
+
+	if (!destination_status.Exists())
+	{
+		// 目标路径不存在，直接复制。
+		msys::EnsureDirectory(destination_path.ParentPath());
+
+		// 拷贝单个文件。
+		return msys::CopyFileContent(source_path, destination_path, progress);
+	}
+
+	// 目标路径存在
+	if (overwrite_method == base::filesystem::OverwriteOption::Skip)
+	{
+		return std::nullopt;
+	}
+
+	bool should_overwrite = false;
+
+	if (overwrite_method == base::filesystem::OverwriteOption::Overwrite)
+	{
+		should_overwrite = true;
+	}
+
+	// 如果更新则覆盖
+	if (source_status.last_write_time > destination_status.last_write_time)
+	{
+		should_overwrite = true;
+	}
+
+	if (!should_overwrite)
+	{
+		return std::nullopt;
+	}
+
+	if (overwrite_method == base::filesystem::OverwriteOption::Update)
+	{
+		// 源文件更新了。大文件往往只改了一小部分，只重写有变化的块。
+		return msys::UpdateFileContent(source_path, destination_path, progress);
+	}
+
+	// 需要覆盖
+	base::filesystem::Remove(destination_path);
+	return msys::CopyFileContent(source_path, destination_path, progress);
+}
+
+void msys::CopyJunction(base::Path const &source_path, base::Path const &destination_path)
+{
+	std::string source = base::filesystem::ToWindowsLongPathString(source_path);
+	std::string destination = base::filesystem::ToWindowsLongPathString(destination_path);
+
+	std::unique_ptr<uint8_t[]> buffer{new uint8_t[MAXIMUM_REPARSE_DATA_BUFFER_SIZE]};
+	DWORD buffer_size = 0;
+
+	{
+		HANDLE h = CreateFileA(source.c_str(),
+							   0,
+							   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+							   nullptr,
+							   OPEN_EXISTING,
+							   FILE_FLAG_OPEN_REPARSE_POINT | FILE_FLAG_BACKUP_SEMANTICS,
+							   nullptr);
+
+		if (h == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("打开 {} 失败。", source_path.ToString()) + msys::FormatError(GetLastError())};
+		}
+
+		msys::HandleGuard g{h};
+
+		if (!DeviceIoControl(h,
+							 FSCTL_GET_REPARSE_POINT,
+							 nullptr,
+							 0,
+							 buffer.get(),
+							 MAXIMUM_REPARSE_DATA_BUFFER_SIZE,
+							 &buffer_size,
+							 nullptr))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("读取 {} 的重分析点数据失败。", source_path.ToString()) + msys::FormatError(GetLastError())};
+		}
+	}
+
+	if (reinterpret_cast<REPARSE_DATA_BUFFER *>(buffer.get())->ReparseTag != static_cast<DWORD>(IO_REPARSE_TAG_MOUNT_POINT))
+	{
+		throw std::runtime_error{CODE_POS_STR + source_path.ToString() + " 不是目录交接点。"};
+	}
+
+	// 交接点的数据中保存的是目标的绝对路径，原样写到新的空目录上即可。
+	if (!CreateDirectoryA(destination.c_str(), nullptr))
+	{
+		throw std::runtime_error{CODE_POS_STR + std::format("创建 {} 失败。", destination_path.ToString()) + msys::FormatError(GetLastError())};
+	}
+
+	try
+	{
+		HANDLE h = CreateFileA(destination.c_str(),
+							   GENERIC_WRITE,
+							   0,
+							   nullptr,
+							   OPEN_EXISTING,
+							   FILE_FLAG_OPEN_REPARSE_POINT | FILE_FLAG_BACKUP_SEMANTICS,
+							   nullptr);
+
+		if (h == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("打开 {} 失败。", destination_path.ToString()) + msys::FormatError(GetLastError())};
+		}
+
+		msys::HandleGuard g{h};
+
+		DWORD returned_size = 0;
+
+		if (!DeviceIoControl(h,
+							 FSCTL_SET_REPARSE_POINT,
+							 buffer.get(),
+							 buffer_size,
+							 nullptr,
+							 0,
+							 &returned_size,
+							 nullptr))
+		{
+			throw std::runtime_error{CODE_POS_STR + std::format("将 {} 设置为目录交接点失败。", destination_path.ToString()) + msys::FormatError(GetLastError())};
+		}
+	}
+	catch (...)
+	{
+		// 不留下一个空目录冒充交接点。
+		RemoveDirectoryA(destination.c_str());
+		throw;
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "base/filesystem/filesystem.h"
+#include "base/filesystem/Path.h"
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+namespace msys
+{
+	///
+	/// @brief 拷贝文件内容时实际使用的方式。
+	///
+	enum class CopyStrategy
+	{
+		///
+		/// @brief 块克隆。目标文件与源文件共享磁盘上的数据块，修改时才分离。
+		///
+		/// @note 只有 ReFS 等支持块引用计数的文件系统，并且源和目标在同一个卷上时才能使用。
+		/// 耗时与文件大小基本无关。
+		///
+		BlockClone,
+
+		///
+		/// @brief 源文件是稀疏文件，只拷贝已分配的区间，目标文件中保留空洞。
+		///
+		Sparse,
+
+		///
+		/// @brief 由 CopyFileExA 在内核中搬运数据，不经过用户态缓冲区。
+		///
+		Kernel,
+
+		///
+		/// @brief 在用户态用大缓冲区循环读写。前面的方式都不可用时才使用。
+		///
+		Buffered,
+
+		///
+		/// @brief 增量更新。逐块比较源文件和已存在的目标文件，只重写不同的块。
+		///
+		Delta,
+	};
+
+	///
+	/// @brief 拷贝单个文件时的进度回调。
+	///
+	/// @note 参数是这次新完成的字节数。某种方式中途失败、换另一种方式重新拷贝时，
+	/// 会传入负数撤销之前报告的字节数。
+	/// @note 返回 false 表示要取消拷贝，拷贝函数会抛出 msys::OperationCanceledException.
+	///
+	using CopyProgressCallback = std::function<bool(int64_t)>;
+
+	///
+	/// @brief 将源文件的内容拷贝到目标文件。目标文件已存在则覆盖。
+	///
+	/// @note 依次尝试块克隆、稀疏拷贝、CopyFileExA, 用户态循环读写，使用第一个可用的方式。
+	/// 稀疏拷贝只用于源文件带有稀疏属性的情况。
+	/// @note 无论用哪种方式，目标文件的最后修改时间和只读、隐藏、系统、存档等属性都与源文件相同。
+	/// @note 失败或被取消时目标文件会被删除。
+	///
+	/// @param source_path 源文件。
+	/// @param destination_path 目标文件。父目录必须存在。
+	/// @param progress 进度回调。可以为空。
+	///
+	/// @return 实际使用的拷贝方式。
+	///
+	msys::CopyStrategy CopyFileContent(base::Path const &source_path,
+									   base::Path const &destination_path,
+									   msys::CopyProgressCallback const &progress = nullptr);
+
+	///
+	/// @brief 用源文件的内容更新已存在的目标文件。
+	///
+	/// @note 目标是常规文件、源文件较大并且不能块克隆时，逐块比较后只重写不同的块。
+	/// 否则删除目标后用 CopyFileContent 重新拷贝。
+	/// @note 逐块更新失败或被取消时不会删除目标文件，只把它的最后修改时间标记为 1601 年，
+	/// 下次更新时它比源文件旧，会被重新处理。重新拷贝失败时目标文件会被删除。
+	///
+	/// @param source_path 源文件。
+	/// @param destination_path 目标文件。
+	/// @param progress 进度回调。可以为空。
+	///
+	/// @return 实际使用的拷贝方式。
+	///
+	msys::CopyStrategy UpdateFileContent(base::Path const &source_path,
+										 base::Path const &destination_path,
+										 msys::CopyProgressCallback const &progress = nullptr);
+
+	///
+	/// @brief 按照覆盖选项拷贝一个常规文件。base::filesystem::CopyRegularFile 的实现。
+	///
+	/// @param source_path 源文件。
+	/// @param destination_path 目标文件。
+	/// @param overwrite_method 目标已存在时怎么处理。
+	/// @param progress 进度回调。可以为空。
+	///
+	/// @return 实际使用的拷贝方式。目标已存在并且不需要覆盖时返回 std::nullopt.
+	///
+	std::optional<msys::CopyStrategy> CopyRegularFile(base::Path const &source_path,
+													  base::Path const &destination_path,
+													  base::filesystem::OverwriteOption overwrite_method,
+													  msys::CopyProgressCallback const &progress = nullptr);
+
+	///
+	/// @brief 在目标路径重新创建一个目录交接点，指向与源交接点相同的目标。
+	///
+	/// @note 跨卷移动目录交接点时不能重命名，只能在目标卷上重新创建。目标路径必须不存在。
+	///
+	/// @param source_path 源目录交接点。
+	/// @param destination_path 目标路径。
+	///
+	void CopyJunction(base::Path const &source_path, base::Path const &destination_path);
+
+} // namespace msys
@@ -3,9 +3,15 @@
 #include "base/filesystem/Path.h"
 #include "base/string/define.h"
 #include "base/string/String.h"
+#include "msys-base/BulkOperationContext.h"
+#include "msys-base/CopyEngine.h"
 #include "msys-base/DirectoryEntryEnumerator.h"
+#include "msys-base/file_copy.h"
+#include "msys-base/FileStatus.h"
 #include "msys-base/HandleGuard.h"
+#include "msys-base/MetadataCache.h"
 #include "msys-base/RecursiveDirectoryEntryEnumerator.h"
+#include "msys-base/RemoveEngine.h"
 #include "msys-base/REPARSE_DATA_BUFFER.h"
 #include "msys-base/windows_api.h"
 #include <cstddef>
@@ -43,21 +49,8 @@ bool base::filesystem::IsDirectory(base::Path const &path)
 {
 	try
 	{
-		std::error_code error_code{};
-		bool ret = std::filesystem::is_directory(ToWindowsLongPathString(path), error_code);
-
-		if (error_code.value() != 0)
-		{
-			std::string message = CODE_POS_STR;
-
-			message += std::format("错误代码：{}，错误消息：{}",
-								   error_code.value(),
-								   error_code.message());
-
-			throw std::runtime_error{message};
-		}
-
-		return ret;
+		// 跟随链接。指向目录的符号链接和目录交接点都算作目录。
+		return msys::MetadataCache::Instance().Status(path, true).type == msys::FileType::Directory;
 	}
 	catch (std::exception const &e)
 	{
@@ -71,79 +64,30 @@ bool base::filesystem::IsDirectory(base::Path const &path)
 
 bool base::filesystem::IsRegularFile(base::Path const &path)
 {
-	std::error_code error_code{};
-	bool ret = std::filesystem::is_regular_file(ToWindowsLongPathString(path), error_code);
-
-	if (error_code.value() != 0)
-	{
-		std::string message = CODE_POS_STR;
-
-		message += std::format("错误代码：{}，错误消息：{}",
-							   error_code.value(),
-							   error_code.message());
-
-		throw std::runtime_error{message};
-	}
-
-	return ret;
+	// 跟随链接。
+	return msys::MetadataCache::Instance().Status(path, true).type == msys::FileType::RegularFile;
 }
 
 bool base::filesystem::IsSymbolicLink(base::Path const &path)
 {
-	HANDLE h = CreateFileA(ToWindowsLongPathString(path).c_str(),
-						   0,
-						   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-						   nullptr,
-						   OPEN_EXISTING,
-						   FILE_FLAG_OPEN_REPARSE_POINT | FILE_FLAG_BACKUP_SEMANTICS,
-						   nullptr);
-
-	msys::HandleGuard g{h};
+	msys::FileStatus status = msys::MetadataCache::Instance().Status(path, false);
 
-	if (h == INVALID_HANDLE_VALUE)
+	if (!status.Exists())
 	{
-		throw std::runtime_error{CODE_POS_STR + "调用 CreateFileA 失败，无法打开文件。"};
+		throw std::runtime_error{CODE_POS_STR + path.ToString() + " 不存在。"};
 	}
 
-	FILE_ATTRIBUTE_TAG_INFO info;
-
-	WINBOOL call_result = GetFileInformationByHandleEx(h,
-													   FileAttributeTagInfo,
-													   &info,
-													   sizeof(info));
-
-	if (!call_result)
-	{
-		throw std::runtime_error{CODE_POS_STR + "调用 GetFileInformationByHandleEx 获取文件属性失败。"};
-	}
-
-	if (info.ReparseTag == IO_REPARSE_TAG_SYMLINK)
-	{
-		return true;
-	}
-
-	return false;
+	// 目录交接点不算作符号链接。
+	return status.type == msys::FileType::SymbolicLink;
 }
 
 bool base::filesystem::IsSymbolicLinkDirectory(base::Path const &path)
 {
-	if (!IsSymbolicLink(path))
-	{
-		return false;
-	}
-
-	DWORD attrs = GetFileAttributesA(path.ToString().c_str());
-
-	if (attrs == INVALID_FILE_ATTRIBUTES)
-	{
-		return false;
-	}
+	msys::FileStatus status = msys::MetadataCache::Instance().Status(path, false);
 
 	// 是符号链接并且是目录
-	bool ret = (attrs & FILE_ATTRIBUTE_REPARSE_POINT) &&
-			   (attrs & FILE_ATTRIBUTE_DIRECTORY);
-
-	return ret;
+	return status.type == msys::FileType::SymbolicLink &&
+		   (status.attributes & FILE_ATTRIBUTE_DIRECTORY);
 }
 
 /* #endregion */
@@ -157,108 +101,133 @@ base::Path base::filesystem::CurrentPath()
 
 bool base::filesystem::Exists(base::Path const &path)
 {
-	// 经过测试，std::filesystem::exists 函数对于符号链接，返回值指示的
-	// 是符号链接文件本身是否存在，而不是符号链接指向的目标是否存在。
-
-	std::error_code error_code{};
-	bool ret = std::filesystem::exists(ToWindowsLongPathString(path), error_code);
+	// 不跟随链接。对于符号链接，返回值指示的是符号链接本身是否存在，
+	// 而不是符号链接指向的目标是否存在。
+	return msys::MetadataCache::Instance().Status(path, false).Exists();
+}
 
-	if (error_code.value() != 0)
+namespace
+{
+	base::Path ReadSymbolicLinkTarget(base::Path const &symbolic_link_obj_path)
 	{
-		std::string message = CODE_POS_STR;
+		HANDLE h = CreateFileA(base::filesystem::ToWindowsLongPathString(symbolic_link_obj_path).c_str(),
+							   0,
+							   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+							   nullptr,
+							   OPEN_EXISTING,
+							   FILE_FLAG_OPEN_REPARSE_POINT | FILE_FLAG_BACKUP_SEMANTICS,
+							   nullptr);
 
-		message += std::format("检查文件是否存在失败。错误代码：{}，错误消息：{}",
-							   error_code.value(),
-							   error_code.message());
+		msys::HandleGuard g{h};
 
-		throw std::runtime_error{message};
-	}
+		if (h == INVALID_HANDLE_VALUE)
+		{
+			throw std::runtime_error{CODE_POS_STR + "CreateFileA 调用失败，无法打开符号链接文件。"};
+		}
 
-	return ret;
-}
+		int64_t buffer_size = 1024 * 32;
+		std::unique_ptr<uint8_t[]> buffer{new uint8_t[buffer_size]};
 
-base::Path base::filesystem::ReadSymboliclink(base::Path const &symbolic_link_obj_path)
-{
-	HANDLE h = CreateFileA(ToWindowsLongPathString(symbolic_link_obj_path).c_str(),
-						   0,
-						   FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
-						   nullptr,
-						   OPEN_EXISTING,
-						   FILE_FLAG_OPEN_REPARSE_POINT | FILE_FLAG_BACKUP_SEMANTICS,
-						   nullptr);
+		// === 核心修改开始 ===
+		// 使用 DeviceIoControl 获取重分析点数据，而不是解析最终路径
+		DWORD returned_len = 0;
 
-	msys::HandleGuard g{h};
+		BOOL ioResult = DeviceIoControl(h,
+										FSCTL_GET_REPARSE_POINT, // 关键指令：获取原始数据
+										nullptr, 0,
+										buffer.get(), static_cast<DWORD>(buffer_size),
+										&returned_len,
+										nullptr);
 
-	if (h == INVALID_HANDLE_VALUE)
-	{
-		throw std::runtime_error{CODE_POS_STR + "CreateFileA 调用失败，无法打开符号链接文件。"};
-	}
+		if (!ioResult || returned_len == 0)
+		{
+			throw std::runtime_error{CODE_POS_STR + "DeviceIoControl 调用失败，无法读取重分析点数据。"};
+		}
 
-	int64_t buffer_size = 1024 * 32;
-	std::unique_ptr<uint8_t[]> buffer{new uint8_t[buffer_size]};
+		// 解析缓冲区获取原始路径文本
+		REPARSE_DATA_BUFFER *rdb = reinterpret_cast<REPARSE_DATA_BUFFER *>(buffer.get());
 
-	// === 核心修改开始 ===
-	// 使用 DeviceIoControl 获取重分析点数据，而不是解析最终路径
-	DWORD returned_len = 0;
+		// 检查是否为符号链接标签
+		if (rdb->ReparseTag != IO_REPARSE_TAG_SYMLINK)
+		{
+			throw std::runtime_error{CODE_POS_STR + symbolic_link_obj_path.ToString() + " 不是符号链接。"};
+		}
 
-	BOOL ioResult = DeviceIoControl(h,
-									FSCTL_GET_REPARSE_POINT, // 关键指令：获取原始数据
-									nullptr, 0,
-									buffer.get(), static_cast<DWORD>(buffer_size),
-									&returned_len,
-									nullptr);
+		// 提取 SubstituteName (内部存储的原始路径)
+		USHORT nameOffset = rdb->SymbolicLinkReparseBuffer.SubstituteNameOffset;
+		USHORT nameLength = rdb->SymbolicLinkReparseBuffer.SubstituteNameLength;
 
-	if (!ioResult || returned_len == 0)
-	{
-		throw std::runtime_error{CODE_POS_STR + "DeviceIoControl 调用失败，无法读取重分析点数据。"};
-	}
+		// 注意：Windows 内部使用 UTF-16，这里简单处理为字节偏移
+		WCHAR *rawPathPtr = reinterpret_cast<WCHAR *>(reinterpret_cast<BYTE *>(&rdb->SymbolicLinkReparseBuffer.PathBuffer) +
+													  nameOffset);
 
-	// 解析缓冲区获取原始路径文本
-	REPARSE_DATA_BUFFER *rdb = reinterpret_cast<REPARSE_DATA_BUFFER *>(buffer.get());
+		int wcharCount = nameLength / sizeof(WCHAR);
 
-	// 检查是否为符号链接标签
-	if (rdb->ReparseTag != IO_REPARSE_TAG_SYMLINK)
-	{
-		throw std::runtime_error{CODE_POS_STR + symbolic_link_obj_path.ToString() + " 不是符号链接。"};
+		int ansi_string_size = WideCharToMultiByte(CP_ACP,
+												   0,
+												   rawPathPtr,
+												   wcharCount,
+												   reinterpret_cast<char *>(buffer.get()),
+												   static_cast<int>(buffer_size),
+												   nullptr, nullptr);
+
+		if (ansi_string_size == 0 || ansi_string_size >= buffer_size)
+		{
+			throw std::runtime_error{CODE_POS_STR + "路径编码转换失败。"};
+		}
+		// === 核心修改结束 ===
+
+		// 原有代码保持不变
+		std::string result{
+			reinterpret_cast<char *>(buffer.get()),
+			static_cast<size_t>(ansi_string_size), // 使用转换后的长度
+		};
+
+		return base::filesystem::WindowsLongPathStringToPath(result);
 	}
 
-	// 提取 SubstituteName (内部存储的原始路径)
-	USHORT nameOffset = rdb->SymbolicLinkReparseBuffer.SubstituteNameOffset;
-	USHORT nameLength = rdb->SymbolicLinkReparseBuffer.SubstituteNameLength;
+	///
+	/// @brief 找出逐级创建 path 时最上层的那个新目录。
+	///
+	/// @note 从 path 开始沿父目录向上，直到父目录已经存在。让它的缓存失效就覆盖了所有新建的目录，
+	/// 包括之前缓存为不存在的祖先目录。不经过缓存，缓存中的状态可能已经过时。
+	///
+	/// @param path
+	///
+	/// @return
+	///
+	base::Path TopmostMissingDirectory(base::Path const &path)
+	{
+		base::Path top = path;
 
-	// 注意：Windows 内部使用 UTF-16，这里简单处理为字节偏移
-	WCHAR *rawPathPtr = reinterpret_cast<WCHAR *>(reinterpret_cast<BYTE *>(&rdb->SymbolicLinkReparseBuffer.PathBuffer) +
-												  nameOffset);
+		while (!top.IsRootPath())
+		{
+			base::Path parent = top.ParentPath();
 
-	int wcharCount = nameLength / sizeof(WCHAR);
+			if (parent == top || msys::Status(parent, false).Exists())
+			{
+				break;
+			}
 
-	int ansi_string_size = WideCharToMultiByte(CP_ACP,
-											   0,
-											   rawPathPtr,
-											   wcharCount,
-											   reinterpret_cast<char *>(buffer.get()),
-											   static_cast<int>(buffer_size),
-											   nullptr, nullptr);
+			top = parent;
+		}
 
-	if (ansi_string_size == 0 || ansi_string_size >= buffer_size)
-	{
-		throw std::runtime_error{CODE_POS_STR + "路径编码转换失败。"};
+		return top;
 	}
-	// === 核心修改结束 ===
 
-	// 原有代码保持不变
-	std::string result{
-		reinterpret_cast<char *>(buffer.get()),
-		static_cast<size_t>(ansi_string_size), // 使用转换后的长度
-	};
+} // namespace
 
-	return base::filesystem::WindowsLongPathStringToPath(result);
+base::Path base::filesystem::ReadSymboliclink(base::Path const &symbolic_link_obj_path)
+{
+	return msys::MetadataCache::Instance().ReadSymbolicLink(symbolic_link_obj_path, ReadSymbolicLinkTarget);
 }
 
 void base::filesystem::CreateSymboliclink(base::Path const &symbolic_link_obj_path,
 										  base::Path const &link_to_path,
 										  bool is_directory)
 {
+	msys::MetadataCache::InvalidationGuard invalidation_guard{symbolic_link_obj_path};
+
 	DWORD flags = 0;
 
 	if (is_directory)
@@ -285,6 +254,8 @@ void base::filesystem::CreateSymboliclink(base::Path const &symbolic_link_obj_pa
 
 void base::filesystem::CreateDirectory(base::Path const &path)
 {
+	msys::MetadataCache::InvalidationGuard invalidation_guard{path};
+
 	if (base::filesystem::Exists(path))
 	{
 		std::string message = CODE_POS_STR;
@@ -315,6 +286,9 @@ void base::filesystem::CreateDirectory(base::Path const &path)
 
 void base::filesystem::CreateDirectoryRecursively(base::Path const &path)
 {
+	// 祖先目录也可能被创建。
+	msys::MetadataCache::InvalidationGuard invalidation_guard{TopmostMissingDirectory(path)};
+
 	if (base::filesystem::Exists(path))
 	{
 		std::string message = CODE_POS_STR;
@@ -350,83 +324,37 @@ void base::filesystem::CreateDirectoryRecursively(base::Path const &path)
 
 void base::filesystem::Remove(base::Path const &path)
 {
-	if (!base::filesystem::Exists(path))
-	{
-		// 路径不存在，直接返回。
-		return;
-	}
+	msys::MetadataCache::InvalidationGuard invalidation_guard{path};
 
-	if (base::filesystem::IsSymbolicLink(path))
-	{
-		std::error_code error_code{};
-		std::filesystem::remove(base::filesystem::ToWindowsLongPathString(path), error_code);
+	msys::FileStatus status = msys::Status(path, false);
 
-		if (error_code.value() != 0)
+	switch (status.type)
+	{
+	case msys::FileType::NotFound:
 		{
-			std::string message = std::format("{} 删除 {} 失败。错误代码：{}，错误消息：{}",
-											  CODE_POS_STR,
-											  path.ToString(),
-											  error_code.value(),
-											  error_code.message());
-
-			throw std::runtime_error{message};
+			// 路径不存在，直接返回。
+			return;
 		}
-
-		return;
-	}
-
-	if (base::filesystem::IsRegularFile(path))
-	{
-		base::filesystem::RemoveReadOnlyAttribute(path);
-
-		std::error_code error_code{};
-		std::filesystem::remove(base::filesystem::ToWindowsLongPathString(path));
-
-		if (error_code.value() != 0)
+	case msys::FileType::SymbolicLink:
+	case msys::FileType::Junction:
+	case msys::FileType::RegularFile:
 		{
-			std::string message = std::format("{} 删除 {} 失败。错误代码：{}，错误消息：{}",
-											  CODE_POS_STR,
-											  path.ToString(),
-											  error_code.value(),
-											  error_code.message());
-
-			throw std::runtime_error{message};
+			// 链接只删除它本身。只读属性只在带有时才清除。
+			msys::RemoveEngine::RemoveEntry(base::filesystem::ToWindowsLongPathString(path), status.attributes);
+			return;
 		}
-
-		return;
-	}
-
-	if (base::filesystem::IsDirectory(path))
-	{
-		base::filesystem::RemoveReadOnlyAttributeRecursively(path);
-
-		std::error_code error_code{};
-
-		// 返回值是 uintmax_t ，含义是递归删除的项目总数。
-		auto removed_count = std::filesystem::remove_all(base::filesystem::ToWindowsLongPathString(path),
-														 error_code);
-
-		if (error_code.value() != 0)
+	case msys::FileType::Directory:
 		{
-			std::string message = std::format("{} 删除 {} 失败。错误代码：{}，错误消息：{}",
-											  CODE_POS_STR,
-											  path.ToString(),
-											  error_code.value(),
-											  error_code.message());
-
-			throw std::runtime_error{message};
+			// 遍历、清除只读属性、删除在一趟中并行完成，目录在清空后立即删除。
+			msys::RemoveEngine engine{0};
+			engine.RemoveDirectoryTree(path);
+			return;
 		}
-
-		if (removed_count == 0)
+	default:
 		{
-			std::string message = CODE_POS_STR + "删除失败，因为删除了 0 个项目，但是没有错误代码。";
-			throw std::runtime_error{message};
+			throw std::runtime_error{CODE_POS_STR + path.ToString() + " 是未知的目录条目。"};
 		}
-
-		return;
 	}
-
-	throw std::runtime_error{CODE_POS_STR + path.ToString() + " 是未知的目录条目。"};
 }
 
 /* #endregion */
@@ -437,13 +365,19 @@ void base::filesystem::CopySymbolicLink(base::Path const &source_path,
 										base::Path const &destination_path,
 										base::filesystem::OverwriteOption overwrite_method)
 {
+	msys::MetadataCache::InvalidationGuard invalidation_guard{destination_path};
+
 	try
 	{
-		if (!base::filesystem::IsSymbolicLink(source_path))
+		msys::FileStatus source_status = msys::Status(source_path, false);
+
+		if (source_status.type != msys::FileType::SymbolicLink)
 		{
 			throw std::runtime_error{CODE_POS_STR + "源路径不是符号链接。"};
 		}
 
+		bool is_directory = source_status.attributes & FILE_ATTRIBUTE_DIRECTORY;
+
 		if (destination_path.IsRootPath())
 		{
 			throw std::runtime_error{CODE_POS_STR + "无法将源路径移动为根路径。"};
@@ -452,11 +386,11 @@ void base::filesystem::CopySymbolicLink(base::Path const &source_path,
 		if (!base::filesystem::Exists(destination_path))
 		{
 			// 目标路径不存在。
-			base::filesystem::EnsureDirectory(destination_path.ParentPath());
+			msys::EnsureDirectory(destination_path.ParentPath());
 
 			base::filesystem::CreateSymboliclink(destination_path,
 												 base::filesystem::ReadSymboliclink(source_path),
-												 base::filesystem::IsSymbolicLinkDirectory(source_path.ToString()));
+												 is_directory);
 
 			return;
 		}
@@ -473,7 +407,7 @@ void base::filesystem::CopySymbolicLink(base::Path const &source_path,
 
 		base::filesystem::CreateSymboliclink(destination_path,
 											 base::filesystem::ReadSymboliclink(source_path),
-											 base::filesystem::IsSymbolicLinkDirectory(source_path.ToString()));
+											 is_directory);
 	}
 	catch (std::exception const &e)
 	{
@@ -489,71 +423,11 @@ void base::filesystem::CopyRegularFile(base::Path const &source_path,
 									   base::Path const &destination_path,
 									   base::filesystem::OverwriteOption overwrite_method)
 {
+	msys::MetadataCache::InvalidationGuard invalidation_guard{destination_path};
+
 	try
 	{
-		if (base::filesystem::IsSymbolicLink(source_path))
-		{
-			throw std::runtime_error{CODE_POS_STR + source_path.ToString() + " 是一个符号链接，不是常规文件。"};
-		}
-
-		if (!base::filesystem::IsRegularFile(source_path))
-		{
-			throw std::runtime_error{CODE_POS_STR + source_path.ToString() + " 不是一个常规文件。"};
-		}
-
-		if (destination_path.IsRootPath())
-		{
-			throw std::runtime_error{CODE_POS_STR + "无法将源路径移动为根路径。"};
-		}
-
-		std::filesystem::copy_options options = std::filesystem::copy_options::copy_symlinks;
-
-		if (!base::filesystem::Exists(destination_path))
-		{
-			// 目标路径不存在，直接复制。
-			base::filesystem::EnsureDirectory(destination_path.ParentPath());
-
-			// 拷贝单个文件。
-			std::filesystem::copy(base::filesystem::ToWindowsLongPathString(source_path),
-								  base::filesystem::ToWindowsLongPathString(destination_path),
-								  options);
-
-			return;
-		}
-
-		// 目标路径存在
-		if (overwrite_method == base::filesystem::OverwriteOption::Skip)
-		{
-			return;
-		}
-
-		bool should_overwrite = false;
-
-		if (overwrite_method == base::filesystem::OverwriteOption::Overwrite)
-		{
-			should_overwrite = true;
-		}
-
-		// 如果更新则覆盖
-		std::filesystem::directory_entry src_entry{base::filesystem::ToWindowsLongPathString(source_path)};
-		std::filesystem::directory_entry dst_entry{base::filesystem::ToWindowsLongPathString(destination_path)};
-
-		if (src_entry.last_write_time() > dst_entry.last_write_time())
-		{
-			should_overwrite = true;
-		}
-
-		if (!should_overwrite)
-		{
-			return;
-		}
-
-		// 需要覆盖
-		base::filesystem::Remove(destination_path);
-
-		std::filesystem::copy(base::filesystem::ToWindowsLongPathString(source_path),
-							  base::filesystem::ToWindowsLongPathString(destination_path),
-							  options);
+		msys::CopyRegularFile(source_path, destination_path, overwrite_method);
 	}
 	catch (std::exception const &e)
 	{
@@ -569,9 +443,13 @@ void base::filesystem::Copy(base::Path const &source_path,
 							base::Path const &destination_path,
 							base::filesystem::OverwriteOption overwrite_method)
 {
+	msys::MetadataCache::InvalidationGuard invalidation_guard{destination_path};
+
 	try
 	{
-		if (!base::filesystem::Exists(source_path))
+		msys::FileStatus source_status = msys::Status(source_path, false);
+
+		if (!source_status.Exists())
 		{
 			std::string message = CODE_POS_STR;
 			message += std::format("源路径 {} 不存在。", source_path.ToString());
@@ -584,7 +462,7 @@ void base::filesystem::Copy(base::Path const &source_path,
 		}
 
 		// 执行到这里说明源路径存在
-		if (base::filesystem::IsSymbolicLink(source_path))
+		if (source_status.type == msys::FileType::SymbolicLink)
 		{
 			base::filesystem::CopySymbolicLink(source_path,
 											   destination_path,
@@ -593,31 +471,22 @@ void base::filesystem::Copy(base::Path const &source_path,
 			return;
 		}
 
-		if (base::filesystem::IsRegularFile(source_path))
+		if (source_status.type == msys::FileType::RegularFile)
 		{
 			base::filesystem::CopyRegularFile(source_path, destination_path, overwrite_method);
 			return;
 		}
 
-		if (base::filesystem::IsDirectory(source_path))
+		if (source_status.type == msys::FileType::Directory ||
+			source_status.type == msys::FileType::Junction)
 		{
-			// 执行到这里说明源路径是目录
-			base::filesystem::EnsureDirectory(destination_path);
-
-			// 开始递归复制
-			for (auto entry : std::filesystem::recursive_directory_iterator{ToWindowsLongPathString(source_path)})
-			{
-				base::Path relative_path{base::filesystem::WindowsLongPathStringToPath(entry.path().string())};
-				relative_path.RemoveBasePath(base::filesystem::ToAbsolutePath(source_path));
-
-				base::Path src_path = source_path + relative_path;
-				base::Path dst_path = destination_path + relative_path;
-
-				base::filesystem::CopySingleLayer(src_path,
-												  dst_path,
-												  overwrite_method);
-			}
+			// 执行到这里说明源路径是目录。目录交接点拷贝它指向的目录中的内容。
+			msys::CopyOptions options{};
+			options.overwrite_method = overwrite_method;
 
+			// 遍历和拷贝并行进行。
+			msys::CopyEngine engine{options};
+			engine.CopyDirectory(source_path, destination_path);
 			return;
 		}
 
@@ -641,103 +510,26 @@ void base::filesystem::Move(base::Path const &source_path,
 							base::Path const &destination_path,
 							base::filesystem::OverwriteOption overwrite_method)
 {
-	if (!base::filesystem::Exists(source_path))
-	{
-		std::string message = CODE_POS_STR;
-		message += std::format("源路径 {} 不存在。", source_path.ToString());
-		throw std::runtime_error{message};
-	}
-
-	if (destination_path.IsRootPath())
-	{
-		throw std::runtime_error{CODE_POS_STR + "无法将源路径移动为根路径。"};
-	}
-
-	if (!base::filesystem::Exists(destination_path))
-	{
-		// 目标路径不存在，直接移动
+	msys::MetadataCache::InvalidationGuard source_invalidation_guard{source_path};
+	msys::MetadataCache::InvalidationGuard destination_invalidation_guard{destination_path};
 
-		// 先确保父目录存在，否则会抛出异常
-		base::filesystem::EnsureDirectory(destination_path.ParentPath());
-		std::error_code error_code{};
-
-		std::filesystem::rename(ToWindowsLongPathString(source_path),
-								ToWindowsLongPathString(destination_path),
-								error_code);
-
-		if (error_code.value() != 0)
-		{
-			std::string message = CODE_POS_STR;
-
-			message += std::format("移动失败。错误代码：{}，错误消息：{}",
-								   error_code.value(),
-								   error_code.message());
-
-			throw std::runtime_error{message};
-		}
-
-		return;
-	}
-
-	// 目标路径存在
-	if (overwrite_method == base::filesystem::OverwriteOption::Skip)
-	{
-		return;
-	}
-
-	if (overwrite_method == base::filesystem::OverwriteOption::Overwrite)
+	try
 	{
-		// 直接覆盖目标文件
-		base::filesystem::Remove(destination_path);
-		std::error_code error_code{};
-
-		std::filesystem::rename(ToWindowsLongPathString(source_path),
-								ToWindowsLongPathString(destination_path),
-								error_code);
-
-		if (error_code.value() != 0)
-		{
-			std::string message = CODE_POS_STR;
-
-			message += std::format("移动失败。错误代码：{}，错误消息：{}",
-								   error_code.value(),
-								   error_code.message());
+		msys::CopyOptions options{};
+		options.overwrite_method = overwrite_method;
 
-			throw std::runtime_error{message};
-		}
-
-		return;
+		// 同一个卷内重命名，跨卷时拷贝再删除。Update 模式下合并目录。
+		msys::CopyEngine engine{options};
+		engine.Move(source_path, destination_path);
 	}
-
-	// 如果更新则覆盖
-	std::filesystem::directory_entry src_entry{ToWindowsLongPathString(source_path)};
-	std::filesystem::directory_entry dst_entry{ToWindowsLongPathString(destination_path)};
-
-	if (src_entry.last_write_time() <= dst_entry.last_write_time())
+	catch (std::exception const &e)
 	{
-		return;
+		throw std::runtime_error{CODE_POS_STR + e.what()};
 	}
-
-	// 需要更新
-	base::filesystem::Remove(destination_path);
-	std::error_code error_code{};
-
-	std::filesystem::rename(ToWindowsLongPathString(source_path),
-							ToWindowsLongPathString(destination_path),
-							error_code);
-
-	if (error_code.value() != 0)
+	catch (...)
 	{
-		std::string message = CODE_POS_STR;
-
-		message += std::format("移动失败。错误代码：{}，错误消息：{}",
-							   error_code.value(),
-							   error_code.message());
-
-		throw std::runtime_error{message};
+		throw std::runtime_error{CODE_POS_STR + "未知的异常。"};
 	}
-
-	return;
 }
 
 /* #endregion */
@@ -758,38 +550,25 @@ std::shared_ptr<base::IEnumerator<base::filesystem::DirectoryEntry const>> base:
 
 void base::filesystem::RemoveReadOnlyAttribute(base::Path const &path)
 {
+	msys::MetadataCache::InvalidationGuard invalidation_guard{path};
+
 	try
 	{
-		if (base::filesystem::IsSymbolicLink(path))
+		msys::FileStatus status = msys::Status(path, false);
+
+		if (status.type == msys::FileType::SymbolicLink)
 		{
 			return;
 		}
 
+		if (status.type != msys::FileType::RegularFile &&
+			status.type != msys::FileType::Directory &&
+			status.type != msys::FileType::Junction)
 		{
-			bool is_valid_dir_item = false;
-
-			if (base::filesystem::IsRegularFile(path))
-			{
-				is_valid_dir_item = true;
-			}
-
-			if (base::filesystem::IsDirectory(path))
-			{
-				is_valid_dir_item = true;
-			}
-
-			if (!is_valid_dir_item)
-			{
-				throw std::runtime_error{CODE_POS_STR + path.ToString() + " 是未知的目录项类型。"};
-			}
+			throw std::runtime_error{CODE_POS_STR + path.ToString() + " 是未知的目录项类型。"};
 		}
 
-		DWORD attrs = GetFileAttributesA(base::filesystem::ToWindowsLongPathString(path).c_str());
-
-		if (attrs == INVALID_FILE_ATTRIBUTES)
-		{
-			throw std::runtime_error{CODE_POS_STR + "调用 GetFileAttributesA 获取文件属性失败。"};
-		}
+		DWORD attrs = status.attributes;
 
 		if (!(attrs & FILE_ATTRIBUTE_READONLY))
 		{
@@ -0,0 +1,35 @@
+#include "win32_error.h"
+#include <format>
+
+std::string msys::GetErrorMessage(DWORD error)
+{
+	char buffer[512]{};
+
+	DWORD length = FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS | FORMAT_MESSAGE_MAX_WIDTH_MASK,
+								  nullptr,
+								  error,
+								  0,
+								  buffer,
+								  sizeof(buffer),
+								  nullptr);
+
+	if (length == 0)
+	{
+		return "未知的错误。";
+	}
+
+	std::string message{buffer, length};
+
+	// 去掉末尾的空白。
+	while (!message.empty() && (message.back() == ' ' || message.back() == '\r' || message.back() == '\n'))
+	{
+		message.pop_back();
+	}
+
+	return message;
+}
+
+std::string msys::FormatError(DWORD error)
+{
+	return std::format("错误代码：{}，错误消息：{}", error, GetErrorMessage(error));
+}
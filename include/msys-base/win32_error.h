@@ -0,0 +1,25 @@
+#pragma once
+#include "msys-base/windows_api.h"
+#include <string>
+
+namespace msys
+{
+	///
+	/// @brief 获取 Windows 错误代码对应的错误消息。
+	///
+	/// @param error GetLastError 的返回值。
+	///
+	/// @return
+	///
+	std::string GetErrorMessage(DWORD error);
+
+	///
+	/// @brief 将错误代码格式化为 "错误代码：xx，错误消息：xx" 的形式。
+	///
+	/// @param error GetLastError 的返回值。
+	///
+	/// @return
+	///
+	std::string FormatError(DWORD error);
+
+} // namespace msys
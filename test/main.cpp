@@ -1,8 +1,143 @@
 #include "base/filesystem/filesystem.h"
 #include "base/filesystem/Path.h"
 #include "base/string/define.h"
+#include "msys-base/BulkOperationContext.h"
+#include "msys-base/CancellationToken.h"
+#include "msys-base/CopyEngine.h"
+#include "msys-base/DirectoryBatchEnumerator.h"
+#include "msys-base/DirectoryEntryEnumerator.h"
+#include "msys-base/file_copy.h"
+#include "msys-base/FileStatus.h"
+#include "msys-base/FileStream.h"
+#include "msys-base/MemoryMappedFileStream.h"
+#include "msys-base/MetadataCache.h"
+#include "msys-base/OpenOptions.h"
+#include "msys-base/ParallelDirectoryWalker.h"
+#include "msys-base/RemoveEngine.h"
+#include "msys-base/TrashReclaimer.h"
+#include "msys-base/Watcher.h"
 #include "msys-base/windows_api.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	///
+	/// @brief 生成确定的测试数据。不同的 seed 得到不同的内容。
+	///
+	std::vector<uint8_t> CreatePattern(int64_t size, uint32_t seed)
+	{
+		std::vector<uint8_t> data(static_cast<size_t>(size));
+		uint32_t value = seed * 2654435761u + 1;
+
+		for (uint8_t &byte : data)
+		{
+			value = value * 1103515245u + 12345u;
+			byte = static_cast<uint8_t>(value >> 16);
+		}
+
+		return data;
+	}
+
+	///
+	/// @brief 条件不成立时抛出异常，由测试块的 catch 打印。
+	///
+	void Check(bool condition, std::string const &message)
+	{
+		if (!condition)
+		{
+			throw std::runtime_error{message};
+		}
+	}
+
+	void WriteAll(base::Path const &path, std::vector<uint8_t> const &data)
+	{
+		std::shared_ptr<base::FileStream> fs = base::FileStream::CreateNewAnyway(path);
+		fs->Write(base::ReadOnlySpan(data.data(), static_cast<int64_t>(data.size())));
+		fs->Close();
+	}
+
+	///
+	/// @brief 从流的当前位置读取 count 个字节，直到读满或到达末尾。
+	///
+	/// @return 读取到的字节数。
+	///
+	int64_t ReadFully(base::FileStream &fs, uint8_t *buffer, int64_t count)
+	{
+		int64_t have_read = 0;
+
+		while (have_read < count)
+		{
+			int64_t once_read = fs.Read(base::Span(buffer + have_read, count - have_read));
+
+			if (once_read == 0)
+			{
+				break;
+			}
+
+			have_read += once_read;
+		}
+
+		return have_read;
+	}
+
+	std::vector<uint8_t> ReadAll(base::Path const &path)
+	{
+		std::shared_ptr<base::FileStream> fs = base::FileStream::OpenReadOnly(path);
+		std::vector<uint8_t> data(static_cast<size_t>(fs->Length()));
+		data.resize(static_cast<size_t>(ReadFully(*fs, data.data(), static_cast<int64_t>(data.size()))));
+		return data;
+	}
+
+	char const *ToString(msys::CopyStrategy strategy)
+	{
+		switch (strategy)
+		{
+		case msys::CopyStrategy::BlockClone:
+			{
+				return "BlockClone";
+			}
+		case msys::CopyStrategy::Sparse:
+			{
+				return "Sparse";
+			}
+		case msys::CopyStrategy::Kernel:
+			{
+				return "Kernel";
+			}
+		case msys::CopyStrategy::Buffered:
+			{
+				return "Buffered";
+			}
+		case msys::CopyStrategy::Delta:
+			{
+				return "Delta";
+			}
+		default:
+			{
+				return "Unknown";
+			}
+		}
+	}
+
+} // namespace
 
 int main()
 {
@@ -137,5 +272,1900 @@ int main()
 		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
 	}
 
+	// 测试块。缓冲的 FileStream: 写后读、定位后部分读写、SetLength.
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path path = "file_stream_round_trip.bin";
+		std::vector<uint8_t> expected = CreatePattern(200 * 1000, 1);
+
+		{
+			std::shared_ptr<base::FileStream> fs = base::FileStream::CreateNewAnyway(path);
+
+			// 用不整齐的小块写入，跨越用户态缓冲区的边界。
+			for (int64_t offset = 0; offset < static_cast<int64_t>(expected.size()); offset += 777)
+			{
+				int64_t count = std::min<int64_t>(777, static_cast<int64_t>(expected.size()) - offset);
+				fs->Write(base::ReadOnlySpan(expected.data() + offset, count));
+			}
+
+			// 写后立即读，要看到还在缓冲区中的数据。
+			std::vector<uint8_t> actual(expected.size());
+			fs->SetPosition(0);
+			Check(ReadFully(*fs, actual.data(), static_cast<int64_t>(actual.size())) == static_cast<int64_t>(actual.size()) &&
+					  actual == expected,
+				  CODE_POS_STR + "写后读到的内容不一致。");
+
+			// 在中间改写一小段，再从它前面开始读，读取跨越新旧数据。
+			std::vector<uint8_t> patch = CreatePattern(50, 2);
+			fs->SetPosition(100000);
+			fs->Write(base::ReadOnlySpan(patch.data(), static_cast<int64_t>(patch.size())));
+			std::copy(patch.begin(), patch.end(), expected.begin() + 100000);
+			Check(fs->Position() == 100050, CODE_POS_STR + "写入后的位置不对。");
+
+			std::vector<uint8_t> partial(100);
+			fs->SetPosition(99990);
+			Check(ReadFully(*fs, partial.data(), 100) == 100 &&
+					  std::equal(partial.begin(), partial.end(), expected.begin() + 99990),
+				  CODE_POS_STR + "改写后部分读取的内容不一致。");
+
+			// 截短后末尾之后读不到数据，再加长时新的部分是 0.
+			fs->SetLength(150000);
+			expected.resize(150000);
+			Check(fs->Length() == 150000, CODE_POS_STR + "截短后的长度不对。");
+
+			fs->SetPosition(150000);
+			Check(fs->Read(base::Span(partial.data(), 100)) == 0, CODE_POS_STR + "在文件末尾之后读到了数据。");
+
+			fs->SetLength(160000);
+			expected.resize(160000, 0);
+		}
+
+		Check(ReadAll(path) == expected, CODE_POS_STR + "关闭后重新读到的内容不一致。");
+		base::filesystem::Remove(path);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。内存映射流的整体映射和窗口映射，视图跨越窗口边界时要重新映射。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path path = "memory_mapped_file_stream.bin";
+
+		// 比窗口大若干倍，且不是分配粒度的整数倍。
+		std::vector<uint8_t> expected = CreatePattern(1024 * 1024 + 12345, 1);
+		WriteAll(path, expected);
+
+		auto view_equals = [&expected](base::ReadOnlySpan const &view, int64_t offset)
+		{
+			return std::equal(view.Buffer(), view.Buffer() + view.Size(), expected.begin() + offset);
+		};
+
+		auto read_all = [](base::Stream &stream)
+		{
+			std::vector<uint8_t> data(static_cast<size_t>(stream.Length()));
+			int64_t have_read = 0;
+
+			while (have_read < static_cast<int64_t>(data.size()))
+			{
+				// 每次读取的大小与窗口不对齐。
+				int64_t count = std::min<int64_t>(static_cast<int64_t>(data.size()) - have_read, 50000);
+				int64_t once_read = stream.Read(base::Span(data.data() + have_read, count));
+
+				if (once_read == 0)
+				{
+					break;
+				}
+
+				have_read += once_read;
+			}
+
+			data.resize(static_cast<size_t>(have_read));
+			return data;
+		};
+
+		{
+			std::shared_ptr<base::MemoryMappedFileStream> stream = base::MemoryMappedFileStream::Open(path);
+			Check(stream->Length() == static_cast<int64_t>(expected.size()), CODE_POS_STR + "长度不一致。");
+
+			// 整体映射时，先拿到的视图在后面的 View 之后仍然有效。
+			base::ReadOnlySpan head = stream->View(0, 4096);
+			base::ReadOnlySpan tail = stream->View(stream->Length() - 4096, 4096);
+			Check(view_equals(head, 0) && view_equals(tail, stream->Length() - 4096), CODE_POS_STR + "视图的内容不一致。");
+
+			Check(read_all(*stream) == expected, CODE_POS_STR + "读到的内容不一致。");
+		}
+
+		{
+			std::shared_ptr<base::MemoryMappedFileStream> stream = base::MemoryMappedFileStream::OpenWindowed(path, 64 * 1024);
+
+			// 从后往前，再跨越窗口边界取视图，每次都要移动窗口。
+			std::vector<int64_t> offsets{
+				static_cast<int64_t>(expected.size()) - 100,
+				500000,
+				65536 - 10,
+				3 * 65536 - 1000,
+				0,
+			};
+
+			for (int64_t offset : offsets)
+			{
+				int64_t size = std::min<int64_t>(static_cast<int64_t>(expected.size()) - offset, 3000);
+				Check(view_equals(stream->View(offset, size), offset),
+					  CODE_POS_STR + std::format("偏移量 {} 处的视图内容不一致。", offset));
+			}
+
+			// 比窗口大的视图也能拿到。
+			Check(view_equals(stream->View(1000, 200000), 1000), CODE_POS_STR + "比窗口大的视图内容不一致。");
+
+			stream->SetPosition(0);
+			Check(read_all(*stream) == expected, CODE_POS_STR + "窗口映射读到的内容不一致。");
+
+			bool thrown = false;
+
+			try
+			{
+				stream->View(static_cast<int64_t>(expected.size()) - 10, 11);
+			}
+			catch (std::out_of_range const &)
+			{
+				thrown = true;
+			}
+
+			Check(thrown, CODE_POS_STR + "超出文件范围的视图没有抛出异常。");
+		}
+
+		base::filesystem::Remove(path);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。分散读、聚集写的往返。覆盖在用户态缓冲区中拼接、拼接到临时内存、逐个写入三种情况。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path path = "file_stream_vectored.bin";
+
+		// 每组 span 的大小。第 1 组总大小小于用户态缓冲区，第 2 组大于缓冲区但不超过 1 MiB,
+		// 第 3 组超过 1 MiB.
+		std::vector<std::vector<int64_t>> groups{
+			{1, 100, 7, 3000},
+			{100000, 3, 200000, 50000},
+			{700000, 1, 900000},
+		};
+
+		std::vector<uint8_t> expected;
+
+		{
+			std::shared_ptr<base::FileStream> fs = base::FileStream::CreateNewAnyway(path);
+			uint32_t seed = 100;
+
+			for (std::vector<int64_t> const &sizes : groups)
+			{
+				std::vector<std::vector<uint8_t>> buffers;
+				std::vector<base::ReadOnlySpan> spans;
+
+				for (int64_t size : sizes)
+				{
+					buffers.push_back(CreatePattern(size, seed++));
+				}
+
+				for (std::vector<uint8_t> const &buffer : buffers)
+				{
+					spans.push_back(base::ReadOnlySpan(buffer.data(), static_cast<int64_t>(buffer.size())));
+					expected.insert(expected.end(), buffer.begin(), buffer.end());
+				}
+
+				fs->WriteV(spans);
+			}
+
+			Check(fs->Position() == static_cast<int64_t>(expected.size()), CODE_POS_STR + "聚集写后流的位置不对。");
+		}
+
+		Check(ReadAll(path) == expected, CODE_POS_STR + "聚集写的内容不一致。");
+
+		{
+			std::shared_ptr<base::FileStream> fs = base::FileStream::OpenReadOnly(path);
+
+			// 最后一个 span 超出文件末尾，只能读到一部分。
+			std::vector<int64_t> sizes{5, 4096, 1, 1000000};
+			int64_t tail_size = static_cast<int64_t>(expected.size()) - 5 - 4096 - 1;
+			sizes.push_back(tail_size - 1000000 + 123);
+
+			std::vector<uint8_t> actual(expected.size() + 123);
+			std::vector<base::Span> spans;
+			int64_t offset = 0;
+
+			for (int64_t size : sizes)
+			{
+				spans.push_back(base::Span(actual.data() + offset, size));
+				offset += size;
+			}
+
+			// 后面再放一个 span, 前一个没有填满，不应该再读。
+			std::vector<uint8_t> after(10, 0xcc);
+			spans.push_back(base::Span(after.data(), static_cast<int64_t>(after.size())));
+
+			int64_t have_read = fs->ReadV(spans);
+			Check(have_read == static_cast<int64_t>(expected.size()), CODE_POS_STR + "分散读读到的总字节数不对。");
+
+			actual.resize(expected.size());
+			Check(actual == expected, CODE_POS_STR + "分散读的内容不一致。");
+			Check(after == std::vector<uint8_t>(10, 0xcc), CODE_POS_STR + "到达文件末尾后仍然读取了后面的 span.");
+		}
+
+		base::filesystem::Remove(path);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。异步读取进行中时调用 AdviseAccessPattern 替换句柄，包括在回调中调用。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path path = "file_stream_advise.bin";
+		int64_t const block_size = 64 * 1024;
+		int64_t const block_count = 64;
+		std::vector<uint8_t> expected = CreatePattern(block_size * block_count, 8);
+		WriteAll(path, expected);
+
+		{
+			std::shared_ptr<base::FileStream> fs = base::FileStream::OpenReadOnly(path);
+			std::vector<uint8_t> actual(expected.size());
+
+			// 另一个线程不停地切换访问模式，每次都会重新打开句柄。
+			std::atomic_bool stop = false;
+
+			std::thread advisor{
+				[&]()
+				{
+					base::FileAdvice advices[] = {
+						base::FileAdvice::Sequential,
+						base::FileAdvice::Random,
+						base::FileAdvice::Normal,
+					};
+
+					for (int64_t i = 0; !stop; i++)
+					{
+						fs->AdviseAccessPattern(advices[i % 3], 0, 0);
+					}
+				},
+			};
+
+			std::vector<std::future<int64_t>> reads;
+
+			for (int64_t round = 0; round < 4; round++)
+			{
+				for (int64_t i = 0; i < block_count; i++)
+				{
+					reads.push_back(fs->ReadAsync(i * block_size,
+												  base::Span(actual.data() + i * block_size, block_size)));
+				}
+			}
+
+			int64_t total = 0;
+
+			for (std::future<int64_t> &read : reads)
+			{
+				total += read.get();
+			}
+
+			stop = true;
+			advisor.join();
+
+			Check(total == static_cast<int64_t>(expected.size()) * 4, CODE_POS_STR + "读到的字节数不对。");
+			Check(actual == expected, CODE_POS_STR + "切换访问模式期间读到的内容不一致。");
+
+			// 回调中可以调用 AdviseAccessPattern. 死锁的话会卡在 get 上。
+			std::vector<uint8_t> block(block_size);
+			std::promise<int64_t> promise;
+			std::future<int64_t> future = promise.get_future();
+
+			fs->ReadAsync(0,
+						  base::Span(block.data(), block_size),
+						  [&](int64_t bytes_transferred, std::exception_ptr exception)
+						  {
+							  try
+							  {
+								  fs->AdviseAccessPattern(base::FileAdvice::Random, 0, 0);
+
+								  if (exception != nullptr)
+								  {
+									  std::rethrow_exception(exception);
+								  }
+
+								  promise.set_value(bytes_transferred);
+							  }
+							  catch (...)
+							  {
+								  promise.set_exception(std::current_exception());
+							  }
+						  });
+
+			Check(future.get() == block_size &&
+					  std::equal(block.begin(), block.end(), expected.begin()),
+				  CODE_POS_STR + "回调读到的内容不一致。");
+		}
+
+		base::filesystem::Remove(path);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。无缓冲模式下不按扇区对齐的读写。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path path = "file_stream_unbuffered.bin";
+		std::vector<uint8_t> expected = CreatePattern(10000, 3);
+
+		{
+			base::OpenOptions options{};
+			options.access = base::FileAccess::ReadWrite;
+			options.disposition = base::FileCreateDisposition::CreateAlways;
+			options.no_buffering = true;
+
+			std::shared_ptr<base::FileStream> fs = base::FileStream::Open(path, options);
+			fs->Write(base::ReadOnlySpan(expected.data(), static_cast<int64_t>(expected.size())));
+
+			// 改写的区间不按扇区对齐，要先读出所在的扇区，改好后再写回。
+			std::vector<uint8_t> patch = CreatePattern(100, 4);
+			fs->SetPosition(1234);
+			fs->Write(base::ReadOnlySpan(patch.data(), static_cast<int64_t>(patch.size())));
+			std::copy(patch.begin(), patch.end(), expected.begin() + 1234);
+
+			std::vector<uint8_t> actual(expected.size());
+			fs->SetPosition(0);
+			Check(ReadFully(*fs, actual.data(), static_cast<int64_t>(actual.size())) == static_cast<int64_t>(actual.size()) &&
+					  actual == expected,
+				  CODE_POS_STR + "读到的内容不一致。");
+		}
+
+		// 按扇区写入的末尾部分在关闭时截掉，长度要与写入的一致。
+		Check(ReadAll(path) == expected, CODE_POS_STR + "关闭后重新读到的内容不一致。");
+		base::filesystem::Remove(path);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。预留空间。只预留时长度不变，不保持长度时扩展出来的部分读出 0. 缓冲区中还没写入的数据不能丢。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path path = "file_stream_preallocate.bin";
+		int64_t const reserved = 8 * 1024 * 1024;
+		std::vector<uint8_t> head = CreatePattern(1000, 9);
+		std::vector<uint8_t> body = CreatePattern(3 * 1024 * 1024, 10);
+
+		{
+			std::shared_ptr<base::FileStream> fs = base::FileStream::CreateNewAnyway(path);
+
+			// 小于用户态缓冲区，预留前还在缓冲区中。
+			fs->Write(base::ReadOnlySpan(head.data(), static_cast<int64_t>(head.size())));
+			fs->Preallocate(reserved);
+			Check(fs->Length() == static_cast<int64_t>(head.size()), CODE_POS_STR + "只预留空间时文件长度变了。");
+
+			fs->Write(base::ReadOnlySpan(body.data(), static_cast<int64_t>(body.size())));
+			Check(fs->Length() == static_cast<int64_t>(head.size() + body.size()), CODE_POS_STR + "在预留的空间中写入后长度不对。");
+
+			// 比当前长度小，不做任何事，也不会截断。
+			fs->Preallocate(10);
+			Check(fs->Length() == static_cast<int64_t>(head.size() + body.size()), CODE_POS_STR + "往小了预留时截断了文件。");
+		}
+
+		std::vector<uint8_t> expected = head;
+		expected.insert(expected.end(), body.begin(), body.end());
+		Check(ReadAll(path) == expected, CODE_POS_STR + "预留空间后写入的内容不一致。");
+
+		{
+			std::shared_ptr<base::FileStream> fs = base::FileStream::OpenExisting(path);
+
+			fs->Preallocate(reserved, false);
+			Check(fs->Length() == reserved, CODE_POS_STR + "不保持长度时文件长度没有设置为预留的大小。");
+
+			// 扩展出来的部分读出 0.
+			std::vector<uint8_t> tail(1000, 0xcc);
+			fs->SetPosition(reserved - static_cast<int64_t>(tail.size()));
+			Check(ReadFully(*fs, tail.data(), static_cast<int64_t>(tail.size())) == static_cast<int64_t>(tail.size()) &&
+					  tail == std::vector<uint8_t>(tail.size(), 0),
+				  CODE_POS_STR + "扩展出来的部分不是 0.");
+		}
+
+		std::vector<uint8_t> actual = ReadAll(path);
+		Check(actual.size() == static_cast<size_t>(reserved) &&
+				  std::equal(expected.begin(), expected.end(), actual.begin()),
+			  CODE_POS_STR + "不保持长度预留后原有的内容变了。");
+
+		base::filesystem::Remove(path);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。多个线程同时对同一个流调用 ReadAt 和 WriteAt.
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path path = "file_stream_positional.bin";
+		int64_t const region_size = 256 * 1024;
+		int64_t const thread_count = 4;
+		std::vector<uint8_t> expected = CreatePattern(region_size * thread_count, 5);
+		std::vector<uint8_t> actual(expected.size());
+
+		{
+			std::shared_ptr<base::FileStream> fs = base::FileStream::CreateNewAnyway(path);
+			std::vector<std::future<void>> writes;
+
+			for (int64_t i = 0; i < thread_count; i++)
+			{
+				writes.push_back(std::async(std::launch::async,
+											[&, i]()
+											{
+												fs->WriteAt(i * region_size,
+															base::ReadOnlySpan(expected.data() + i * region_size, region_size));
+											}));
+			}
+
+			for (std::future<void> &write : writes)
+			{
+				write.get();
+			}
+
+			std::vector<std::future<int64_t>> reads;
+
+			for (int64_t i = 0; i < thread_count; i++)
+			{
+				reads.push_back(std::async(std::launch::async,
+										   [&, i]()
+										   {
+											   return fs->ReadAt(i * region_size,
+																 base::Span(actual.data() + i * region_size, region_size));
+										   }));
+			}
+
+			for (std::future<int64_t> &read : reads)
+			{
+				Check(read.get() == region_size, CODE_POS_STR + "ReadAt 读到的字节数不对。");
+			}
+
+			Check(fs->Position() == 0, CODE_POS_STR + "定位读写改变了流的位置。");
+		}
+
+		Check(actual == expected, CODE_POS_STR + "ReadAt 读到的内容不一致。");
+		Check(ReadAll(path) == expected, CODE_POS_STR + "关闭后重新读到的内容不一致。");
+		base::filesystem::Remove(path);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。同时发起多个异步读写。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path path = "file_stream_async.bin";
+		int64_t const block_size = 64 * 1024;
+		int64_t const block_count = 16;
+		std::vector<uint8_t> expected = CreatePattern(block_size * block_count, 6);
+		std::vector<uint8_t> actual(expected.size());
+
+		{
+			std::shared_ptr<base::FileStream> fs = base::FileStream::CreateNewAnyway(path);
+			std::vector<std::future<int64_t>> writes;
+
+			for (int64_t i = 0; i < block_count; i++)
+			{
+				writes.push_back(fs->WriteAsync(i * block_size,
+												base::ReadOnlySpan(expected.data() + i * block_size, block_size)));
+			}
+
+			for (std::future<int64_t> &write : writes)
+			{
+				Check(write.get() == block_size, CODE_POS_STR + "异步写入的字节数不对。");
+			}
+
+			std::vector<std::future<int64_t>> reads;
+
+			for (int64_t i = 0; i < block_count; i++)
+			{
+				reads.push_back(fs->ReadAsync(i * block_size,
+											  base::Span(actual.data() + i * block_size, block_size)));
+			}
+
+			for (std::future<int64_t> &read : reads)
+			{
+				Check(read.get() == block_size, CODE_POS_STR + "异步读取的字节数不对。");
+			}
+
+			Check(actual == expected, CODE_POS_STR + "异步读到的内容不一致。");
+
+			// 回调形式。读取超出文件末尾时只得到剩下的字节。
+			std::vector<uint8_t> tail(block_size * 2);
+			std::promise<int64_t> promise;
+			std::future<int64_t> future = promise.get_future();
+
+			fs->ReadAsync((block_count - 1) * block_size,
+						  base::Span(tail.data(), static_cast<int64_t>(tail.size())),
+						  [&promise](int64_t count, std::exception_ptr error)
+						  {
+							  if (error != nullptr)
+							  {
+								  promise.set_exception(error);
+								  return;
+							  }
+
+							  promise.set_value(count);
+						  });
+
+			Check(future.get() == block_size &&
+					  std::equal(tail.begin(), tail.begin() + block_size, expected.end() - block_size),
+				  CODE_POS_STR + "读取到文件末尾时的结果不对。");
+		}
+
+		base::filesystem::Remove(path);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。后台写入模式。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path path = "file_stream_write_behind.bin";
+		std::vector<uint8_t> expected = CreatePattern(3 * 1024 * 1024 + 123, 7);
+
+		{
+			std::shared_ptr<base::FileStream> fs = base::FileStream::CreateNewAnyway(path);
+			fs->EnableWriteBehind(64 * 1024, 4, std::chrono::milliseconds{100});
+
+			// 写入一点数据后停下来，不调用 Flush, 后台线程空闲一段时间后也要把它写入文件。
+			fs->Write(base::ReadOnlySpan(expected.data(), 1000));
+			std::this_thread::sleep_for(std::chrono::milliseconds{1000});
+
+			std::vector<uint8_t> head = ReadAll(path);
+			Check(head.size() == 1000 && std::equal(head.begin(), head.end(), expected.begin()),
+				  CODE_POS_STR + "空闲后数据没有写入文件。");
+
+			// 写入量远大于所有缓冲块，Write 要等缓冲块回收。
+			for (int64_t offset = 1000; offset < static_cast<int64_t>(expected.size()); offset += 4099)
+			{
+				int64_t count = std::min<int64_t>(4099, static_cast<int64_t>(expected.size()) - offset);
+				fs->Write(base::ReadOnlySpan(expected.data() + offset, count));
+			}
+
+			fs->Flush();
+			Check(ReadAll(path) == expected, CODE_POS_STR + "Flush 之后文件的内容不一致。");
+		}
+
+		Check(ReadAll(path) == expected, CODE_POS_STR + "关闭后重新读到的内容不一致。");
+		base::filesystem::Remove(path);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。拷贝普通文件后的内容和元数据。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path root = "file_copy_regular";
+		base::filesystem::Remove(root);
+		base::filesystem::EnsureDirectory(root);
+
+		// 普通文件。能块克隆时用块克隆，否则由 CopyFileExA 拷贝。
+		base::Path source = root + base::Path{"regular.bin"};
+		base::Path destination = root + base::Path{"regular.copy.bin"};
+		std::vector<uint8_t> expected = CreatePattern(3 * 1024 * 1024 + 17, 8);
+		uint32_t const attributes = FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN;
+
+		WriteAll(source, expected);
+		SetFileAttributesA(base::filesystem::ToWindowsLongPathString(source).c_str(), attributes);
+
+		msys::CopyStrategy strategy = msys::CopyFileContent(source, destination);
+		std::cout << "普通文件: " << ToString(strategy) << std::endl;
+
+		msys::FileStatus source_status = msys::Status(source, false);
+		msys::FileStatus destination_status = msys::Status(destination, false);
+		Check(ReadAll(destination) == expected, CODE_POS_STR + "拷贝后的内容不一致。");
+		Check(destination_status.last_write_time == source_status.last_write_time, CODE_POS_STR + "拷贝后的修改时间不一致。");
+		Check((destination_status.attributes & attributes) == attributes, CODE_POS_STR + "拷贝后的属性不一致。");
+
+		base::filesystem::Remove(root);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。拷贝稀疏文件。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path root = "file_copy_sparse";
+		base::filesystem::Remove(root);
+		base::filesystem::EnsureDirectory(root);
+
+		// 稀疏文件。只拷贝已分配的区间，空洞读出来是 0.
+		base::Path source = root + base::Path{"sparse.bin"};
+		base::Path destination = root + base::Path{"sparse.copy.bin"};
+		int64_t const size = 32 * 1024 * 1024;
+		int64_t const data_offset = 16 * 1024 * 1024;
+		std::vector<uint8_t> data = CreatePattern(64 * 1024, 9);
+
+		base::FileStream::CreateNewAnyway(source)->Close();
+
+		{
+			HANDLE h = CreateFileA(base::filesystem::ToWindowsLongPathString(source).c_str(),
+								   GENERIC_READ | GENERIC_WRITE,
+								   0,
+								   nullptr,
+								   OPEN_EXISTING,
+								   0,
+								   nullptr);
+
+			Check(h != INVALID_HANDLE_VALUE, CODE_POS_STR + "打开稀疏文件失败。");
+
+			DWORD returned_size = 0;
+			BOOL call_result = DeviceIoControl(h, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &returned_size, nullptr);
+			CloseHandle(h);
+			Check(call_result, CODE_POS_STR + "设置稀疏属性失败。");
+		}
+
+		{
+			std::shared_ptr<base::FileStream> fs = base::FileStream::OpenExisting(source);
+			fs->SetLength(size);
+			fs->WriteAt(data_offset, base::ReadOnlySpan(data.data(), static_cast<int64_t>(data.size())));
+		}
+
+		std::vector<uint8_t> expected(size, 0);
+		std::copy(data.begin(), data.end(), expected.begin() + data_offset);
+
+		msys::CopyStrategy strategy = msys::CopyFileContent(source, destination);
+		std::cout << "稀疏文件: " << ToString(strategy) << std::endl;
+		Check(ReadAll(destination) == expected, CODE_POS_STR + "拷贝后的内容不一致。");
+
+		if (strategy == msys::CopyStrategy::Sparse)
+		{
+			Check(msys::Status(destination, false).attributes & FILE_ATTRIBUTE_SPARSE_FILE,
+				  CODE_POS_STR + "稀疏拷贝的目标不是稀疏文件。");
+		}
+
+		base::filesystem::Remove(root);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。增量更新已存在的目标文件。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path root = "file_copy_delta";
+		base::filesystem::Remove(root);
+		base::filesystem::EnsureDirectory(root);
+
+		// 增量更新。源文件只改了一个块，不能块克隆时逐块比较，只重写这个块。
+		base::Path source = root + base::Path{"delta.bin"};
+		base::Path destination = root + base::Path{"delta.copy.bin"};
+		std::vector<uint8_t> expected = CreatePattern(64 * 1024 * 1024 + 4096, 10);
+
+		WriteAll(source, expected);
+		msys::CopyFileContent(source, destination);
+
+		// 等一会儿再改，保证源文件的修改时间比目标新。
+		std::this_thread::sleep_for(std::chrono::milliseconds{50});
+
+		std::vector<uint8_t> patch = CreatePattern(4096, 11);
+		base::FileStream::OpenExisting(source)->WriteAt(32 * 1024 * 1024 + 100,
+														 base::ReadOnlySpan(patch.data(), static_cast<int64_t>(patch.size())));
+		std::copy(patch.begin(), patch.end(), expected.begin() + 32 * 1024 * 1024 + 100);
+
+		msys::CopyStrategy strategy = msys::UpdateFileContent(source, destination);
+		std::cout << "增量更新: " << ToString(strategy) << std::endl;
+
+		Check(ReadAll(destination) == expected, CODE_POS_STR + "更新后的内容不一致。");
+		Check(msys::Status(destination, false).last_write_time == msys::Status(source, false).last_write_time,
+			  CODE_POS_STR + "更新后的修改时间不一致。");
+
+		base::filesystem::Remove(root);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。并行拷贝的进度回调、汇总和取消。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path root = "copy_engine_progress";
+		base::Path source = root + base::Path{"source"};
+		base::Path destination = root + base::Path{"destination"};
+		base::filesystem::Remove(root);
+
+		std::vector<base::Path> relative_paths;
+		int64_t total_bytes = 0;
+
+		for (int64_t i = 0; i < 4; i++)
+		{
+			for (int64_t j = 0; j < 20; j++)
+			{
+				base::Path relative_path = base::Path{std::to_string(i)} + base::Path{std::to_string(j) + ".bin"};
+				base::filesystem::EnsureDirectory((source + relative_path).ParentPath());
+
+				std::vector<uint8_t> content = CreatePattern(1000 * (i * 20 + j), static_cast<uint32_t>(i * 20 + j));
+				WriteAll(source + relative_path, content);
+				relative_paths.push_back(relative_path);
+				total_bytes += static_cast<int64_t>(content.size());
+			}
+		}
+
+		// 目标中已经有一个同名文件，Skip 模式下被跳过。
+		base::filesystem::EnsureDirectory(destination + base::Path{"0"});
+		WriteAll(destination + relative_paths[1], CreatePattern(10, 1234));
+
+		{
+			std::vector<msys::CopyProgress> reports;
+
+			msys::CopyOptions options{};
+			options.thread_count = 4;
+			options.progress_interval = std::chrono::milliseconds{0};
+
+			options.progress_sink = [&](msys::CopyProgress const &progress)
+			{
+				// 同一时刻只有一个线程调用，不用加锁。
+				reports.push_back(progress);
+			};
+
+			msys::CopySummary summary = msys::Copy(source, destination, options);
+
+			Check(!reports.empty(), CODE_POS_STR + "没有进度回调。");
+
+			for (size_t i = 1; i < reports.size(); i++)
+			{
+				Check(reports[i].done_files >= reports[i - 1].done_files &&
+						  reports[i].done_bytes >= reports[i - 1].done_bytes,
+					  CODE_POS_STR + "进度倒退了。");
+			}
+
+			msys::CopyProgress const &last = reports.back();
+			Check(last.enumeration_completed &&
+					  last.total_files == static_cast<int64_t>(relative_paths.size()) &&
+					  last.done_files == last.total_files &&
+					  last.total_bytes == total_bytes &&
+					  last.done_bytes == last.total_bytes,
+				  CODE_POS_STR + "最后一次进度回调的文件数或字节数不对。");
+
+			Check(summary.files == static_cast<int64_t>(relative_paths.size()) &&
+					  summary.skipped_count == 1 &&
+					  static_cast<int64_t>(summary.copied_files.size()) == summary.files - 1,
+				  CODE_POS_STR + "汇总的文件数不对。");
+
+			// 被跳过的文件大小是 1000.
+			Check(summary.bytes == total_bytes - 1000, CODE_POS_STR + "汇总的字节数不对。");
+
+			Check(ReadAll(destination + relative_paths[1]) == CreatePattern(10, 1234), CODE_POS_STR + "Skip 模式下覆盖了已有的文件。");
+			Check(ReadAll(destination + relative_paths.back()) == ReadAll(source + relative_paths.back()), CODE_POS_STR + "拷贝的内容不一致。");
+		}
+
+		{
+			base::filesystem::Remove(destination);
+
+			// 第一次进度回调时取消。
+			msys::CopyOptions options{};
+			options.thread_count = 1;
+			options.progress_interval = std::chrono::milliseconds{0};
+			options.cancellation_token = std::shared_ptr<msys::CancellationToken>{new msys::CancellationToken{}};
+
+			options.progress_sink = [&](msys::CopyProgress const &progress)
+			{
+				if (progress.done_files > 0)
+				{
+					options.cancellation_token->Cancel();
+				}
+			};
+
+			bool canceled = false;
+
+			try
+			{
+				msys::Copy(source, destination, options);
+			}
+			catch (msys::OperationCanceledException const &)
+			{
+				canceled = true;
+			}
+
+			Check(canceled, CODE_POS_STR + "取消后应该抛出 msys::OperationCanceledException.");
+
+			// 正在拷贝的文件被删除了，留下的文件都是完整的。
+			int64_t left = 0;
+
+			for (base::Path const &relative_path : relative_paths)
+			{
+				if (base::filesystem::Exists(destination + relative_path))
+				{
+					left++;
+					Check(ReadAll(destination + relative_path) == ReadAll(source + relative_path),
+						  CODE_POS_STR + "取消后留下了不完整的文件。");
+				}
+			}
+
+			Check(left < static_cast<int64_t>(relative_paths.size()), CODE_POS_STR + "取消后仍然拷贝了全部文件。");
+		}
+
+		base::filesystem::Remove(root);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。批量操作上下文。逐级创建目录，缓存已知存在的目录，Scope 嵌套时恢复之前的上下文。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path root = base::filesystem::ToAbsolutePath(base::Path{"bulk_operation_context"});
+		base::filesystem::Remove(root);
+		base::filesystem::EnsureDirectory(root);
+
+		Check(msys::BulkOperationContext::Current() == nullptr, CODE_POS_STR + "没有 Scope 时不应该有生效的上下文。");
+
+		msys::BulkOperationContext context{};
+
+		{
+			msys::BulkOperationContext::Scope scope{context};
+			Check(msys::BulkOperationContext::Current() == &context, CODE_POS_STR + "Scope 没有让上下文生效。");
+
+			{
+				msys::BulkOperationContext inner{};
+				msys::BulkOperationContext::Scope inner_scope{inner};
+				Check(msys::BulkOperationContext::Current() == &inner, CODE_POS_STR + "嵌套的 Scope 没有让上下文生效。");
+			}
+
+			Check(msys::BulkOperationContext::Current() == &context, CODE_POS_STR + "嵌套的 Scope 析构后没有恢复之前的上下文。");
+
+			// 父目录都不存在，要从上往下逐级创建。
+			base::Path deep = root + base::Path{"a/b/c/d"};
+			msys::EnsureDirectory(deep);
+			Check(base::filesystem::IsDirectory(deep), CODE_POS_STR + "没有逐级创建目录。");
+
+			// 缓存不随文件系统更新。删除后再确保一次，上下文认为它还在。
+			base::filesystem::Remove(deep);
+			msys::EnsureDirectory(deep);
+			Check(!base::filesystem::IsDirectory(deep), CODE_POS_STR + "缓存过的目录又被检查了一次。");
+
+			context.Clear();
+			msys::EnsureDirectory(deep);
+			Check(base::filesystem::IsDirectory(deep), CODE_POS_STR + "清空缓存后没有重新创建目录。");
+
+			// 标记为已存在的目录不会被创建。
+			base::Path marked = root + base::Path{"marked"};
+			context.MarkExisting(marked);
+			msys::EnsureDirectory(marked);
+			Check(!base::filesystem::IsDirectory(marked), CODE_POS_STR + "标记为已存在的目录被创建了。");
+
+			// 路径已经是文件。
+			base::Path file = root + base::Path{"file"};
+			WriteAll(file, CreatePattern(10, 11));
+			bool thrown = false;
+
+			try
+			{
+				msys::EnsureDirectory(file);
+			}
+			catch (std::exception const &)
+			{
+				thrown = true;
+			}
+
+			Check(thrown, CODE_POS_STR + "路径是文件时应该抛出异常。");
+		}
+
+		Check(msys::BulkOperationContext::Current() == nullptr, CODE_POS_STR + "Scope 析构后没有恢复。");
+
+		// 没有生效的上下文时直接检查文件系统。
+		base::Path marked = root + base::Path{"marked"};
+		msys::EnsureDirectory(marked);
+		Check(base::filesystem::IsDirectory(marked), CODE_POS_STR + "没有上下文时没有创建目录。");
+
+		// 多个线程共用一个上下文，确保有重叠的目录树。
+		{
+			context.Clear();
+			std::vector<std::thread> threads;
+
+			for (int64_t i = 0; i < 8; i++)
+			{
+				threads.emplace_back(
+					[&context, &root, i]()
+					{
+						msys::BulkOperationContext::Scope scope{context};
+
+						for (int64_t j = 0; j < 50; j++)
+						{
+							msys::EnsureDirectory(root + base::Path{"shared"} +
+												  base::Path{std::to_string(j % 5)} +
+												  base::Path{std::to_string((i + j) % 8)});
+						}
+					});
+			}
+
+			for (std::thread &thread : threads)
+			{
+				thread.join();
+			}
+
+			for (int64_t j = 0; j < 5; j++)
+			{
+				for (int64_t k = 0; k < 8; k++)
+				{
+					base::Path path = root + base::Path{"shared"} + base::Path{std::to_string(j)} + base::Path{std::to_string(k)};
+					Check(base::filesystem::IsDirectory(path), CODE_POS_STR + "多个线程同时创建时漏掉了目录。");
+				}
+			}
+		}
+
+		base::filesystem::Remove(root);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。跨卷移动时合并目录。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		char const *other_volume = std::getenv("MSYS_BASE_TEST_OTHER_VOLUME");
+
+		if (other_volume == nullptr)
+		{
+			std::cout << "跳过。设置环境变量 MSYS_BASE_TEST_OTHER_VOLUME 为另一个卷上的目录后运行。" << std::endl;
+		}
+		else
+		{
+			base::Path source = "move_merge_source";
+			base::Path destination = base::Path{other_volume} + base::Path{"move_merge_destination"};
+			base::filesystem::Remove(source);
+			base::filesystem::Remove(destination);
+
+			// 目标中的条目先创建，源中同名的文件比它新。
+			std::vector<uint8_t> kept_content = CreatePattern(2000, 12);
+			std::vector<uint8_t> old_content = CreatePattern(1000, 13);
+			base::filesystem::EnsureDirectory(destination + base::Path{"a"});
+			WriteAll(destination + base::Path{"a/kept.bin"}, kept_content);
+			WriteAll(destination + base::Path{"a/replaced.bin"}, old_content);
+
+			std::this_thread::sleep_for(std::chrono::milliseconds{50});
+
+			std::vector<uint8_t> new_content = CreatePattern(3000, 14);
+			std::vector<uint8_t> moved_content = CreatePattern(4000, 15);
+			base::filesystem::EnsureDirectory(source + base::Path{"a/b"});
+			WriteAll(source + base::Path{"a/replaced.bin"}, new_content);
+			WriteAll(source + base::Path{"a/b/moved.bin"}, moved_content);
+
+			base::filesystem::Move(source, destination, base::filesystem::OverwriteOption::Update);
+
+			Check(ReadAll(destination + base::Path{"a/kept.bin"}) == kept_content, CODE_POS_STR + "目标中原有的文件被改变了。");
+			Check(ReadAll(destination + base::Path{"a/replaced.bin"}) == new_content, CODE_POS_STR + "较旧的目标文件没有被替换。");
+			Check(ReadAll(destination + base::Path{"a/b/moved.bin"}) == moved_content, CODE_POS_STR + "新的子目录没有移动过去。");
+			Check(!base::filesystem::Exists(source), CODE_POS_STR + "源目录中的条目都已移走，源目录应该被删除。");
+
+			base::filesystem::Remove(destination);
+			std::cout << "通过。" << std::endl;
+		}
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。并行删除目录树，包括只读文件和空目录。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path root = "remove_engine_round_trip";
+		base::filesystem::Remove(root);
+
+		for (int64_t i = 0; i < 4; i++)
+		{
+			for (int64_t j = 0; j < 4; j++)
+			{
+				base::Path directory = root + base::Path{std::to_string(i)} + base::Path{std::to_string(j)};
+				base::filesystem::EnsureDirectory(directory);
+
+				for (int64_t k = 0; k < 8; k++)
+				{
+					WriteAll(directory + base::Path{std::to_string(k)}, CreatePattern(100, static_cast<uint32_t>(k)));
+				}
+			}
+		}
+
+		base::Path read_only = root + base::Path{"read_only.bin"};
+		WriteAll(read_only, CreatePattern(100, 16));
+		SetFileAttributesA(base::filesystem::ToWindowsLongPathString(read_only).c_str(), FILE_ATTRIBUTE_READONLY);
+		base::filesystem::EnsureDirectory(root + base::Path{"empty"});
+
+		msys::RemoveEngine engine{4};
+		engine.RemoveDirectoryTree(root);
+
+		Check(!msys::Status(root, false).Exists(), CODE_POS_STR + "目录树没有被删除。");
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。延迟删除。调用后立刻看不到原路径，Drain 后回收目录中的条目被删除。
+	// Resume 只恢复不属于运行中的进程的条目。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path root = base::filesystem::ToAbsolutePath(base::Path{"trash_reclaimer"});
+		base::Path tree = root + base::Path{"tree"};
+		base::Path file = root + base::Path{"file.bin"};
+		base::filesystem::Remove(root);
+
+		for (int64_t i = 0; i < 10; i++)
+		{
+			for (int64_t j = 0; j < 10; j++)
+			{
+				base::Path path = tree + base::Path{std::to_string(i)} + base::Path{std::to_string(j) + ".bin"};
+				base::filesystem::EnsureDirectory(path.ParentPath());
+				WriteAll(path, CreatePattern(1000, static_cast<uint32_t>(i * 10 + j)));
+			}
+		}
+
+		WriteAll(file, CreatePattern(1000, 12));
+
+		// 回收目录在卷根目录下。
+		std::string root_string = root.ToString();
+		std::string volume_path(root_string.size() + 2, '\0');
+
+		Check(GetVolumePathNameA(root_string.c_str(), volume_path.data(), static_cast<DWORD>(volume_path.size())),
+			  CODE_POS_STR + "获取卷路径失败。");
+
+		volume_path.resize(std::strlen(volume_path.c_str()));
+		base::Path trash = base::Path{volume_path} + base::Path{"msys-base.trash"};
+
+		{
+			msys::TrashReclaimer reclaimer{};
+			reclaimer.RemoveDeferred(tree);
+			reclaimer.RemoveDeferred(file);
+
+			// 不存在的路径直接返回。
+			reclaimer.RemoveDeferred(root + base::Path{"not_exists"});
+
+			Check(!base::filesystem::Exists(tree) && !base::filesystem::Exists(file),
+				  CODE_POS_STR + "延迟删除后仍然能看到原路径。");
+
+			reclaimer.Drain();
+		}
+
+		if (!base::filesystem::IsDirectory(trash))
+		{
+			// 卷根目录不可写，退回到了同步删除。
+			std::cout << "回收目录不可用，跳过 Resume 的检查。" << std::endl;
+		}
+		else
+		{
+			// 名称不是回收器生成的格式，不属于任何进程。
+			base::Path orphan = trash + base::Path{"orphan"};
+			base::filesystem::EnsureDirectory(orphan + base::Path{"sub"});
+			WriteAll(orphan + base::Path{"sub/data.bin"}, CreatePattern(1000, 13));
+
+			// 以本进程的进程号开头，属于运行中的进程，不能被恢复。
+			base::Path owned = trash + base::Path{std::format("{:x}-0-0", static_cast<uint32_t>(GetCurrentProcessId()))};
+			WriteAll(owned, CreatePattern(1000, 14));
+
+			{
+				msys::TrashReclaimer reclaimer{};
+				reclaimer.Resume(root);
+				reclaimer.Drain();
+			}
+
+			Check(!base::filesystem::Exists(orphan), CODE_POS_STR + "Resume 没有恢复删除残留的条目。");
+			Check(base::filesystem::Exists(owned), CODE_POS_STR + "Resume 删除了运行中的进程的条目。");
+			base::filesystem::Remove(owned);
+		}
+
+		base::filesystem::Remove(root);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。元数据缓存。手动失效时子路径一起失效，名称更长的兄弟路径不受影响；本库修改文件系统后
+	// 立即失效；监视的目录树中的变化由通知让缓存失效。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path root = base::filesystem::ToAbsolutePath(base::Path{"metadata_cache"});
+		base::Path dir = root + base::Path{"dir"};
+		base::Path child = dir + base::Path{"child.bin"};
+		base::Path sibling = root + base::Path{"dir2.bin"};
+		base::filesystem::Remove(root);
+		base::filesystem::EnsureDirectory(dir);
+		WriteAll(child, CreatePattern(10, 15));
+		WriteAll(sibling, CreatePattern(10, 16));
+
+		msys::MetadataCache &cache = msys::MetadataCache::Instance();
+
+		// 有效期足够长，测试期间不会因为过期而重新获取。
+		msys::MetadataCacheOptions options{};
+		options.ttl = std::chrono::milliseconds{60000};
+		cache.Enable(options);
+
+		Check(cache.Status(child, false).size == 10 && cache.Status(sibling, false).size == 10,
+			  CODE_POS_STR + "缓存的状态不对。");
+
+		// FileStream 的写入不会让缓存失效，缓存中还是旧的状态。
+		WriteAll(child, CreatePattern(20, 15));
+		WriteAll(sibling, CreatePattern(20, 16));
+		Check(cache.Status(child, false).size == 10, CODE_POS_STR + "没有使用缓存。");
+
+		// dir2.bin 以 dir 开头，但不是 dir 下的路径。
+		cache.Invalidate(dir);
+		Check(cache.Status(child, false).size == 20, CODE_POS_STR + "父目录失效后子路径没有失效。");
+		Check(cache.Status(sibling, false).size == 10, CODE_POS_STR + "名称更长的兄弟路径也失效了。");
+
+		// 本库中修改文件系统的函数返回时缓存已经失效。
+		base::filesystem::Remove(sibling);
+		Check(!cache.Status(sibling, false).Exists() && !base::filesystem::Exists(sibling),
+			  CODE_POS_STR + "删除后缓存中仍然存在。");
+
+		// 监视的目录树中，变化通知让缓存失效。
+		cache.AddWatchRoot(root);
+		Check(cache.Status(child, false).size == 20, CODE_POS_STR + "缓存的状态不对。");
+		WriteAll(child, CreatePattern(30, 15));
+
+		bool invalidated = false;
+
+		for (int64_t i = 0; i < 100 && !invalidated; i++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds{50});
+			invalidated = cache.Status(child, false).size == 30;
+		}
+
+		Check(invalidated, CODE_POS_STR + "监视的目录中的变化没有让缓存失效。");
+
+		// 关闭后直接获取。
+		cache.Disable();
+		Check(!cache.IsEnabled(), CODE_POS_STR + "关闭失败。");
+		WriteAll(child, CreatePattern(40, 15));
+		Check(cache.Status(child, false).size == 40, CODE_POS_STR + "关闭后仍然使用了缓存。");
+
+		base::filesystem::Remove(root);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。监视器合并同一批次中同一路径的变化。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path root = base::filesystem::ToAbsolutePath(base::Path{"watcher_round_trip"});
+		base::filesystem::Remove(root);
+		base::filesystem::EnsureDirectory(root);
+
+		std::promise<std::vector<msys::WatchEvent>> promise;
+		std::future<std::vector<msys::WatchEvent>> future = promise.get_future();
+		std::atomic_bool delivered = false;
+		std::vector<msys::WatchEvent> events;
+
+		msys::WatcherOptions options{};
+		options.coalescing_window = std::chrono::milliseconds{500};
+
+		{
+			msys::Watcher watcher{
+				root,
+				[&](std::vector<msys::WatchEvent> const &batch)
+				{
+					if (!delivered.exchange(true))
+					{
+						promise.set_value(batch);
+					}
+				},
+				options,
+			};
+
+			// 创建后修改合并为创建，创建后删除互相抵消。
+			base::Path created = root + base::Path{"created.bin"};
+			WriteAll(created, CreatePattern(100, 17));
+
+			{
+				std::vector<uint8_t> data = CreatePattern(100, 18);
+				std::shared_ptr<base::FileStream> fs = base::FileStream::OpenExisting(created);
+				fs->SetPosition(100);
+				fs->Write(base::ReadOnlySpan(data.data(), static_cast<int64_t>(data.size())));
+			}
+
+			base::Path temporary = root + base::Path{"temporary.bin"};
+			WriteAll(temporary, CreatePattern(100, 19));
+			base::filesystem::Remove(temporary);
+
+			Check(future.wait_for(std::chrono::seconds{5}) == std::future_status::ready, CODE_POS_STR + "没有收到变化。");
+			events = future.get();
+			watcher.Stop();
+		}
+
+		Check(events.size() == 1, CODE_POS_STR + "批次中应该只有 1 个事件，实际有 " + std::to_string(events.size()) + " 个。");
+		Check(events[0].type == msys::WatchEventType::Created && events[0].path.ToString().ends_with("created.bin"),
+			  CODE_POS_STR + "合并后的事件应该是 created.bin 的创建。");
+
+		base::filesystem::Remove(root);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。在同一个路径上快速交替创建和删除，变化跨越多次读取、多个批次时仍按发生的顺序合并。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path root = base::filesystem::ToAbsolutePath(base::Path{"watcher_order_round_trip"});
+		base::filesystem::Remove(root);
+		base::filesystem::EnsureDirectory(root);
+
+		// deleted.bin 最后不存在，recreated.bin 最后存在。
+		base::Path deleted = root + base::Path{"deleted.bin"};
+		base::Path recreated = root + base::Path{"recreated.bin"};
+		base::Path done = root + base::Path{"done.bin"};
+		std::vector<uint8_t> content = CreatePattern(10, 20);
+		WriteAll(recreated, content);
+
+		std::mutex lock;
+		std::condition_variable condition;
+		std::vector<msys::WatchEvent> events;
+		bool done_seen = false;
+
+		// 窗口很短，让变化分到多个批次中。
+		msys::WatcherOptions options{};
+		options.coalescing_window = std::chrono::milliseconds{20};
+
+		{
+			msys::Watcher watcher{
+				root,
+				[&](std::vector<msys::WatchEvent> const &batch)
+				{
+					std::lock_guard l{lock};
+
+					for (msys::WatchEvent const &event : batch)
+					{
+						events.push_back(event);
+
+						if (event.path.ToString().ends_with("done.bin"))
+						{
+							done_seen = true;
+						}
+					}
+
+					condition.notify_all();
+				},
+				options,
+			};
+
+			// 一次读取最多 64 KiB 的通知，这些变化要分成很多次读取。
+			for (int64_t i = 0; i < 1000; i++)
+			{
+				WriteAll(deleted, content);
+				base::filesystem::Remove(deleted);
+				base::filesystem::Remove(recreated);
+				WriteAll(recreated, content);
+			}
+
+			WriteAll(done, content);
+
+			std::unique_lock l{lock};
+
+			Check(condition.wait_for(l,
+									 std::chrono::seconds{10},
+									 [&]()
+									 {
+										 return done_seen;
+									 }),
+				  CODE_POS_STR + "没有收到 done.bin 的变化。");
+		}
+
+		bool overflowed = std::any_of(events.begin(),
+									  events.end(),
+									  [](msys::WatchEvent const &event)
+									  {
+										  return event.type == msys::WatchEventType::Overflow;
+									  });
+
+		if (overflowed)
+		{
+			// 变化丢失了，无法判断顺序。
+			std::cout << "发生了溢出，跳过检查。" << std::endl;
+		}
+		else
+		{
+			// 按交付的顺序回放，每个路径最后一个事件要与它最后的状态一致。
+			std::optional<msys::WatchEventType> deleted_last;
+			std::optional<msys::WatchEventType> recreated_last;
+
+			for (msys::WatchEvent const &event : events)
+			{
+				std::string path = event.path.ToString();
+
+				if (path.ends_with("recreated.bin"))
+				{
+					recreated_last = event.type;
+				}
+				else if (path.ends_with("deleted.bin"))
+				{
+					deleted_last = event.type;
+				}
+			}
+
+			Check(!deleted_last.has_value() || deleted_last.value() == msys::WatchEventType::Removed,
+				  CODE_POS_STR + "deleted.bin 最后被删除了，最后一个事件却不是删除。");
+
+			Check(recreated_last.has_value() &&
+					  (recreated_last.value() == msys::WatchEventType::Created ||
+					   recreated_last.value() == msys::WatchEventType::Modified),
+				  CODE_POS_STR + "recreated.bin 最后存在，最后一个事件却不是创建或修改。");
+
+			std::cout << "通过。" << std::endl;
+		}
+
+		base::filesystem::Remove(root);
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 测试块。并行遍历目录树的输出顺序和取消。
+	try
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR;
+
+		base::Path root = "parallel_walker_round_trip";
+		base::filesystem::Remove(root);
+
+		for (int64_t i = 0; i < 4; i++)
+		{
+			for (int64_t j = 0; j < 4; j++)
+			{
+				base::Path directory = root + base::Path{std::to_string(i)} + base::Path{std::to_string(j)};
+				base::filesystem::EnsureDirectory(directory);
+
+				for (int64_t k = 0; k < 10; k++)
+				{
+					base::FileStream::CreateNewAnyway(directory + base::Path{std::to_string(k)});
+				}
+			}
+		}
+
+		int64_t const entry_count = 4 + 4 * 4 + 4 * 4 * 10;
+
+		{
+			// 按顺序输出时，每个条目的父目录都是最近输出、还没输出完的那个目录。
+			msys::ParallelDirectoryWalkerOptions options{};
+			options.thread_count = 4;
+			options.depth_first_order = true;
+			options.max_read_ahead_count = 2;
+
+			msys::ParallelDirectoryWalker walker{root, options};
+			std::vector<std::string> directories;
+			int64_t count = 0;
+
+			while (walker.MoveNext())
+			{
+				msys::ParallelWalkEntry const &entry = walker.Current();
+
+				Check(entry.depth <= static_cast<int64_t>(directories.size()),
+					  CODE_POS_STR + entry.path.ToString() + " 在它的父目录之前输出了。");
+
+				directories.resize(static_cast<size_t>(entry.depth));
+
+				if (entry.depth > 0)
+				{
+					Check(entry.path.ParentPath().ToString() == directories.back(),
+						  CODE_POS_STR + entry.path.ToString() + " 没有紧跟在它的父目录之后输出。");
+				}
+
+				if (entry.type == msys::DirectoryEntryType::Directory)
+				{
+					directories.push_back(entry.path.ToString());
+				}
+
+				count++;
+			}
+
+			Check(count == entry_count, CODE_POS_STR + "按顺序输出的条目数不对。");
+		}
+
+		{
+			msys::ParallelDirectoryWalkerOptions options{};
+			options.thread_count = 4;
+
+			msys::ParallelDirectoryWalker walker{root, options};
+			int64_t count = 0;
+
+			while (walker.MoveNext())
+			{
+				count++;
+			}
+
+			Check(count == entry_count, CODE_POS_STR + "不按顺序输出的条目数不对。");
+		}
+
+		{
+			// 队列很小，取消时大部分条目还没读出来。
+			std::shared_ptr<msys::CancellationToken> token{new msys::CancellationToken{}};
+
+			msys::ParallelDirectoryWalkerOptions options{};
+			options.thread_count = 4;
+			options.queue_capacity = 16;
+			options.cancellation_token = token;
+
+			msys::ParallelDirectoryWalker walker{root, options};
+			int64_t count = 0;
+			bool canceled = false;
+
+			try
+			{
+				while (walker.MoveNext())
+				{
+					count++;
+
+					if (count == 10)
+					{
+						token->Cancel();
+					}
+				}
+			}
+			catch (msys::OperationCanceledException const &)
+			{
+				canceled = true;
+			}
+
+			Check(canceled, CODE_POS_STR + "取消后 MoveNext 应该抛出 msys::OperationCanceledException.");
+			Check(count < entry_count, CODE_POS_STR + "取消后仍然输出了所有条目。");
+		}
+
+		base::filesystem::Remove(root);
+		std::cout << "通过。" << std::endl;
+	}
+	catch (std::exception const &e)
+	{
+		std::cerr << CODE_POS_STR << e.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+	}
+
+	// 要读写 100 多万条记录，耗时很长，只在设置了环境变量 MSYS_BASE_BENCHMARK 时运行。
+	if (std::getenv("MSYS_BASE_BENCHMARK") != nullptr)
+	{
+		// 测试块。FileStream 与 std::fstream 小块读取的性能对比。
+		try
+		{
+			std::cout << std::endl;
+			std::cout << "======================================================" << std::endl;
+			std::cout << CODE_POS_STR;
+
+			base::Path path = "file_stream_benchmark.bin";
+			int64_t const record_size = 32;
+			int64_t const record_count = 1024 * 1024;
+			uint8_t record[record_size]{};
+
+			{
+				std::shared_ptr<base::FileStream> fs = base::FileStream::CreateNewAnyway(path);
+				for (int64_t i = 0; i < record_count; i++)
+				{
+					fs->Write(base::ReadOnlySpan(record, record_size));
+				}
+
+				fs->Flush();
+			}
+
+			{
+				// 旧的实现：每次读取后都要 clear, seekg, seekp.
+				auto start = std::chrono::steady_clock::now();
+				std::fstream fs{path.ToString(), std::ios_base::in | std::ios_base::binary};
+
+				for (int64_t i = 0; i < record_count; i++)
+				{
+					fs.read(reinterpret_cast<char *>(record), record_size);
+					int64_t position = fs.tellg();
+					fs.clear();
+					fs.seekg(position);
+					fs.seekp(position);
+				}
+
+				auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+				std::cout << "std::fstream: " << elapsed.count() << "ms" << std::endl;
+			}
+
+			{
+				auto start = std::chrono::steady_clock::now();
+				std::shared_ptr<base::FileStream> fs = base::FileStream::OpenReadOnly(path);
+
+				for (int64_t i = 0; i < record_count; i++)
+				{
+					fs->Read(base::Span(record, record_size));
+				}
+
+				auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+				std::cout << "base::FileStream: " << elapsed.count() << "ms" << std::endl;
+			}
+
+			base::filesystem::Remove(path);
+		}
+		catch (std::exception const &e)
+		{
+			std::cerr << CODE_POS_STR << e.what() << std::endl;
+		}
+		catch (...)
+		{
+			std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+		}
+	}
+	else
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR << "跳过 FileStream 与 std::fstream 的性能对比。设置环境变量 MSYS_BASE_BENCHMARK 后运行。" << std::endl;
+	}
+
+	// 要创建 1 万多个文件并拷贝多次，耗时很长，只在设置了环境变量 MSYS_BASE_BENCHMARK 时运行。
+	if (std::getenv("MSYS_BASE_BENCHMARK") != nullptr)
+	{
+		// 测试块。并行拷贝目录树时，每秒拷贝的文件数随线程数的变化。
+		try
+		{
+			std::cout << std::endl;
+			std::cout << "======================================================" << std::endl;
+			std::cout << CODE_POS_STR;
+
+			base::Path root = "copy_engine_benchmark";
+			base::Path source = root + base::Path{"source"};
+			int64_t const directory_count = 64;
+			int64_t const file_count_per_directory = 256;
+			int64_t const file_count = directory_count * file_count_per_directory;
+			uint8_t content[4096]{};
+
+			base::filesystem::Remove(root);
+
+			for (int64_t i = 0; i < directory_count; i++)
+			{
+				for (int64_t j = 0; j < file_count_per_directory; j++)
+				{
+					base::Path path = source + base::Path{std::to_string(i)} + base::Path{std::to_string(j)};
+					base::filesystem::EnsureDirectory(path.ParentPath());
+					std::shared_ptr<base::FileStream> fs = base::FileStream::CreateNewAnyway(path);
+					fs->Write(base::ReadOnlySpan(content, sizeof(content)));
+				}
+			}
+
+			for (int64_t thread_count : {1, 2, 4, 8})
+			{
+				base::Path destination = root + base::Path{"destination"};
+				base::filesystem::Remove(destination);
+
+				auto start = std::chrono::steady_clock::now();
+
+				msys::CopyOptions options{};
+				options.overwrite_method = base::filesystem::OverwriteOption::Overwrite;
+				options.thread_count = thread_count;
+				msys::CopyEngine engine{options};
+				engine.CopyDirectory(source, destination);
+
+				auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+				int64_t milliseconds = std::max<int64_t>(elapsed.count(), 1);
+
+				std::cout << thread_count << " 线程: "
+						  << elapsed.count() << "ms, "
+						  << file_count * 1000 / milliseconds << " 文件/秒" << std::endl;
+			}
+
+			base::filesystem::Remove(root);
+		}
+		catch (std::exception const &e)
+		{
+			std::cerr << CODE_POS_STR << e.what() << std::endl;
+		}
+		catch (...)
+		{
+			std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+		}
+	}
+	else
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR << "跳过并行拷贝的性能测试。设置环境变量 MSYS_BASE_BENCHMARK 后运行。" << std::endl;
+	}
+
+	// 要创建 100 万个文件，耗时很长，只在设置了环境变量 MSYS_BASE_BENCHMARK 时运行。
+	if (std::getenv("MSYS_BASE_BENCHMARK") != nullptr)
+	{
+		// 测试块。枚举 100 万个条目的目录，并取得每个条目的类型。
+		try
+		{
+			std::cout << std::endl;
+			std::cout << "======================================================" << std::endl;
+			std::cout << CODE_POS_STR;
+
+			base::Path root = "directory_enumerator_benchmark";
+			int64_t const entry_count = 1000 * 1000;
+
+			base::filesystem::Remove(root);
+			base::filesystem::EnsureDirectory(root);
+
+			for (int64_t i = 0; i < entry_count; i++)
+			{
+				base::FileStream::CreateNewAnyway(root + base::Path{std::to_string(i)});
+			}
+
+			auto print = [&](std::string const &name, std::chrono::steady_clock::time_point start, int64_t count)
+			{
+				auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+				int64_t milliseconds = std::max<int64_t>(elapsed.count(), 1);
+
+				std::cout << name << ": "
+						  << elapsed.count() << "ms, "
+						  << count * 1000 / milliseconds << " 条目/秒" << std::endl;
+			};
+
+			{
+				// 原来的做法：每个条目构造路径，再查询一次类型。
+				auto start = std::chrono::steady_clock::now();
+				int64_t count = 0;
+
+				for (std::filesystem::directory_entry const &entry :
+					 std::filesystem::directory_iterator{base::filesystem::ToWindowsLongPathString(root)})
+				{
+					base::filesystem::DirectoryEntry directory_entry{base::filesystem::WindowsLongPathStringToPath(entry.path().string())};
+
+					if (base::filesystem::IsRegularFile(directory_entry.Path()))
+					{
+						count++;
+					}
+				}
+
+				print("std::filesystem::directory_iterator + IsRegularFile", start, count);
+			}
+
+			{
+				auto start = std::chrono::steady_clock::now();
+				int64_t count = 0;
+				msys::DirectoryEntryEnumerator enumerator{root};
+
+				while (!enumerator.IsEnd())
+				{
+					enumerator.CurrentValue();
+
+					if (enumerator.CurrentBatchEntry().type == msys::DirectoryEntryType::RegularFile)
+					{
+						count++;
+					}
+
+					enumerator.Add();
+				}
+
+				print("msys::DirectoryEntryEnumerator", start, count);
+			}
+
+			{
+				auto start = std::chrono::steady_clock::now();
+				int64_t count = 0;
+				msys::DirectoryBatchEnumerator enumerator{root};
+
+				while (enumerator.MoveNext())
+				{
+					if (enumerator.Current().type == msys::DirectoryEntryType::RegularFile)
+					{
+						count++;
+					}
+				}
+
+				print("msys::DirectoryBatchEnumerator", start, count);
+			}
+
+			base::filesystem::Remove(root);
+		}
+		catch (std::exception const &e)
+		{
+			std::cerr << CODE_POS_STR << e.what() << std::endl;
+		}
+		catch (...)
+		{
+			std::cerr << CODE_POS_STR << "未知异常。" << std::endl;
+		}
+	}
+	else
+	{
+		std::cout << std::endl;
+		std::cout << "======================================================" << std::endl;
+		std::cout << CODE_POS_STR << "跳过枚举 100 万个条目的性能测试。设置环境变量 MSYS_BASE_BENCHMARK 后运行。" << std::endl;
+	}
+
 	return 0;
 }